@@ -0,0 +1,698 @@
+/** Copy-on-write hash table used by libmaptel.                *
+ *  author: Cezary Bartoszuk                                   *
+ *  e-mail: cbart@students.mimuw.edu.pl                        *
+ *  The layout of HashTable (Robin Hood probing array of 8     *
+ *  byte slots and a dense array of entries in the order of    *
+ *  insertion) with both arrays split into fixed size pages.   *
+ *  Pages and the directory holding pointers to them are       *
+ *  reference counted: copying the table shares its directory, *
+ *  the first modification copies the directory (pointers      *
+ *  only) and every write to a shared page copies that page,   *
+ *  so an insert or erase copies a few pages of slots and      *
+ *  entries and the rest stays shared. Pages of a directory    *
+ *  which has never been shared are not shared either, so      *
+ *  writes to a table which has never been copied skip the     *
+ *  counters of pages, like writes to a HashTable. Tables      *
+ *  sharing pages may be used by different threads (counters   *
+ *  are atomic, shared pages are never written). Pages may be  *
+ *  allocated from an arena (see setArena()); a page holds     *
+ *  a reference to its arena and returns there wherever it is  *
+ *  released, or stays there until the arena dies (see         *
+ *  abandon()).                                                */
+
+#ifndef _COW_TABLE_H_
+#define _COW_TABLE_H_
+
+#include <vector>
+#include <algorithm>
+#include <new>
+
+#include <cassert>
+#include <cstddef>
+
+#include <stdint.h>
+
+#include "./tel_arena.h"
+
+/** Hash table mapping `Key` to `Value` with O(1) copying.
+ *  `Hasher` is a functor returning uint32_t hash of a key.
+ *  Pointers returned by find(), modify() and at() are valid
+ *  until the next modification of the table. */
+template<typename Key, typename Value, typename Hasher>
+class CowTable {
+
+    public:
+
+        typedef size_t size_type;
+
+        /** single key -> value pair; */
+        struct Entry {
+            Key key;
+            Value value;
+        };
+
+    private:
+
+        /** position in the probing array; */
+        struct Slot {
+            /** hash of the key (EMPTY for empty slots); */
+            uint32_t hash;
+            /** index of the entry; */
+            uint32_t index;
+        };
+
+        /** log2 of numbers of slots and entries in a page; */
+        static const size_type SLOT_BITS = 8;
+        static const size_type ENTRY_BITS = 6;
+
+        static const size_type SLOT_PAGE = 1 << SLOT_BITS;
+        static const size_type ENTRY_PAGE = 1 << ENTRY_BITS;
+
+        /** pages, possibly shared by many directories; */
+        struct SlotPage {
+            Slot items[SLOT_PAGE];
+            unsigned long references;
+            /** arena holding the page or NULL; */
+            TelArena* arena;
+        };
+
+        struct EntryPage {
+            Entry items[ENTRY_PAGE];
+            unsigned long references;
+            TelArena* arena;
+        };
+
+        /** pages of the table, possibly shared by many tables; */
+        struct Directory {
+            /** probing array (a single page if it is smaller); */
+            std::vector<SlotPage*> slots;
+            /** number of slots (zero or a power of two); */
+            size_type capacity;
+            /** dense array of entries; */
+            std::vector<EntryPage*> entries;
+            /** number of entries; */
+            size_type count;
+            /** number of tables using the directory; */
+            unsigned long references;
+            /** true once the directory has been shared (its pages
+             *  may be shared then, see modifySlot()); */
+            bool shared;
+        };
+
+        /** hash value marking an empty slot; */
+        static const uint32_t EMPTY = 0;
+
+        /** minimal number of slots of non empty table; */
+        static const size_type MIN_CAPACITY = 16;
+
+        /** the directory or NULL if nothing has been inserted; */
+        Directory* directory;
+
+        /** arena of new pages (NULL for the heap); */
+        TelArena* arena;
+
+        /** returns non zero hash of given key; */
+        static uint32_t hashOf(const Key& key)
+        {
+            uint32_t h = Hasher()(key);
+            return (h == EMPTY) ? 1 : h;
+        }
+
+        /** capacity - 1 (capacity is always a power of two); */
+        size_type mask() const
+        {
+            return directory->capacity - 1;
+        }
+
+        const Slot& slot(size_type position) const
+        {
+            return directory->slots[position >> SLOT_BITS]
+                ->items[position & (SLOT_PAGE - 1)];
+        }
+
+        /** true if pages of the directory may be shared (otherwise
+         *  writes skip their counters); */
+        bool sharesPages() const
+        {
+            return __atomic_load_n(&directory->shared, __ATOMIC_RELAXED);
+        }
+
+        /** slot of given position, copying its page if it is shared
+         *  (the directory must be ours); */
+        Slot& modifySlot(size_type position)
+        {
+            SlotPage*& page = directory->slots[position >> SLOT_BITS];
+            return (sharesPages() ? unshare(page) : page)
+                ->items[position & (SLOT_PAGE - 1)];
+        }
+
+        const Entry& entry(size_type index) const
+        {
+            return directory->entries[index >> ENTRY_BITS]
+                ->items[index & (ENTRY_PAGE - 1)];
+        }
+
+        /** entry of given index, copying its page if it is shared
+         *  (the directory must be ours); */
+        Entry& modifyEntry(size_type index)
+        {
+            EntryPage*& page = directory->entries[index >> ENTRY_BITS];
+            return (sharesPages() ? unshare(page) : page)
+                ->items[index & (ENTRY_PAGE - 1)];
+        }
+
+        /** distance of slot `position` from its home slot; */
+        size_type distance(size_type position) const
+        {
+            return (position - (slot(position).hash & mask())) & mask();
+        }
+
+        /** non zero hash of the key `probe` matches (see
+         *  findProbe()); */
+        template<typename Probe>
+        static uint32_t probeHash(const Probe& probe)
+        {
+            uint32_t h = probe.hash();
+            return (h == EMPTY) ? 1 : h;
+        }
+
+        /** true if `key` is `other` (or matches probe `other`); */
+        static bool matches(const Key& key, const Key& other)
+        {
+            return key == other;
+        }
+
+        template<typename Probe>
+        static bool matches(const Key& key, const Probe& probe)
+        {
+            return probe.matches(key);
+        }
+
+        /** returns slot of given key (or of the key a probe matches)
+         *  or capacity if absent; */
+        template<typename Probe>
+        size_type position(const Probe& key, uint32_t h) const;
+
+        /** puts slot (of key not present in table) to its place,
+         *  there must be a free slot; */
+        void place(Slot slot);
+
+        /** rebuilds probing array with `capacity` slots; */
+        void rehash(size_type capacity);
+
+        /** makes the directory ours (creating it if there is none),
+         *  copying it if it is shared; */
+        void unshareDirectory();
+
+        /** returns new page with a single reference; */
+        template<typename Page>
+        Page* newPage();
+
+        /** makes `page` ours, copying it if it is shared; */
+        template<typename Page>
+        Page* unshare(Page*& page);
+
+        /** drops a reference to `page`; a page of an arena released
+         *  by its last reference is destroyed only if `destroy`; */
+        template<typename Page>
+        static void release(Page* page, bool destroy);
+
+        /** drops a reference to `directory` and to its pages; */
+        static void release(Directory* directory, bool destroy);
+
+    public:
+
+        /** iterates over entries (in the order of their indexes); */
+        class const_iterator {
+
+            private:
+
+                const CowTable* table;
+                size_type index;
+
+            public:
+
+                const_iterator(const CowTable* table, size_type index)
+                    : table(table), index(index)
+                {
+                }
+
+                const Entry& operator*() const
+                {
+                    return table->at(index);
+                }
+
+                const Entry* operator->() const
+                {
+                    return &table->at(index);
+                }
+
+                const_iterator& operator++()
+                {
+                    index ++;
+                    return *this;
+                }
+
+                bool operator==(const const_iterator& other) const
+                {
+                    return index == other.index;
+                }
+
+                bool operator!=(const const_iterator& other) const
+                {
+                    return index != other.index;
+                }
+
+        };
+
+        /** creates empty table; */
+        CowTable()
+            : directory(NULL), arena(NULL)
+        {
+        }
+
+        /** shares the pages (and the arena) of `copy`; */
+        CowTable(const CowTable& copy)
+            : directory(copy.directory), arena(copy.arena)
+        {
+            if(directory != NULL) {
+                __atomic_add_fetch(&directory->references, 1,
+                                   __ATOMIC_RELAXED);
+                /* copies are made under the owner's lock, so its
+                 * next write sees the flag; */
+                __atomic_store_n(&directory->shared, true,
+                                 __ATOMIC_RELAXED);
+            }
+            if(arena != NULL)
+                TelArena::retain(arena);
+        }
+
+        /** shares the pages of `copy` (the arena is kept); */
+        CowTable& operator=(const CowTable& copy)
+        {
+            CowTable shared(copy);
+            std::swap(directory, shared.directory);
+            return *this;
+        }
+
+        ~CowTable()
+        {
+            clear();
+            if(arena != NULL)
+                TelArena::release(arena);
+        }
+
+        /** allocates new pages from `arena` (NULL for the heap);
+         *  pages allocated before stay where they are; */
+        void setArena(TelArena* arena)
+        {
+            if(arena != NULL)
+                TelArena::retain(arena);
+            if(this->arena != NULL)
+                TelArena::release(this->arena);
+            this->arena = arena;
+        }
+
+        /** number of stored entries; */
+        size_type size() const
+        {
+            return (directory == NULL) ? 0 : directory->count;
+        }
+
+        /** true if there are no entries; */
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        /** makes room for `expected` entries without rehashing; */
+        void reserve(size_type expected);
+
+        /** returns value of given key or NULL if key is absent; */
+        const Value* find(const Key& key) const
+        {
+            size_type index = indexOf(key);
+            if(index == size())
+                return NULL;
+            return &entry(index).value;
+        }
+
+        /** returns modifiable value of given key (copying its page
+         *  if it is shared) or NULL if key is absent; */
+        Value* modify(const Key& key)
+        {
+            size_type index = indexOf(key);
+            if(index == size())
+                return NULL;
+            return &modifyAt(index).value;
+        }
+
+        /** returns index of given key's entry in [0, size())
+         *  or size() if key is absent; indexes are valid until
+         *  the next insert() of a new key or erase(); */
+        size_type indexOf(const Key& key) const
+        {
+            if(directory == NULL)
+                return 0;
+            size_type pos = position(key, hashOf(key));
+            if(pos == directory->capacity)
+                return directory->count;
+            return slot(pos).index;
+        }
+
+        /** find() of the key `probe` matches: `probe.hash()` equals
+         *  Hasher() of the key and `probe.matches(key)` tells if
+         *  a key is the probed one (see TelProbe), so no key is
+         *  constructed for a lookup; */
+        template<typename Probe>
+        const Value* findProbe(const Probe& probe) const
+        {
+            size_type index = indexOfProbe(probe);
+            if(index == size())
+                return NULL;
+            return &entry(index).value;
+        }
+
+        /** indexOf() of the key `probe` matches (see findProbe()); */
+        template<typename Probe>
+        size_type indexOfProbe(const Probe& probe) const
+        {
+            if(directory == NULL)
+                return 0;
+            size_type pos = position(probe, probeHash(probe));
+            if(pos == directory->capacity)
+                return directory->count;
+            return slot(pos).index;
+        }
+
+        /** returns entry of given index (see indexOf()); */
+        const Entry& at(size_type index) const
+        {
+            return entry(index);
+        }
+
+        /** returns entry of given index (see indexOf()), copying
+         *  its page if it is shared; its key must not be modified; */
+        Entry& modifyAt(size_type index)
+        {
+            unshareDirectory();
+            return modifyEntry(index);
+        }
+
+        /** sets value of given key; true if key was not present; */
+        bool insert(const Key& key, const Value& value);
+
+        /** removes given key; true if key was present; */
+        bool erase(const Key& key);
+
+        /** removes all entries and releases the pages; */
+        void clear()
+        {
+            if(directory != NULL)
+                release(directory, true);
+            directory = NULL;
+        }
+
+        /** clear() of a table whose entries own nothing (their
+         *  destructors would do nothing): pages held by this table
+         *  only are left in their arenas, which free their chunks
+         *  with the last reference, so the entries are not touched
+         *  (pages on the heap are deleted as usual); */
+        void abandon()
+        {
+            if(directory != NULL)
+                release(directory, false);
+            directory = NULL;
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(this, 0);
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(this, size());
+        }
+
+};
+
+/** implementation: */
+
+template<typename Key, typename Value, typename Hasher>
+const size_t CowTable<Key, Value, Hasher>::SLOT_BITS;
+
+template<typename Key, typename Value, typename Hasher>
+const size_t CowTable<Key, Value, Hasher>::ENTRY_BITS;
+
+template<typename Key, typename Value, typename Hasher>
+const size_t CowTable<Key, Value, Hasher>::SLOT_PAGE;
+
+template<typename Key, typename Value, typename Hasher>
+const size_t CowTable<Key, Value, Hasher>::ENTRY_PAGE;
+
+template<typename Key, typename Value, typename Hasher>
+const uint32_t CowTable<Key, Value, Hasher>::EMPTY;
+
+template<typename Key, typename Value, typename Hasher>
+const size_t CowTable<Key, Value, Hasher>::MIN_CAPACITY;
+
+template<typename Key, typename Value, typename Hasher>
+template<typename Probe>
+size_t CowTable<Key, Value, Hasher>::position
+    (const Probe& key, uint32_t h) const
+{
+    if(directory->count == 0)
+        return directory->capacity;
+    size_type pos = h & mask();
+    for(size_type dist = 0; ; dist ++) {
+        const Slot& current = slot(pos);
+        /* Robin Hood invariant: if we have probed further than
+         * the current slot's entry did, the key cannot be here. */
+        if(current.hash == EMPTY || distance(pos) < dist)
+            return directory->capacity;
+        if(current.hash == h && matches(entry(current.index).key, key))
+            return pos;
+        pos = (pos + 1) & mask();
+    }
+}
+
+template<typename Key, typename Value, typename Hasher>
+void CowTable<Key, Value, Hasher>::place(Slot placed)
+{
+    size_type pos = placed.hash & mask();
+    for(size_type dist = 0; ; dist ++) {
+        if(slot(pos).hash == EMPTY) {
+            modifySlot(pos) = placed;
+            return;
+        }
+        size_type slot_dist = distance(pos);
+        if(slot_dist < dist) {
+            /* steal from the rich: continue with the displaced slot; */
+            std::swap(modifySlot(pos), placed);
+            dist = slot_dist;
+        }
+        pos = (pos + 1) & mask();
+    }
+}
+
+template<typename Key, typename Value, typename Hasher>
+void CowTable<Key, Value, Hasher>::rehash(size_type capacity)
+{
+    std::vector<SlotPage*> old_slots(
+        std::max<size_type>(capacity >> SLOT_BITS, 1), NULL);
+    for(size_type i = 0; i < old_slots.size(); i ++)
+        old_slots[i] = newPage<SlotPage>();
+    size_type old_capacity = directory->capacity;
+    directory->slots.swap(old_slots);
+    directory->capacity = capacity;
+    for(size_type i = 0; i < old_capacity; i ++) {
+        const Slot& old_slot = old_slots[i >> SLOT_BITS]
+            ->items[i & (SLOT_PAGE - 1)];
+        if(old_slot.hash != EMPTY)
+            place(old_slot);
+    }
+    for(size_type i = 0; i < old_slots.size(); i ++)
+        release(old_slots[i], true);
+}
+
+template<typename Key, typename Value, typename Hasher>
+void CowTable<Key, Value, Hasher>::unshareDirectory()
+{
+    if(directory == NULL) {
+        directory = new Directory();
+        directory->capacity = 0;
+        directory->count = 0;
+        directory->references = 1;
+        directory->shared = false;
+        return;
+    }
+    /* a single reference is ours: nobody else may take a new one
+     * (copies are made under the owner's lock), and the acquire
+     * pairs with release() of the last other owner; */
+    if(__atomic_load_n(&directory->references, __ATOMIC_ACQUIRE) == 1)
+        return;
+    /* counters are not copied (other tables update them); */
+    Directory* copy = new Directory();
+    copy->slots = directory->slots;
+    copy->capacity = directory->capacity;
+    copy->entries = directory->entries;
+    copy->count = directory->count;
+    copy->references = 1;
+    copy->shared = true;
+    for(size_type i = 0; i < copy->slots.size(); i ++)
+        __atomic_add_fetch(&copy->slots[i]->references, 1,
+                           __ATOMIC_RELAXED);
+    for(size_type i = 0; i < copy->entries.size(); i ++)
+        __atomic_add_fetch(&copy->entries[i]->references, 1,
+                           __ATOMIC_RELAXED);
+    release(directory, true);
+    directory = copy;
+}
+
+template<typename Key, typename Value, typename Hasher>
+template<typename Page>
+Page* CowTable<Key, Value, Hasher>::newPage()
+{
+    Page* page;
+    if(arena == NULL)
+        page = new Page();
+    else {
+        void* block = arena->allocate(sizeof(Page));
+        try {
+            page = new(block) Page();
+        }
+        catch(...) {
+            arena->deallocate(block, sizeof(Page));
+            throw;
+        }
+        TelArena::retain(arena);
+    }
+    page->references = 1;
+    page->arena = arena;
+    return page;
+}
+
+template<typename Key, typename Value, typename Hasher>
+template<typename Page>
+Page* CowTable<Key, Value, Hasher>::unshare(Page*& page)
+{
+    if(__atomic_load_n(&page->references, __ATOMIC_ACQUIRE) > 1) {
+        Page* copy = newPage<Page>();
+        std::copy(page->items,
+                  page->items + sizeof(page->items) / sizeof(page->items[0]),
+                  copy->items);
+        release(page, true);
+        page = copy;
+    }
+    return page;
+}
+
+template<typename Key, typename Value, typename Hasher>
+template<typename Page>
+void CowTable<Key, Value, Hasher>::release(Page* page, bool destroy)
+{
+    if(__atomic_sub_fetch(&page->references, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+    TelArena* arena = page->arena;
+    if(arena == NULL) {
+        delete page;
+        return;
+    }
+    if(destroy) {
+        page->~Page();
+        arena->deallocate(page, sizeof(Page));
+    }
+    TelArena::release(arena);
+}
+
+template<typename Key, typename Value, typename Hasher>
+void CowTable<Key, Value, Hasher>::release
+    (Directory* directory, bool destroy)
+{
+    if(__atomic_sub_fetch(&directory->references, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+    for(size_type i = 0; i < directory->slots.size(); i ++)
+        release(directory->slots[i], destroy);
+    for(size_type i = 0; i < directory->entries.size(); i ++)
+        release(directory->entries[i], destroy);
+    delete directory;
+}
+
+template<typename Key, typename Value, typename Hasher>
+void CowTable<Key, Value, Hasher>::reserve(size_type expected)
+{
+    unshareDirectory();
+    size_type capacity = std::max(directory->capacity, MIN_CAPACITY);
+    /* maximal load factor is 7/8; */
+    while(capacity - capacity / 8 < expected)
+        capacity *= 2;
+    if(capacity > directory->capacity)
+        rehash(capacity);
+    directory->entries.reserve((expected + ENTRY_PAGE - 1) >> ENTRY_BITS);
+}
+
+template<typename Key, typename Value, typename Hasher>
+bool CowTable<Key, Value, Hasher>::insert
+    (const Key& key, const Value& value)
+{
+    uint32_t h = hashOf(key);
+    unshareDirectory();
+    size_type pos = position(key, h);
+    if(pos != directory->capacity) {
+        modifyEntry(slot(pos).index).value = value;
+        return false;
+    }
+    size_type capacity = directory->capacity;
+    if(capacity - capacity / 8 <= directory->count)
+        rehash(std::max(2 * capacity, MIN_CAPACITY));
+    size_type index = directory->count;
+    if((index & (ENTRY_PAGE - 1)) == 0)
+        directory->entries.push_back(newPage<EntryPage>());
+    Entry& added = modifyEntry(index);
+    added.key = key;
+    added.value = value;
+    directory->count ++;
+    Slot placed = { h, static_cast<uint32_t>(index) };
+    place(placed);
+    return true;
+}
+
+template<typename Key, typename Value, typename Hasher>
+bool CowTable<Key, Value, Hasher>::erase(const Key& key)
+{
+    if(directory == NULL)
+        return false;
+    size_type pos = position(key, hashOf(key));
+    if(pos == directory->capacity)
+        return false;
+    unshareDirectory();
+    uint32_t index = slot(pos).index;
+    /* backward shift: pull following slots one position closer
+     * to their home positions, until a slot already at home; */
+    size_type next = (pos + 1) & mask();
+    while(slot(next).hash != EMPTY && distance(next) > 0) {
+        modifySlot(pos) = slot(next);
+        pos = next;
+        next = (next + 1) & mask();
+    }
+    modifySlot(pos).hash = EMPTY;
+    /* fill the hole in entries with the last entry; */
+    uint32_t last = static_cast<uint32_t>(directory->count - 1);
+    if(index != last) {
+        size_type moved = position(entry(last).key, hashOf(entry(last).key));
+        assert(moved != directory->capacity);
+        modifySlot(moved).index = index;
+        std::swap(modifyEntry(index), modifyEntry(last));
+    }
+    directory->count --;
+    if((last & (ENTRY_PAGE - 1)) == 0) {
+        release(directory->entries.back(), true);
+        directory->entries.pop_back();
+    }
+    else
+        modifyEntry(last) = Entry();
+    return true;
+}
+
+#endif
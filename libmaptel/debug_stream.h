@@ -0,0 +1,98 @@
+/** Diagnostic messages of libmaptel.    *
+ *  author: Cezary Bartoszuk             *
+ *  e-mail: cbart@students.mimuw.edu.pl  */
+
+#ifndef _DEBUG_STREAM_H_
+#define _DEBUG_STREAM_H_
+
+#include <iostream>
+#include <string>
+
+#ifdef MAPTEL_DEBUG_LEVEL
+    const unsigned long DEBUG_LEVEL = MAPTEL_DEBUG_LEVEL;
+#else
+    const unsigned long DEBUG_LEVEL = 0;
+#endif
+
+
+/**
+  std::cerr output description:
+  (II) information
+  (EE) error
+  (WW) warning
+*/
+
+/** Error and warnings handling class. */
+class DebugStream {
+
+    private:
+
+        const unsigned long MIN_DEBUG_LEVEL;
+
+    public:
+
+        DebugStream(unsigned long min_debug = 0)
+            : MIN_DEBUG_LEVEL(min_debug)
+        {
+        }
+
+        template<typename T>
+        friend DebugStream& operator<<(DebugStream& ds, const T& message);
+
+        friend DebugStream& operator<<
+            (DebugStream& ds, std::ostream& (*message_fun)(std::ostream&));
+};
+
+/* The basic idea of DebugStream class and functions:
+ * debug_info(), debug_warn() and debug_err()
+ * is to manage diagnostic messages in a friendly
+ * (for people reading the code) and flexible way.
+ * (We can change mininal debuglevel of all warnings
+ * just by changing two integer values if debug_warn()). */
+
+/** Name of current library displayed with every diagnostic info. */
+const std::string DEBUG_LIB_NAME = " libmaptel -> ";
+
+/** Error and warnings handling implementation. */
+
+template<typename T>
+inline DebugStream& operator<<(DebugStream& ds, const T& message)
+{
+    if(DEBUG_LEVEL >= ds.MIN_DEBUG_LEVEL)
+        std::cerr << message;
+    return ds;
+}
+
+inline DebugStream& operator<<
+    (DebugStream& ds, std::ostream& (*message_fun)(std::ostream&))
+{
+    if(DEBUG_LEVEL >= ds.MIN_DEBUG_LEVEL)
+        std::cerr << message_fun;
+    return ds;
+}
+
+inline DebugStream& debug_info()
+{
+    static DebugStream info_stream = DebugStream(2);
+        if(DEBUG_LEVEL >= 2)
+            std::cerr << "(II)" << DEBUG_LIB_NAME;
+    return info_stream;
+}
+
+inline DebugStream& debug_warn()
+{
+    static DebugStream warning_stream = DebugStream(2);
+        if(DEBUG_LEVEL >= 2)
+            std::cerr << "(WW)" << DEBUG_LIB_NAME;
+    return warning_stream;
+}
+
+inline DebugStream& debug_err()
+{
+    static DebugStream error_stream = DebugStream(2);
+        if(DEBUG_LEVEL >= 2)
+            std::cerr << "(EE)" << DEBUG_LIB_NAME;
+    return error_stream;
+}
+
+#endif
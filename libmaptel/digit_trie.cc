@@ -0,0 +1,165 @@
+/** Digit trie of prefix rules used by libmaptel. *
+ *  author: Cezary Bartoszuk                      *
+ *  e-mail: cbart@students.mimuw.edu.pl           */
+
+#include <string>
+#include <vector>
+
+#include <cassert>
+
+#include "./digit_trie.h"
+
+const uint32_t DigitTrie::NONE;
+
+/** returns value of digit `c` or 10 if it is not a digit; */
+static unsigned digitOf(char c)
+{
+    return (c >= '0' && c <= '9') ? static_cast<unsigned>(c - '0') : 10;
+}
+
+DigitTrie::DigitTrie()
+{
+    newNode();
+}
+
+uint32_t DigitTrie::newNode()
+{
+    Node node;
+    for(int i = 0; i < 10; i ++)
+        node.children[i] = NONE;
+    node.rule = NONE;
+    if(!free_nodes.empty()) {
+        uint32_t index = free_nodes.back();
+        free_nodes.pop_back();
+        nodes[index] = node;
+        return index;
+    }
+    nodes.push_back(node);
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+size_t DigitTrie::size() const
+{
+    return destinations.size() - free_rules.size();
+}
+
+bool DigitTrie::empty() const
+{
+    return size() == 0;
+}
+
+bool DigitTrie::insert(const std::string& prefix,
+                       const std::string& destination)
+{
+    assert(!prefix.empty());
+    uint32_t node = 0;
+    for(size_t i = 0; i < prefix.size(); i ++) {
+        unsigned digit = digitOf(prefix[i]);
+        assert(digit < 10);
+        if(digit >= 10)
+            return false;
+        if(nodes[node].children[digit] == NONE) {
+            /* newNode() may move `nodes`; */
+            uint32_t child = newNode();
+            nodes[node].children[digit] = child;
+        }
+        node = nodes[node].children[digit];
+    }
+    if(nodes[node].rule != NONE) {
+        destinations[nodes[node].rule] = destination;
+        return false;
+    }
+    if(!free_rules.empty()) {
+        nodes[node].rule = free_rules.back();
+        free_rules.pop_back();
+        destinations[nodes[node].rule] = destination;
+    }
+    else {
+        nodes[node].rule = static_cast<uint32_t>(destinations.size());
+        destinations.push_back(destination);
+    }
+    return true;
+}
+
+bool DigitTrie::erase(const std::string& prefix)
+{
+    std::vector<uint32_t> path(1, 0);
+    for(size_t i = 0; i < prefix.size(); i ++) {
+        unsigned digit = digitOf(prefix[i]);
+        if(digit >= 10 || nodes[path.back()].children[digit] == NONE)
+            return false;
+        path.push_back(nodes[path.back()].children[digit]);
+    }
+    Node& last = nodes[path.back()];
+    if(path.size() == 1 || last.rule == NONE)
+        return false;
+    destinations[last.rule].clear();
+    free_rules.push_back(last.rule);
+    last.rule = NONE;
+    /* free nodes left without rules and children (but the root); */
+    for(size_t i = path.size() - 1; i > 0; i --) {
+        const Node& node = nodes[path[i]];
+        if(node.rule != NONE)
+            break;
+        bool leaf = true;
+        for(int digit = 0; digit < 10 && leaf; digit ++)
+            leaf = (node.children[digit] == NONE);
+        if(!leaf)
+            break;
+        nodes[path[i - 1]].children[digitOf(prefix[i - 1])] = NONE;
+        free_nodes.push_back(path[i]);
+    }
+    return true;
+}
+
+const std::string* DigitTrie::longestMatch(const std::string& number,
+                                           size_t& length) const
+{
+    const std::string* found = NULL;
+    uint32_t node = 0;
+    for(size_t i = 0; i < number.size(); i ++) {
+        unsigned digit = digitOf(number[i]);
+        if(digit >= 10)
+            break;
+        node = nodes[node].children[digit];
+        if(node == NONE)
+            break;
+        if(nodes[node].rule != NONE) {
+            found = &destinations[nodes[node].rule];
+            length = i + 1;
+        }
+    }
+    return found;
+}
+
+void DigitTrie::collect(uint32_t node, std::string& prefix,
+                        std::vector<std::pair<std::string, std::string> >&
+                            rules) const
+{
+    if(nodes[node].rule != NONE)
+        rules.push_back(std::make_pair(prefix,
+                                       destinations[nodes[node].rule]));
+    for(int digit = 0; digit < 10; digit ++)
+        if(nodes[node].children[digit] != NONE) {
+            prefix.push_back(static_cast<char>('0' + digit));
+            collect(nodes[node].children[digit], prefix, rules);
+            prefix.erase(prefix.size() - 1);
+        }
+}
+
+void DigitTrie::rules(std::vector<std::pair<std::string, std::string> >&
+                          rules) const
+{
+    std::string prefix;
+    rules.clear();
+    collect(0, prefix, rules);
+}
+
+void DigitTrie::clear()
+{
+    std::vector<Node>().swap(nodes);
+    std::vector<uint32_t>().swap(free_nodes);
+    std::vector<std::string>().swap(destinations);
+    std::vector<uint32_t>().swap(free_rules);
+    newNode();
+}
@@ -0,0 +1,92 @@
+/** Digit trie of prefix rules used by libmaptel.           *
+ *  author: Cezary Bartoszuk                                *
+ *  e-mail: cbart@students.mimuw.edu.pl                     *
+ *  10-ary trie: a node per digit of every rule's prefix,   *
+ *  nodes are kept in a single array and refer to their     *
+ *  children by index. The longest prefix of a number which *
+ *  has a rule is found in a single walk down the trie, so  *
+ *  lookups are bounded by the length of the number.        */
+
+#ifndef _DIGIT_TRIE_H_
+#define _DIGIT_TRIE_H_
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include <cstddef>
+
+#include <stdint.h>
+
+class DigitTrie {
+
+    private:
+
+        /** missing child or rule; */
+        static const uint32_t NONE = 0xFFFFFFFFu;
+
+        /** single digit of prefixes; */
+        struct Node {
+            /** nodes of following digits (or NONE); */
+            uint32_t children[10];
+            /** index of the rule of the prefix ending here
+             *  in `destinations` (or NONE); */
+            uint32_t rule;
+        };
+
+        /** all nodes, the root is the first one; */
+        std::vector<Node> nodes;
+
+        /** nodes not used (after erase()); */
+        std::vector<uint32_t> free_nodes;
+
+        /** destinations of rules (free ones are empty); */
+        std::vector<std::string> destinations;
+
+        /** indexes of free destinations; */
+        std::vector<uint32_t> free_rules;
+
+        /** returns index of a new node without children and rule; */
+        uint32_t newNode();
+
+        /** appends rules of subtree of `node` (whose prefix is
+         *  `prefix`) to `rules`; */
+        void collect(uint32_t node, std::string& prefix,
+                     std::vector<std::pair<std::string, std::string> >&
+                         rules) const;
+
+    public:
+
+        /** creates trie without rules; */
+        DigitTrie();
+
+        /** number of rules; */
+        size_t size() const;
+
+        /** true if there are no rules; */
+        bool empty() const;
+
+        /** sets rule `prefix` -> `destination`; `prefix` must be
+         *  a non empty sequence of digits; true if it is new; */
+        bool insert(const std::string& prefix, const std::string& destination);
+
+        /** removes rule of `prefix`; true if it was present; */
+        bool erase(const std::string& prefix);
+
+        /** returns destination of the rule of the longest prefix
+         *  of `number` (and sets `length` to the prefix length)
+         *  or NULL if no prefix of `number` has a rule; */
+        const std::string* longestMatch(const std::string& number,
+                                        size_t& length) const;
+
+        /** returns all rules (prefix, destination)
+         *  in lexicographic order of prefixes; */
+        void rules(std::vector<std::pair<std::string, std::string> >&
+                       rules) const;
+
+        /** removes all rules and frees memory; */
+        void clear();
+
+};
+
+#endif
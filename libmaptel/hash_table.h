@@ -0,0 +1,386 @@
+/** Open addressing hash table used by libmaptel.         *
+ *  author: Cezary Bartoszuk                              *
+ *  e-mail: cbart@students.mimuw.edu.pl                   *
+ *  Robin Hood hashing with linear probing. Slots are     *
+ *  8 bytes: 32 bit hash of the key (the fingerprint) and *
+ *  index of the entry in a dense array of entries, so    *
+ *  probing compares integers, touches a cache line or    *
+ *  two and never moves keys; keys are compared only when *
+ *  the whole hash matches. Deletion uses backward        *
+ *  shifting (no tombstones) and moves the last entry     *
+ *  into the hole left in the dense array.                */
+
+#ifndef _HASH_TABLE_H_
+#define _HASH_TABLE_H_
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+#include <stdint.h>
+
+/** Hash of `length` bytes of `data` (8 bytes at a time
+ *  multiply-xorshift); hashes of strings and of long numbers
+ *  (see TelNumber::hashLong()) are the same. */
+inline uint32_t hashBytes(const char* data, size_t length)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ length;
+    uint64_t chunk;
+    while(length >= 8) {
+        memcpy(&chunk, data, 8);
+        h = (h ^ chunk) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 31;
+        data += 8;
+        length -= 8;
+    }
+    chunk = 0;
+    memcpy(&chunk, data, length);
+    h = (h ^ chunk) * 0x94D049BB133111EBULL;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    return static_cast<uint32_t>(h >> 32);
+}
+
+/** Hash of a std::string (see hashBytes()). */
+struct StringHash {
+
+    uint32_t operator()(const std::string& key) const
+    {
+        return hashBytes(key.data(), key.size());
+    }
+
+};
+
+/** Hash table mapping `Key` to `Value`.
+ *  `Hasher` is a functor returning uint32_t hash of a key.
+ *  Pointers returned by find() are valid until the next
+ *  insert() of a new key or erase(). */
+template<typename Key, typename Value, typename Hasher>
+class HashTable {
+
+    public:
+
+        typedef size_t size_type;
+
+        /** single key -> value pair; */
+        struct Entry {
+            Key key;
+            Value value;
+        };
+
+        /** iterates over entries (in no particular order); */
+        typedef typename std::vector<Entry>::const_iterator const_iterator;
+
+    private:
+
+        /** position in the probing array; */
+        struct Slot {
+            /** hash of the key (EMPTY for empty slots); */
+            uint32_t hash;
+            /** index of the entry in `entries`; */
+            uint32_t index;
+        };
+
+        /** hash value marking an empty slot; */
+        static const uint32_t EMPTY = 0;
+
+        /** minimal number of slots of non empty table; */
+        static const size_type MIN_CAPACITY = 16;
+
+        /** probing array (its size is zero or a power of two); */
+        std::vector<Slot> slots;
+
+        /** dense array of entries; */
+        std::vector<Entry> entries;
+
+        /** returns non zero hash of given key; */
+        static uint32_t hashOf(const Key& key)
+        {
+            uint32_t h = Hasher()(key);
+            return (h == EMPTY) ? 1 : h;
+        }
+
+        /** capacity - 1 (capacity is always a power of two); */
+        size_type mask() const
+        {
+            return slots.size() - 1;
+        }
+
+        /** distance of slot `position` from its home slot; */
+        size_type distance(size_type position) const
+        {
+            return (position - (slots[position].hash & mask())) & mask();
+        }
+
+        /** non zero hash of the key `probe` matches (see
+         *  findProbe()); */
+        template<typename Probe>
+        static uint32_t probeHash(const Probe& probe)
+        {
+            uint32_t h = probe.hash();
+            return (h == EMPTY) ? 1 : h;
+        }
+
+        /** true if `key` is `other` (or matches probe `other`); */
+        static bool matches(const Key& key, const Key& other)
+        {
+            return key == other;
+        }
+
+        template<typename Probe>
+        static bool matches(const Key& key, const Probe& probe)
+        {
+            return probe.matches(key);
+        }
+
+        /** returns slot of given key (or of the key a probe matches)
+         *  or slots.size() if absent; */
+        template<typename Probe>
+        size_type position(const Probe& key, uint32_t h) const;
+
+        /** puts slot (of key not present in table) to its place,
+         *  there must be a free slot; */
+        void place(Slot slot);
+
+        /** rebuilds probing array with `capacity` slots; */
+        void rehash(size_type capacity);
+
+    public:
+
+        /** creates empty table; */
+        HashTable()
+        {
+        }
+
+        /** number of stored entries; */
+        size_type size() const
+        {
+            return entries.size();
+        }
+
+        /** true if there are no entries; */
+        bool empty() const
+        {
+            return entries.empty();
+        }
+
+        /** makes room for `expected` entries without rehashing; */
+        void reserve(size_type expected);
+
+        /** returns value of given key or NULL if key is absent; */
+        const Value* find(const Key& key) const;
+
+        /** returns value of given key or NULL if key is absent; */
+        Value* find(const Key& key);
+
+        /** returns index of given key's entry in [0, size())
+         *  or size() if key is absent; indexes are valid until
+         *  the next insert() of a new key or erase(); */
+        size_type indexOf(const Key& key) const;
+
+        /** find() of the key `probe` matches: `probe.hash()` equals
+         *  Hasher() of the key and `probe.matches(key)` tells if
+         *  a key is the probed one (see TelProbe), so no key is
+         *  constructed for a lookup; */
+        template<typename Probe>
+        const Value* findProbe(const Probe& probe) const
+        {
+            size_type pos = position(probe, probeHash(probe));
+            if(pos == slots.size())
+                return NULL;
+            return &entries[slots[pos].index].value;
+        }
+
+        /** returns entry of given index (see indexOf()); */
+        const Entry& at(size_type index) const
+        {
+            return entries[index];
+        }
+
+        /** returns entry of given index (see indexOf());
+         *  its key must not be modified; */
+        Entry& at(size_type index)
+        {
+            return entries[index];
+        }
+
+        /** sets value of given key; true if key was not present; */
+        bool insert(const Key& key, const Value& value);
+
+        /** removes given key; true if key was present; */
+        bool erase(const Key& key);
+
+        /** removes all entries and frees memory; */
+        void clear();
+
+        const_iterator begin() const
+        {
+            return entries.begin();
+        }
+
+        const_iterator end() const
+        {
+            return entries.end();
+        }
+
+};
+
+/** implementation: */
+
+template<typename Key, typename Value, typename Hasher>
+const uint32_t HashTable<Key, Value, Hasher>::EMPTY;
+
+template<typename Key, typename Value, typename Hasher>
+const size_t HashTable<Key, Value, Hasher>::MIN_CAPACITY;
+
+template<typename Key, typename Value, typename Hasher>
+template<typename Probe>
+size_t HashTable<Key, Value, Hasher>::position
+    (const Probe& key, uint32_t h) const
+{
+    if(entries.empty())
+        return slots.size();
+    size_type pos = h & mask();
+    for(size_type dist = 0; ; dist ++) {
+        const Slot& slot = slots[pos];
+        /* Robin Hood invariant: if we have probed further than
+         * the current slot's entry did, the key cannot be here. */
+        if(slot.hash == EMPTY || distance(pos) < dist)
+            return slots.size();
+        if(slot.hash == h && matches(entries[slot.index].key, key))
+            return pos;
+        pos = (pos + 1) & mask();
+    }
+}
+
+template<typename Key, typename Value, typename Hasher>
+void HashTable<Key, Value, Hasher>::place(Slot slot)
+{
+    size_type pos = slot.hash & mask();
+    for(size_type dist = 0; ; dist ++) {
+        if(slots[pos].hash == EMPTY) {
+            slots[pos] = slot;
+            return;
+        }
+        size_type slot_dist = distance(pos);
+        if(slot_dist < dist) {
+            /* steal from the rich: continue with the displaced slot; */
+            std::swap(slots[pos], slot);
+            dist = slot_dist;
+        }
+        pos = (pos + 1) & mask();
+    }
+}
+
+template<typename Key, typename Value, typename Hasher>
+void HashTable<Key, Value, Hasher>::rehash(size_type capacity)
+{
+    Slot empty = { EMPTY, 0 };
+    std::vector<Slot> old_slots(capacity, empty);
+    slots.swap(old_slots);
+    for(size_type i = 0; i < old_slots.size(); i ++)
+        if(old_slots[i].hash != EMPTY)
+            place(old_slots[i]);
+}
+
+template<typename Key, typename Value, typename Hasher>
+void HashTable<Key, Value, Hasher>::reserve(size_type expected)
+{
+    size_type capacity = std::max(slots.size(), MIN_CAPACITY);
+    /* maximal load factor is 7/8; */
+    while(capacity - capacity / 8 < expected)
+        capacity *= 2;
+    if(capacity > slots.size())
+        rehash(capacity);
+    /* repeated reserve() calls must not grow `entries` linearly; */
+    if(expected > entries.capacity())
+        entries.reserve(std::max(expected, 2 * entries.capacity()));
+}
+
+template<typename Key, typename Value, typename Hasher>
+const Value* HashTable<Key, Value, Hasher>::find(const Key& key) const
+{
+    size_type pos = position(key, hashOf(key));
+    if(pos == slots.size())
+        return NULL;
+    return &entries[slots[pos].index].value;
+}
+
+template<typename Key, typename Value, typename Hasher>
+Value* HashTable<Key, Value, Hasher>::find(const Key& key)
+{
+    size_type pos = position(key, hashOf(key));
+    if(pos == slots.size())
+        return NULL;
+    return &entries[slots[pos].index].value;
+}
+
+template<typename Key, typename Value, typename Hasher>
+size_t HashTable<Key, Value, Hasher>::indexOf(const Key& key) const
+{
+    size_type pos = position(key, hashOf(key));
+    if(pos == slots.size())
+        return entries.size();
+    return slots[pos].index;
+}
+
+template<typename Key, typename Value, typename Hasher>
+bool HashTable<Key, Value, Hasher>::insert
+    (const Key& key, const Value& value)
+{
+    uint32_t h = hashOf(key);
+    size_type pos = position(key, h);
+    if(pos != slots.size()) {
+        entries[slots[pos].index].value = value;
+        return false;
+    }
+    if(slots.size() - slots.size() / 8 <= entries.size())
+        rehash(std::max(2 * slots.size(), MIN_CAPACITY));
+    Slot slot = { h, static_cast<uint32_t>(entries.size()) };
+    Entry entry = { key, value };
+    entries.push_back(entry);
+    place(slot);
+    return true;
+}
+
+template<typename Key, typename Value, typename Hasher>
+bool HashTable<Key, Value, Hasher>::erase(const Key& key)
+{
+    size_type pos = position(key, hashOf(key));
+    if(pos == slots.size())
+        return false;
+    uint32_t index = slots[pos].index;
+    /* backward shift: pull following slots one position closer
+     * to their home positions, until a slot already at home; */
+    size_type next = (pos + 1) & mask();
+    while(slots[next].hash != EMPTY && distance(next) > 0) {
+        slots[pos] = slots[next];
+        pos = next;
+        next = (next + 1) & mask();
+    }
+    slots[pos].hash = EMPTY;
+    /* fill the hole in `entries` with the last entry; */
+    uint32_t last = static_cast<uint32_t>(entries.size() - 1);
+    if(index != last) {
+        size_type moved = position(entries[last].key,
+                                   hashOf(entries[last].key));
+        assert(moved != slots.size());
+        slots[moved].index = index;
+        std::swap(entries[index], entries[last]);
+    }
+    entries.pop_back();
+    return true;
+}
+
+template<typename Key, typename Value, typename Hasher>
+void HashTable<Key, Value, Hasher>::clear()
+{
+    std::vector<Slot>().swap(slots);
+    std::vector<Entry>().swap(entries);
+}
+
+#endif
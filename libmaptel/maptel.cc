@@ -2,11 +2,11 @@
  *  author: Cezary Bartoszuk             *
  *  e-mail: cbart@students.mimuw.edu.pl  */
 
-#include <map>
-#include <set>
-#include <list>
+#include <vector>
+#include <algorithm>
 
 #include <cassert>
+#include <cstdlib>
 
 #include <iostream>
 
@@ -14,152 +14,636 @@
 #include <cstring>
 
 #include "./maptel.h"
+#include "./debug_stream.h"
+#include "./rw_lock.h"
+#include "./hash_table.h"
+#include "./cow_table.h"
+#include "./tel_file.h"
+#include "./tel_snapshot.h"
+#include "./tel_journal.h"
+#include "./digit_trie.h"
+#include "./tel_number.h"
+#include "./tel_frozen.h"
+#include "./tel_arena.h"
+#include "./tel_striped.h"
+#include "./tel_epoch.h"
+
+#if MAPTEL_CONCURRENT
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 typedef unsigned long Integer;
 
 typedef std::string String;
 
-#ifdef MAPTEL_DEBUG_LEVEL
-    const Integer DEBUG_LEVEL = MAPTEL_DEBUG_LEVEL;
-#else
-    const Integer DEBUG_LEVEL = 0;
-#endif
-
 
 const size_t MAX_STR_LENGTH = 100;
 
 
-/**
-  std::cerr output description:
-  (II) information
-  (EE) error
-  (WW) warning
-*/
-
-/** Error and warnings handling class. */
-class DebugStream {
+class MapTel {
 
     private:
 
-        const Integer MIN_DEBUG_LEVEL;
+        /** identificator; */
+        Integer id;
 
-    public:
+        /** arena of pages of the tables and chunks of views or NULL
+         *  while the tables are small and take pages from the heap
+         *  (see useArena(); pages shared with clones keep their
+         *  arenas alive); */
+        TelArena* arena;
 
-        static const String LIB_NAME;
+        /** true if the arena is backed by huge pages; */
+        const bool huge_pages;
 
-        DebugStream(Integer min_debug);
+        /** number of transformations from which new pages of the
+         *  tables are allocated from `arena`; */
+        static const size_t ARENA_THRESHOLD = 4096;
 
-        template<typename T>
-        friend DebugStream& operator<<(DebugStream& ds, const T& message);
+        /** transformation from a single source (numbers in tables
+         *  are packed, see TelNumber); */
+        struct Transform {
+            /** the destination; */
+            TelNumber destination;
+            /** true if the chain of transformations starting
+             *  in the source leads to a cycle; */
+            bool cyclic;
+            /** next source of a transformation to `destination`
+             *  (the empty number ends the list, see `predecessors`); */
+            TelNumber next_source;
+        };
 
-        friend DebugStream& operator<<
-            (DebugStream& ds, std::ostream& (*message_fun)(std::ostream&));
-};
+        typedef CowTable<TelNumber, Transform, TelNumberHash> TelTable;
 
-/* The basic idea of DebugStream class and functions:
- * debug_info(), debug_warn() and debug_err()
- * is to manage diagnostic messages in a friendly
- * (for people reading the code) and flexible way.
- * (We can change mininal debuglevel of all warnings
- * just by changing two integer values if debug_warn()). */
+        /** transformations (source -> destination), shared with
+         *  clones (see clone()); */
+        TelTable tel_transforms;
 
-/** Name of current library displayed with every diagnostic info. */
-const String DebugStream::LIB_NAME = " libmaptel -> ";
+        typedef CowTable<TelNumber, TelNumber, TelNumberHash> Predecessors;
 
-/** Error and warnings handling implementation. */
+        /** first source of transformations to each destination, the
+         *  others follow it linked by `next_source` (so `tel_transforms`
+         *  reversed lives in the pages of the tables, see nextSource()),
+         *  used to find chains going through a number (see
+         *  invalidate()), to keep `cyclic` flags up to date and for
+         *  sourcesOf() and preimage(); */
+        Predecessors predecessors;
 
-DebugStream::DebugStream(Integer min_debug = 0)
-    : MIN_DEBUG_LEVEL(min_debug)
-{
-}
+        /** guards `tel_transforms` (shared for queries,
+         *  exclusive for modifications); */
+        mutable RWLock lock;
 
-template<typename T>
-DebugStream& operator<<(DebugStream& ds, const T& message)
-{
-    if(DEBUG_LEVEL >= ds.MIN_DEBUG_LEVEL)
-        std::cerr << message;
-    return ds;
-}
+        /** memoized result of transformEx() for a single source; */
+        struct Resolution {
+            /** the result of transformEx(); */
+            TelNumber destination;
+            /** true if the chain leads to a cycle; */
+            bool cyclic;
+        };
 
-DebugStream& operator<<
-    (DebugStream& ds, std::ostream& (*message_fun)(std::ostream&))
-{
-    if(DEBUG_LEVEL >= ds.MIN_DEBUG_LEVEL)
-        std::cerr << message_fun;
-    return ds;
-}
+        /** memoized transformEx() results of sources having
+         *  a transformation; whole chains are memoized at once, so
+         *  the transformation of a memoized number leads to a memoized
+         *  number or to one having no transformation (see
+         *  invalidate()); */
+        mutable HashTable<TelNumber, Resolution, TelNumberHash> resolved;
 
-DebugStream& debug_info()
-{
-    static DebugStream info_stream = DebugStream(2);
-        if(DEBUG_LEVEL >= 2)
-            std::cerr << "(II)" << DebugStream::LIB_NAME;
-    return info_stream;
-}
+        /** guards `resolved` when it is filled under shared `lock`
+         *  (exclusive `lock` is enough for invalidating it); */
+        mutable RWLock resolved_lock;
 
-DebugStream& debug_warn()
-{
-    static DebugStream warning_stream = DebugStream(2);
-        if(DEBUG_LEVEL >= 2)
-            std::cerr << "(WW)" << DebugStream::LIB_NAME;
-    return warning_stream;
-}
+        /** size of a chunk of text of views; */
+        static const size_t VIEW_CHUNK = 4096;
 
-DebugStream& debug_err()
-{
-    static DebugStream error_stream = DebugStream(2);
-        if(DEBUG_LEVEL >= 2)
-            std::cerr << "(EE)" << DebugStream::LIB_NAME;
-    return error_stream;
-}
+        /** chunk of text of views; */
+        struct ViewChunk {
+            char* text;
+            size_t size;
+            /** arena holding the chunk (`arena`, which outlives
+             *  the views) or NULL for the heap; */
+            TelArena* arena;
+        };
 
-class MapTel {
+        /** '\0' terminated digits of numbers given out by
+         *  transformView() and transformExView(): text of a long
+         *  number (pinned by the key) or a copy in `view_chunks`
+         *  of a packed one; valid until dropViews(); */
+        mutable HashTable<TelNumber, const char*, TelNumberHash> views;
 
-    private:
+        /** chunks holding copies of packed numbers of `views`; */
+        mutable std::vector<ViewChunk> view_chunks;
 
-        /** identificator; */
-        Integer id;
+        /** number of used bytes of the last chunk; */
+        mutable size_t view_used;
+
+        /** guards `views`, `view_chunks` and `view_used` (they are
+         *  filled by queries, also of frozen maptels); */
+        mutable RWLock views_lock;
+
+        /** read only snapshot answering all queries instead of
+         *  the tables above (which are empty then) or NULL;
+         *  the first modification thaws it; */
+        TelSnapshot* snapshot;
+
+        /** frozen transformations answering all queries instead of
+         *  the tables above and `snapshot` (which are empty then) or
+         *  NULL; set once by freeze() and never changed, so queries
+         *  of a frozen maptel do not lock it (see getFrozen()); */
+        TelFrozen* frozen;
+
+        /** lock striped transformations answering insert(), erase()
+         *  and queries instead of the tables above (which are empty
+         *  then) without locking the maptel, or NULL; set by the
+         *  constructor of a maptel created with concurrent writes
+         *  and never changed; the first call of another operation
+         *  settles it into `tel_transforms` (see settle()); */
+        TelStriped* striped;
+
+        /** true if modifications publish `published` (see
+         *  MAPTEL_READ_MOSTLY); set by the constructors only; */
+        bool read_mostly;
+
+        typedef CowTable<TelNumber, TelNumber, TelNumberHash> Finals;
+
+        /** transformEx() of sources of acyclic chains of
+         *  `tel_transforms`, kept up to date by modifications of
+         *  a read mostly maptel (see updateFinals()) unless
+         *  `stale_finals`; */
+        Finals finals;
+
+        /** true if `finals` must be rebuilt before publishing; bulk
+         *  modifications set it, so they rebuild it once in linear
+         *  time instead of updating it for every transformation; */
+        bool stale_finals;
+
+        /** transformations published for readers of a read mostly
+         *  maptel; the tables share their pages with `tel_transforms`
+         *  and `finals`, so publishing takes constant time and
+         *  a modification copies only the pages it writes; */
+        struct Version {
+            TelTable transforms;
+            Finals finals;
+        };
+
+        /** read only version of the transformations (see publish())
+         *  answering queries of a read mostly maptel without locking
+         *  it, or NULL (for frozen maptels, ones with prefix rules
+         *  and ones which are not read mostly); */
+        Version* published;
+
+        /** prefix rules (applied to numbers without transformation,
+         *  the longest matching prefix is replaced); */
+        DigitTrie prefix_rules;
+
+        /** length of the longest number ever inserted (a bound
+         *  for chains of prefix rules, see walk()); */
+        size_t longest_number;
+
+        /** journal of modifications or NULL; */
+        TelJournal* journal;
+
+        /** number of open handles (guarded by the registry lock);
+         *  the maptel is destroyed when it is deleted and
+         *  it has no handles; */
+        unsigned long handles;
+
+        /** false after the maptel has been deleted
+         *  (guarded by the registry lock); */
+        bool registered;
+
+        /** holds shared `lock` for a query of a maptel which is not
+         *  frozen; */
+        class QueryGuard;
+
+        /** returns `frozen` (may be called without `lock`); */
+        const TelFrozen* getFrozen() const;
+
+        /** returns `published` (may be called without `lock`; the
+         *  caller must hold TelEpoch::Pin as long as it uses it); */
+        const Version* getPublished() const;
+
+        /** replaces `published` of a read mostly maptel with a copy
+         *  of the current tables and retires the old one (must hold
+         *  exclusive `lock`); */
+        void publish();
+
+        /** frees a version retired by publish(); */
+        static void disposeVersion(void* version);
+
+        /** sets `finals` of `number` and of the numbers leading to it
+         *  after the transformation from `number` has changed (must
+         *  hold exclusive `lock`; does nothing unless the maptel is
+         *  read mostly and `finals` are up to date); */
+        void updateFinals(const TelNumber& number);
+
+        /** rebuilds `finals` in linear time (must hold exclusive
+         *  `lock`); */
+        void rebuildFinals();
+
+        /** copy of the transformations of `snapshot` or
+         *  `tel_transforms` with their transformEx() results (must
+         *  hold `lock`); */
+        TelFrozen* buildImage() const;
+
+        /** true if the maptel is not frozen, otherwise reports
+         *  that `operation` is not allowed; */
+        bool checkModifiable(const char* operation) const;
+
+        /** how walkChain() stopped; */
+        enum ChainEnd {
+            /** at a number without transformation; */
+            CHAIN_ENDED,
+            /** at the number the chain enters its cycle at; */
+            CHAIN_CYCLIC,
+            /** after the maximal number of hops; */
+            CHAIN_CUT
+        };
+
+        /** `max_hops` of walkChain() which never cuts a chain; */
+        static const unsigned long NO_HOP_LIMIT = ~0UL;
+
+        /** follows the chain of numbers from `source`, where
+         *  `step(number, next)` sets `next` to the number following
+         *  `number` or returns false if there is none, in constant
+         *  memory (Brent's cycle detection) and sets `destination`
+         *  to the number the chain stops at; a chain longer than
+         *  `max_hops` hops (a cyclic one too) is cut after exactly
+         *  `max_hops` hops, unless it is NO_HOP_LIMIT; */
+        template<typename Number, typename Step>
+        static ChainEnd walkChain(const Number& source, Step& step,
+                                  unsigned long max_hops,
+                                  Number& destination);
+
+        /** step of walkChain() over `tel_transforms`
+         *  (numbers are references into the table); */
+        struct TableStep;
+
+        /** step of walkChain() over `frozen`; */
+        struct FrozenStep;
+
+        /** step of walkChain() using nextNumber(); */
+        struct RuleStep;
+
+        /** step of walkChain() over `striped`; */
+        struct StripedStep;
+
+        /** walkChain() from `source` over `striped` (setting `end` and
+         *  `destination`); false if `striped` is NULL or settled
+         *  (the chain has to be followed in the other tables); */
+        bool walkStriped(const String& source, unsigned long max_hops,
+                         ChainEnd& end, String& destination) const;
+
+        /** moves transformations of `striped` (unless it is NULL or
+         *  settled) to `tel_transforms` and rebuilds its index;
+         *  called first by every operation which `striped` cannot
+         *  answer (queries too: only the representation of the
+         *  transformations changes); */
+        void settle() const;
+
+        /** follows transformations from `source` (must hold `lock`);
+         *  `path` receives visited numbers in order and `cycle_start`
+         *  index of the number in `path` to which the last number
+         *  leads (path.size() if the last number has
+         *  no transformation); */
+        void followChain(const TelNumber& source,
+                         std::vector<TelNumber>& path,
+                         size_t& cycle_start) const;
+
+        /** memoizes resolutions of all numbers on `path` (as returned
+         *  by followChain()) and returns one of `source`; */
+        Resolution memoize(const std::vector<TelNumber>& path,
+                           size_t cycle_start) const;
+
+        /** true if chain of transformations from `source` reaches
+         *  `target` (must hold `lock`); */
+        bool reaches(const TelNumber& source, const TelNumber& target) const;
+
+        /** sets `cyclic` flag of all numbers which lead to `number`
+         *  and have this flag different from `cyclic` (must hold
+         *  exclusive `lock`); */
+        void markPreimage(const TelNumber& number, bool cyclic);
 
-        /** map; */
-        std::map<String, String> tel_transforms;
+        /** makes `source` the first source of `destination` in `index`
+         *  and returns the previous first one (the empty number if
+         *  there was none), the `next_source` of `source`; */
+        static TelNumber pushSource(Predecessors& index,
+                                    const TelNumber& destination,
+                                    const TelNumber& source);
 
-        /** returns next not used id; */
-        static Integer& getNextId();
+        /** returns the source following `source` on the list of
+         *  sources of its destination linked in `links` or NULL if it
+         *  is the last one (valid until `links` is modified); */
+        static const TelNumber* nextSource(const TelTable& links,
+                                           const TelNumber& source);
 
-        /** returns list of deleted and unallocated ids; */
-        static std::list<Integer>& getFreeIdsList();
+        /** removes `source`, which has a transformation, from
+         *  the sources of its destination (the transformation stays
+         *  in `tel_transforms`); */
+        void unlinkPredecessor(const TelNumber& source);
+
+        /** forgets memoized resolutions of chains going through
+         *  `source`, walking `predecessors` from it (must be called
+         *  with exclusive `lock`, before changing transformation from
+         *  `source`); */
+        void invalidate(const TelNumber& source);
+
+        /** creates `arena` (once) for the tables, if they are about
+         *  to hold `count` transformations, ARENA_THRESHOLD or more
+         *  (must be called with exclusive `lock`); */
+        void useArena(size_t count);
+
+        /** rebuilds `predecessors` and `cyclic` flags of all
+         *  transformations in linear time (must hold exclusive
+         *  `lock`, memoized resolutions must be empty); */
+        void rebuildIndex();
+
+        /** fills `index` as `predecessors` and `links` with the
+         *  transformations linking its lists (sources of
+         *  transformations to `destination` only, unless it is NULL)
+         *  scanning all transformations of a frozen or snapshot
+         *  maptel, which keeps no `predecessors` (must hold `lock`); */
+        void scanPredecessors(const TelNumber* destination,
+                              Predecessors& index, TelTable& links) const;
+
+        /** minimal number of transformations resolved by one thread
+         *  (see resolveTable()); */
+        static const size_t MIN_RESOLVE_COUNT = 1 << 16;
+
+        /** work of a single thread of resolveTable(); */
+        struct ResolveTask;
+
+        /** statistics of a graph of transformations computed
+         *  by resolveTable(), numbers are given by their indexes; */
+        struct Analysis {
+            /** `length_counts[k]` is the number of transformations
+             *  whose chains use k transformations; */
+            std::vector<size_t> length_counts;
+            /** number of transformations from numbers which are
+             *  not destinations of any transformation; */
+            size_t chains;
+            /** number of transformations leading to cycles; */
+            size_t cyclic_sources;
+            /** transformation starting the longest chain (the first
+             *  one of them) and the length of the chain; */
+            size_t longest;
+            size_t longest_length;
+            /** members of every cycle in order of transformations; */
+            std::vector<std::vector<size_t> > cycles;
+        };
+
+        /** computes transformEx() of all transformations in linear
+         *  time: `finals[i]` is the result for the transformation
+         *  at index i of `tel_transforms`; up to `threads` threads
+         *  (0: one per processor) resolve independent components
+         *  of the graph of transformations (must hold `lock`); */
+        void resolveAll(std::vector<const TelNumber*>& finals,
+                        size_t threads) const;
+
+        /** resolveAll() of `transforms`, also filling `analysis`
+         *  if it is not NULL; */
+        static void resolveTable(const TelTable& transforms, size_t threads,
+                                 std::vector<const TelNumber*>& finals,
+                                 Analysis* analysis);
+
+        /** pthread entry point finding indexes of destinations
+         *  of a range of transformations; */
+        static void* indexDestinationsThread(void* task);
+
+        /** pthread entry point resolving components of a task; */
+        static void* resolveComponentsThread(void* task);
+
+        /** runs `thread` for every task (in parallel if possible); */
+        static void runResolveTasks(void* (*thread)(void*),
+                                    std::vector<ResolveTask>& tasks);
+
+        /** fills empty tables with transformations of `image`
+         *  (must hold exclusive `lock`); */
+        void copySnapshot(const TelSnapshot& image);
+
+        /** replaces `snapshot` with its copy in `tel_transforms`
+         *  (must hold exclusive `lock`); */
+        void thaw();
+
+        /** insert() without locking (must hold exclusive `lock`); */
+        void insertLocked(const String& source, const String& destination);
+
+        /** erase() without locking (must hold exclusive `lock`); */
+        void eraseLocked(const String& source);
+
+        /** sets `next` to transformation of `number` by an exact
+         *  or prefix rule; false if there is none (must hold `lock`); */
+        bool nextNumber(const String& number, String& next) const;
+
+        /** follows transformations from `source` using both exact
+         *  and prefix rules (must hold `lock`); sets `destination`
+         *  and `cyclic` as transformEx() and isCyclic() would; chains
+         *  of prefix rules making numbers longer and longer are
+         *  cyclic (when a number gets MAX_STR_LENGTH digits longer
+         *  than both `source` and every inserted number); */
+        void walk(const String& source, String& destination,
+                  bool& cyclic) const;
+
+        /** insertPrefix() without locking (must hold exclusive `lock`); */
+        void insertPrefixLocked(const String& prefix,
+                                const String& destination);
+
+        /** erasePrefix() without locking (must hold exclusive `lock`); */
+        void erasePrefixLocked(const String& prefix);
+
+        /** save() without locking (must hold `lock`); */
+        bool saveLocked(const char* path) const;
+
+        /** transform() without locking (must hold `lock`);
+         *  returns reference to `source` or to `buffer` (which
+         *  receives the destination); */
+        const String& transformLocked(const String& source,
+                                      String& buffer) const;
+
+        /** transformEx() without locking (must hold `lock`); */
+        String transformExLocked(const String& source) const;
+
+        /** transformEx() by `version` (as published, see publish())
+         *  into `destination`; false if the chain from `source` is
+         *  cyclic, which transformExLocked() reports; */
+        static bool transformExPublished(const Version& version,
+                                         const String& source,
+                                         String& destination);
+
+        /** transformEx() of `key` by `tel_transforms` (must hold
+         *  `lock`, without prefix rules); the destination is `key`
+         *  if it has no transformation; */
+        Resolution resolveLocked(const TelNumber& key) const;
+
+        /** returns '\0' terminated digits of `number` valid until
+         *  dropViews() (must hold `lock`); `held` tells that the
+         *  tables hold `number` until their next modification,
+         *  so the text of a long number needs no pinning; */
+        const char* viewOf(const TelNumber& number, bool held) const;
+
+        /** forgets all views (must hold exclusive `lock`); */
+        void dropViews();
+
+        /** position of a maptel in the registry; an id is index
+         *  of its slot (low half of bits) and the slot's generation
+         *  (high half), which changes when the maptel is deleted,
+         *  so stale ids are detected; `maptel` and `generation` are
+         *  stored atomically (they are read without locks, see
+         *  findMapTel()); */
+        struct Slot {
+            /** the maptel or NULL if the slot is free; */
+            MapTel* maptel;
+            /** generation of the slot; */
+            Integer generation;
+            /** index of the next free slot (NO_SLOT ends the list); */
+            Integer next_free;
+        };
+
+        /** number of bits of slot index in ids; */
+        static const unsigned INDEX_BITS = sizeof(Integer) * 4;
+
+        /** number of slots of the first chunk of the registry
+         *  (a power of two, see Registry); */
+        static const Integer FIRST_SLOTS = 64;
+
+        /** slots of all maptels, kept in chunks which are never
+         *  moved (so they are read without locks): chunk k holds
+         *  FIRST_SLOTS << k slots; maptels which have not been
+         *  deleted are destroyed with the registry (at exit),
+         *  so their journals are committed; */
+        struct Registry {
+            /** allocated chunks (the rest is NULL); */
+            Slot* chunks[INDEX_BITS + 1];
+            /** number of slots in use (published after their
+             *  chunk); */
+            Integer count;
+            /** returns slot of given index (below `count`); */
+            Slot& at(Integer index);
+            ~Registry();
+        };
+
+        /** mask of slot index in ids; */
+        static const Integer INDEX_MASK = (Integer(1) << INDEX_BITS) - 1;
+
+        /** end of the list of free slots; */
+        static const Integer NO_SLOT = ~Integer(0);
+
+        /** returns index of the first free slot (or NO_SLOT);
+         *  free slots are chained by `next_free`, so no memory
+         *  is allocated when ids are recycled; */
+        static Integer& getFreeSlot();
+
+        /** takes a free slot (or a new one) and returns its index
+         *  (must hold exclusive registry lock); */
+        static Integer newSlot();
 
     protected:
 
-        /** creates empty maptel; */
-        MapTel(Integer id);
+        /** creates empty maptel (`flags` of maptel_create_ex()); */
+        MapTel(Integer id, unsigned flags);
 
         /** checks if given number is correct; */
         static bool isCorrect(const String& number);
 
-        /** returns maptels map; */
-        static std::map<Integer, MapTel>& getMap();
+        /** returns registry of maptels (indexed by slot index); */
+        static Registry& getRegistry();
+
+        /** returns slot of given id or NULL if maptel does not exist
+         *  (must hold exclusive registry lock); */
+        static Slot* findSlot(Integer id);
 
-        /** returns next free id; */
-        static Integer shiftNextId();
+        /** returns maptel of given id or NULL if it does not exist
+         *  (without locks; the caller must hold TelEpoch::Pin as
+         *  long as it uses the maptel, see IdPin); */
+        static MapTel* findMapTel(Integer id);
+
+        /** disposes of maptel retired by retire(); */
+        static void destroy(void* maptel);
+
+        /** closes the journal and retires the maptel, which is
+         *  destroyed once no reader may hold it (the maptel must
+         *  not be in the registry and have no handles); */
+        void retire();
 
     public:
 
         /** copying constructor; */
         MapTel(const MapTel& copy);
 
+        /** returns lock serializing changes of the registry and ids
+         *  (creating, deleting, swapping maptels and their handles);
+         *  reads of the registry take no locks (see IdPin); */
+        static RWLock& getRegistryLock();
+
+        /** Pins maptel of `id` for the scope's lifetime: it is looked
+         *  up once (without locks), so exists(id) and getMapTel(id)
+         *  agree within the scope, and it is not destroyed before
+         *  the scope ends, even if it is deleted meanwhile. Every
+         *  function using exists() or getMapTel() must hold it as
+         *  long as it uses returned maptel. */
+        class IdPin {
+
+            private:
+
+                TelEpoch::Pin pin;
+
+                Integer id;
+
+                /** the maptel or NULL if it does not exist; */
+                MapTel* maptel;
+
+                /** pin of the calling thread in which this one
+                 *  is nested or NULL; */
+                IdPin* outer;
+
+                /** the innermost pin of the calling thread; */
+                static __thread IdPin* innermost;
+
+                IdPin(const IdPin& copy);
+                IdPin& operator=(const IdPin& copy);
+
+            public:
+
+                explicit IdPin(Integer id);
+
+                ~IdPin();
+
+                /** returns maptel of `id` pinned by the calling
+                 *  thread or looks it up (see findMapTel()) if `id`
+                 *  is not pinned; NULL if it does not exist; */
+                static MapTel* find(Integer id);
+
+        };
+
         /** true if maptel of given id exists; */
         static bool exists(Integer id);
 
         /** returns maptel of given id; */
         static MapTel& getMapTel(Integer id);
 
-        /** creates a new maptel; */
-        static MapTel& createMapTel();
+        /** creates a new maptel (see MapTel(Integer, unsigned)); */
+        static MapTel& createMapTel(unsigned flags);
+
+        /** creates a new maptel sharing all transformations with
+         *  maptel of given id (copied lazily, see CowTable);
+         *  NULL if it does not exist; */
+        static MapTel* cloneMapTel(Integer id);
+
+        /** exchanges maptels of given ids (ids are kept, so each id
+         *  refers to the other's transformations); false if either
+         *  does not exist; */
+        static bool swapMapTels(Integer first, Integer second);
 
         /** deletes maptel of given id; */
         static void deleteMapTel(Integer id);
 
+        /** pins maptel of given id until closeHandle(), even if it
+         *  is deleted in the meantime; NULL if it does not exist; */
+        static MapTel* openHandle(Integer id);
+
+        /** releases maptel pinned by openHandle(); */
+        static void closeHandle(MapTel& maptel);
+
         /** returns maptel's id; */
         Integer getId() const;
 
@@ -178,6 +662,143 @@ class MapTel {
         /** gives transformation from given source (recursive); */
         String transformEx(const String& source) const;
 
+        /** writes '\0' terminated transform() of `length` characters
+         *  of `source` to `destination` if it fits in `size` bytes,
+         *  returns its length anyway; numbers are looked up by their
+         *  digits (only prefix rules and snapshots take strings); */
+        size_t transformInto(const char* source, size_t length,
+                             char* destination, size_t size) const;
+
+        /** the same as transformInto() but uses transformEx() (chains
+         *  of striped maptels are followed by strings); */
+        size_t transformExInto(const char* source, size_t length,
+                               char* destination, size_t size) const;
+
+        /** sets `destination` and `length` to '\0' terminated
+         *  transform() of `length` characters of `source` without
+         *  copying it; it is `source` itself if there is no
+         *  transformation, otherwise it is valid until the next
+         *  modification of the maptel or releaseViews(); */
+        void transformView(const char* source, size_t& length,
+                           const char*& destination) const;
+
+        /** the same as transformView() but uses transformEx(); */
+        void transformExView(const char* source, size_t& length,
+                             const char*& destination) const;
+
+        /** invalidates all results of transformView() and
+         *  transformExView(), freeing their memory; */
+        void releaseViews();
+
+        /** sets `destination` to transformEx() of `source` and
+         *  returns true if the chain ends within `max_hops` hops,
+         *  otherwise sets it to the number reached after `max_hops`
+         *  hops (the number a cyclic chain enters its cycle at
+         *  if `max_hops` is NO_HOP_LIMIT) and returns false; */
+        bool transformExBounded(const String& source,
+                                unsigned long max_hops,
+                                String& destination) const;
+
+        /** appends sources of transformations to `destination`
+         *  (prefix rules are not reversed) to `sources`; */
+        void sourcesOf(const String& destination,
+                       std::vector<String>& sources) const;
+
+        /** appends all sources whose chains of transformations pass
+         *  through `destination` (prefix rules are not reversed)
+         *  to `sources`; */
+        void preimage(const String& destination,
+                      std::vector<String>& sources) const;
+
+        /** calls `callback` for every source of a transformation
+         *  with its transformEx() (for a cyclic chain: the number
+         *  the chain enters its cycle at) and isCyclic(), in order
+         *  of the transformations, until it returns non zero; up to
+         *  `threads` threads (0: one per processor) resolve the
+         *  transformations first; returns the number of calls; */
+        size_t resolveEach(size_t threads, maptel_resolve_fn callback,
+                           void* arg) const;
+
+        /** statistics of chains of transformations (prefix rules
+         *  are not followed); */
+        struct Report {
+            size_t sources;
+            size_t chains;
+            size_t cyclic_sources;
+            std::vector<size_t> length_counts;
+            String longest_source;
+            size_t longest_length;
+            /** members of every cycle in order of transformations; */
+            std::vector<std::vector<String> > cycles;
+        };
+
+        /** fills `report` using up to `threads` threads (0: one per
+         *  processor); frozen and snapshot maptels are copied to
+         *  a temporary table first; */
+        void analyze(size_t threads, Report& report) const;
+
+        /** inserts prefix rule: numbers starting with `prefix`
+         *  (and having no exact transformation nor a rule of a longer
+         *  prefix) have it replaced with `destination`; */
+        void insertPrefix(const String& prefix, const String& destination);
+
+        /** erases prefix rule of given prefix; */
+        void erasePrefix(const String& prefix);
+
+        /** inserts `count` transformations:
+         *  `sources[i]` -> `destinations[i]`; */
+        void insertBatch(const char* const* sources,
+                         const char* const* destinations, size_t count);
+
+        /** erases transformations from `count` given sources; */
+        void eraseBatch(const char* const* sources, size_t count);
+
+        /** writes transform(`sources[i]`) to `destinations + i * len`
+         *  for all `count` sources; */
+        void transformBatch(const char* const* sources, char* destinations,
+                            size_t len, size_t count) const;
+
+        /** the same as transformBatch() but uses transformEx(); */
+        void transformExBatch(const char* const* sources, char* destinations,
+                              size_t len, size_t count) const;
+
+        /** inserts all transformations parsed from `file`
+         *  (in file order); returns their number; */
+        size_t load(const TelFile& file);
+
+        /** replaces transformations with a frozen table; every later
+         *  modification fails, queries do not lock the maptel; */
+        void freeze();
+
+        /** replaces all transformations with read only `image`
+         *  (an open snapshot, the maptel takes its ownership); */
+        void attachSnapshot(TelSnapshot* image);
+
+        /** writes snapshot of all transformations to file `path`;
+         *  returns false on I/O error; */
+        bool save(const char* path) const;
+
+        /** starts journaling modifications to file `path`
+         *  (see TelJournal); returns false on I/O error; */
+        bool openJournal(const char* path, size_t group_bytes,
+                         unsigned long group_usec);
+
+        /** commits journaled modifications; false on I/O error
+         *  or if there is no journal; */
+        bool syncJournal();
+
+        /** commits journaled modifications and stops journaling;
+         *  false on I/O error or if there is no journal; */
+        bool closeJournal();
+
+        /** saves snapshot to file `path` and drops journaled
+         *  modifications (they are in the snapshot then);
+         *  returns false on I/O error; */
+        bool checkpoint(const char* path);
+
+        /** applies journaled modifications (in order); */
+        void replay(const std::vector<TelJournal::Record>& records);
+
         /** the destructor; */
         virtual ~MapTel();
 
@@ -186,36 +807,75 @@ class MapTel {
 /** implementation: */
 
 
-Integer& MapTel::getNextId()
-{
-    /* `Integer` is always a base type, and because of that
-     * we don't need to allocate it dynamically here. */
-    static Integer next_id = 0;
-    return next_id;
-}
+const unsigned MapTel::INDEX_BITS;
 
-std::list<Integer>& MapTel::getFreeIdsList()
+const Integer MapTel::INDEX_MASK;
+
+const Integer MapTel::NO_SLOT;
+
+Integer& MapTel::getFreeSlot()
 {
-    /* The static object does not need to be allocated dynamically
-     * (aka via `new`), because it is not dependent on any other
-     * `static` object and any other `static` object depends
-     * on `unallocated_ids`. */
-    static std::list<Integer> unallocated_ids = std::list<Integer>();
-    return unallocated_ids;
+    static Integer free_slot = NO_SLOT;
+    return free_slot;
 }
 
-MapTel::MapTel(Integer id) : id(id)
+MapTel::MapTel(Integer id, unsigned flags)
+    : id(id), arena(NULL), huge_pages((flags & MAPTEL_HUGE_PAGES) != 0),
+      view_used(0), snapshot(NULL), frozen(NULL), striped(NULL),
+      read_mostly((flags & MAPTEL_READ_MOSTLY)
+                  && !(flags & MAPTEL_CONCURRENT_WRITES)),
+      stale_finals(false), published(NULL), longest_number(0),
+      journal(NULL), handles(0), registered(true)
 {
     debug_info() << "creating maptel of id = " << id << ".\n"
         << std::flush;
-    tel_transforms = std::map<String, String>();
+    if(flags & MAPTEL_CONCURRENT_WRITES)
+        striped = new TelStriped();
+    publish();
 }
 
-MapTel::MapTel(const MapTel& copy) : id(copy.getId())
+MapTel::MapTel(const MapTel& copy)
+    : id(copy.getId()), arena(NULL), huge_pages(copy.huge_pages),
+      view_used(0), snapshot(NULL), frozen(NULL), striped(NULL),
+      read_mostly(copy.read_mostly), stale_finals(false), published(NULL),
+      longest_number(0), journal(NULL), handles(0), registered(true)
 {
     debug_info() << "creating maptel of id = " << id << " (copy).\n"
         << std::flush;
-    tel_transforms = std::map<String, String>(copy.tel_transforms);
+    /* the clone is an ordinary maptel; */
+    copy.settle();
+    ReadGuard guard(copy.lock);
+    /* memoized resolutions, views and the journal are not copied,
+     * a snapshot or frozen table is copied to the mutable tables; */
+    const TelFrozen* image = copy.getFrozen();
+    if(image != NULL) {
+        useArena(image->getCount());
+        tel_transforms.reserve(image->getCount());
+        for(size_t i = 0; i < image->getCapacity(); i ++) {
+            const TelFrozen::Slot& slot = image->getSlot(i);
+            if(!(slot.flags & TelFrozen::USED))
+                continue;
+            Transform transform = {
+                slot.destination, (slot.flags & TelFrozen::CYCLIC) != 0 };
+            tel_transforms.insert(slot.source, transform);
+        }
+        rebuildIndex();
+    }
+    else if(copy.snapshot != NULL)
+        copySnapshot(*copy.snapshot);
+    else {
+        /* pages shared with `copy` stay in its arena (or on the
+         * heap), only pages written by the clone are allocated
+         * from its own one; */
+        tel_transforms = copy.tel_transforms;
+        predecessors = copy.predecessors;
+        finals = copy.finals;
+        stale_finals = copy.stale_finals;
+        useArena(tel_transforms.size());
+    }
+    prefix_rules = copy.prefix_rules;
+    longest_number = copy.longest_number;
+    publish();
 }
 
 bool MapTel::isCorrect(const String& number)
@@ -237,82 +897,353 @@ bool MapTel::isCorrect(const String& number)
     return (number.size() > 0);
 }
 
-std::map<Integer, MapTel>& MapTel::getMap()
+RWLock& MapTel::getRegistryLock()
+{
+    static RWLock registry_lock;
+    return registry_lock;
+}
+
+MapTel::Slot& MapTel::Registry::at(Integer index)
+{
+    /* chunk k starts at index (FIRST_SLOTS << k) - FIRST_SLOTS; */
+    Integer shifted = index + FIRST_SLOTS;
+    unsigned chunk = sizeof(Integer) * 8 - 1 - __builtin_clzl(shifted)
+        - (sizeof(Integer) * 8 - 1 - __builtin_clzl(FIRST_SLOTS));
+    return chunks[chunk][shifted - (FIRST_SLOTS << chunk)];
+}
+
+MapTel::Registry::~Registry()
+{
+    for(Integer i = 0; i < count; i ++)
+        delete at(i).maptel;
+}
+
+MapTel::Registry& MapTel::getRegistry()
 {
     /* The static object does not need to be allocated dynamically
      * (aka via `new`), because it is not dependent on any other
      * `static` object and any other `static` object depends
-     * on `maptels`. */
-    static std::map<Integer, MapTel> maptels = std::map<Integer, MapTel>();
-    return maptels;
+     * on `registry`. */
+    static Registry registry;
+    return registry;
 }
 
-Integer MapTel::shiftNextId()
+MapTel::Slot* MapTel::findSlot(Integer id)
 {
-    std::list<Integer>& unused = getFreeIdsList();
-    Integer next;
-    if(unused.empty())
-        next = getNextId() ++;
-    else {
-        next = unused.front();
-        unused.pop_front();
-    }
-    return next;
+    Registry& registry = getRegistry();
+    Integer index = id & INDEX_MASK;
+    if(index >= registry.count || registry.at(index).maptel == NULL
+       || registry.at(index).generation != (id >> INDEX_BITS))
+        return NULL;
+    return &registry.at(index);
+}
+
+MapTel* MapTel::findMapTel(Integer id)
+{
+    Registry& registry = getRegistry();
+    Integer index = id & INDEX_MASK;
+    if(index >= __atomic_load_n(&registry.count, __ATOMIC_ACQUIRE))
+        return NULL;
+    Slot& slot = registry.at(index);
+    /* deleteMapTel() clears `maptel` before it changes `generation`
+     * and newSlot() never reuses a slot with the old one, so
+     * a maptel loaded with a matching generation is the one
+     * of `id` (or it has been deleted, but not destroyed yet); */
+    MapTel* maptel = __atomic_load_n(&slot.maptel, __ATOMIC_ACQUIRE);
+    if(maptel == NULL
+       || __atomic_load_n(&slot.generation, __ATOMIC_ACQUIRE)
+          != (id >> INDEX_BITS))
+        return NULL;
+    return maptel;
+}
+
+__thread MapTel::IdPin* MapTel::IdPin::innermost = NULL;
+
+MapTel::IdPin::IdPin(Integer id)
+    : id(id), maptel(find(id)), outer(innermost)
+{
+    innermost = this;
+}
+
+MapTel::IdPin::~IdPin()
+{
+    innermost = outer;
+}
+
+MapTel* MapTel::IdPin::find(Integer id)
+{
+    for(IdPin* pin = innermost; pin != NULL; pin = pin->outer)
+        if(pin->id == id)
+            return pin->maptel;
+    return findMapTel(id);
 }
 
 bool MapTel::exists(Integer id)
 {
-    std::map<Integer,MapTel>::iterator it = getMap().find(id);
-    if(it == getMap().end())
+    bool found = (IdPin::find(id) != NULL);
+    if(!found)
         debug_err() << "maptel of id: " << id << " does not exist!\n"
             << std::flush;
-    return (it != getMap().end());
+    return found;
 }
 
 MapTel& MapTel::getMapTel(Integer id)
 {
-    std::map<Integer,MapTel>::iterator it = getMap().find(id);
-    if(it == getMap().end())
+    MapTel* maptel = IdPin::find(id);
+    if(maptel == NULL)
         debug_err() << "maptel of id: " << id << " does not exist!\n"
             << std::flush;
-    assert(it != getMap().end());
-    return it->second;
+    assert(maptel != NULL);
+    return *maptel;
 }
 
-MapTel& MapTel::createMapTel()
+MapTel& MapTel::createMapTel(unsigned flags)
 {
     debug_info() << "create: creating new maptel:\n";
-    std::map<Integer, MapTel>& maptels = getMap();
-    Integer id = shiftNextId();
-    maptels.insert(std::pair<Integer, MapTel>(id, MapTel(id)));
+    WriteGuard registry_guard(getRegistryLock());
+    Integer index = newSlot();
+    Slot& slot = getRegistry().at(index);
+    MapTel* maptel = new MapTel((slot.generation << INDEX_BITS) | index,
+                                flags);
+    /* publishes the constructed maptel to readers (see findMapTel()); */
+    __atomic_store_n(&slot.maptel, maptel, __ATOMIC_RELEASE);
     debug_info() << "create: end creating new maptel.\n" << std::flush;
-    return getMapTel(id);
+    return *maptel;
+}
+
+MapTel* MapTel::cloneMapTel(Integer id)
+{
+    debug_info() << "clone: cloning maptel of id = " << id << ":\n";
+    WriteGuard registry_guard(getRegistryLock());
+    Slot* source = findSlot(id);
+    if(source == NULL)
+        return NULL;
+    MapTel* clone = new MapTel(*source->maptel);
+    Integer index = newSlot();
+    Slot& slot = getRegistry().at(index);
+    clone->id = (slot.generation << INDEX_BITS) | index;
+    __atomic_store_n(&slot.maptel, clone, __ATOMIC_RELEASE);
+    debug_info() << "clone: end cloning maptel, id of the clone = "
+        << clone->id << ".\n" << std::flush;
+    return clone;
+}
+
+Integer MapTel::newSlot()
+{
+    Registry& registry = getRegistry();
+    Integer& free_slot = getFreeSlot();
+    Integer index;
+    if(free_slot != NO_SLOT) {
+        index = free_slot;
+        free_slot = registry.at(index).next_free;
+    }
+    else {
+        index = registry.count;
+        assert(index <= INDEX_MASK);
+        /* the chunks are full, the next one is twice as large
+         * as the last; */
+        Integer shifted = index + FIRST_SLOTS;
+        if((shifted & (shifted - 1)) == 0) {
+            Integer size = shifted;
+            Slot* chunk = new Slot[size];
+            for(Integer i = 0; i < size; i ++) {
+                Slot slot = { NULL, 0, NO_SLOT };
+                chunk[i] = slot;
+            }
+            unsigned chunk_index = 0;
+            while((FIRST_SLOTS << chunk_index) != size)
+                chunk_index ++;
+            registry.chunks[chunk_index] = chunk;
+        }
+        /* readers index only slots below `count`, so they see the
+         * slot's chunk; */
+        __atomic_store_n(&registry.count, index + 1, __ATOMIC_RELEASE);
+    }
+    registry.at(index).next_free = NO_SLOT;
+    return index;
+}
+
+bool MapTel::swapMapTels(Integer first, Integer second)
+{
+    debug_info() << "swap: swapping maptels of ids = " << first << ", "
+        << second << ":\n";
+    /* calls by id load the maptel of their id once (see IdPin), so
+     * they see one of the maptels as a whole, and take no locks;
+     * the exclusive lock orders only writers of the registry; */
+    WriteGuard registry_guard(getRegistryLock());
+    Slot* first_slot = findSlot(first);
+    Slot* second_slot = findSlot(second);
+    if(first_slot == NULL || second_slot == NULL)
+        return false;
+    MapTel* first_maptel = first_slot->maptel;
+    __atomic_store_n(&first_slot->maptel, second_slot->maptel,
+                     __ATOMIC_RELEASE);
+    __atomic_store_n(&second_slot->maptel, first_maptel, __ATOMIC_RELEASE);
+    /* handles pin maptels, not ids: a handle keeps querying the same
+     * transformations, so ids are read by its calls concurrently; */
+    __atomic_store_n(&first_slot->maptel->id, first, __ATOMIC_RELAXED);
+    __atomic_store_n(&second_slot->maptel->id, second, __ATOMIC_RELAXED);
+    debug_info() << "swap: end swapping maptels.\n" << std::flush;
+    return true;
 }
 
 void MapTel::deleteMapTel(Integer id)
 {
-    bool map_exists = exists(id);
-    if(!map_exists)
-        debug_err() << "erase: trying to delete maptel " << id
-            << " which does not exist.\n" << std::flush;
-    else
-        debug_info() << "erase: deleting maptel of id = " << id << ".\n"
-            << std::flush;
-    assert(map_exists);
-    if(map_exists) {
-        getMap().erase(id);
-        getFreeIdsList().push_back(id);
+    MapTel* retired = NULL;
+    {
+        WriteGuard registry_guard(getRegistryLock());
+        Slot* slot = findSlot(id);
+        bool map_exists = (slot != NULL);
+        if(!map_exists)
+            debug_err() << "erase: trying to delete maptel " << id
+                << " which does not exist.\n" << std::flush;
+        else
+            debug_info() << "erase: deleting maptel of id = " << id
+                << ".\n" << std::flush;
+        assert(map_exists);
+        if(!map_exists)
+            return;
+        /* a maptel with open handles lives until the last is closed; */
+        slot->maptel->registered = false;
+        if(slot->maptel->handles == 0)
+            retired = slot->maptel;
+        __atomic_store_n(&slot->maptel, static_cast<MapTel*>(NULL),
+                         __ATOMIC_RELEASE);
+        /* ids of the deleted maptel become stale; */
+        __atomic_store_n(&slot->generation,
+                         (slot->generation + 1) & INDEX_MASK,
+                         __ATOMIC_RELEASE);
+        slot->next_free = getFreeSlot();
+        getFreeSlot() = id & INDEX_MASK;
+    }
+    /* calls by id may still use the maptel (see IdPin); */
+    if(retired != NULL)
+        retired->retire();
+}
+
+MapTel* MapTel::openHandle(Integer id)
+{
+    WriteGuard registry_guard(getRegistryLock());
+    Slot* slot = findSlot(id);
+    if(slot == NULL)
+        return NULL;
+    slot->maptel->handles ++;
+    return slot->maptel;
+}
+
+void MapTel::closeHandle(MapTel& maptel)
+{
+    bool unused;
+    {
+        WriteGuard registry_guard(getRegistryLock());
+        assert(maptel.handles > 0);
+        maptel.handles --;
+        unused = (maptel.handles == 0 && !maptel.registered);
+    }
+    if(unused) {
+        debug_info() << "close: destroying deleted maptel of id = "
+            << maptel.getId() << ".\n" << std::flush;
+        /* calls by id which looked it up before it was deleted
+         * may still use it (see IdPin); */
+        maptel.retire();
+    }
+}
+
+void MapTel::retire()
+{
+    {
+        /* records are committed now, not when the maptel is
+         * destroyed (by a later retirement of any object); */
+        WriteGuard guard(lock);
+        delete journal;
+        journal = NULL;
     }
+    TelEpoch::retire(this, destroy);
+}
+
+void MapTel::destroy(void* maptel)
+{
+    delete static_cast<MapTel*>(maptel);
 }
 
 Integer MapTel::getId() const
 {
-    return this->id;
+    /* changed by swapMapTels() (see there); */
+    return __atomic_load_n(&this->id, __ATOMIC_RELAXED);
 }
 
 MapTel::~MapTel() {
     debug_info() << "erase: destroying maptel of id = " << getId()
         << ".\n" << std::flush;
+    dropViews();
+    delete snapshot;
+    delete frozen;
+    /* readers hold the maptel (by a handle or a pin), so none
+     * of them holds its copy; */
+    delete published;
+    delete striped;
+    delete journal;
+    /* entries of the tables own nothing unless some number is long,
+     * then pages held by the maptel only stay in the arena untouched
+     * (rather than destroying every entry); */
+    if(TelNumber::isPackable(longest_number)) {
+        tel_transforms.abandon();
+        predecessors.abandon();
+        finals.abandon();
+    }
+    /* the tables hold their own references (and so does every
+     * page), the chunks are freed with the last one; */
+    if(arena != NULL)
+        TelArena::release(arena);
+}
+
+/** Holds shared ownership of a maptel's lock for the scope's
+ *  lifetime, unless the maptel is frozen. */
+class MapTel::QueryGuard {
+
+    private:
+
+        const MapTel& maptel;
+
+        bool locked;
+
+        QueryGuard(const QueryGuard& copy);
+        QueryGuard& operator=(const QueryGuard& copy);
+
+    public:
+
+        explicit QueryGuard(const MapTel& maptel)
+            : maptel(maptel), locked(maptel.getFrozen() == NULL)
+        {
+            /* if the maptel is frozen in the meantime, the lock
+             * is simply held for nothing; */
+            if(locked)
+                maptel.lock.readLock();
+        }
+
+        ~QueryGuard()
+        {
+            if(locked)
+                maptel.lock.unlock();
+        }
+
+};
+
+const TelFrozen* MapTel::getFrozen() const
+{
+    /* pairs with the release store in freeze(): a query seeing
+     * the frozen table sees it filled; */
+    return __atomic_load_n(&frozen, __ATOMIC_ACQUIRE);
+}
+
+bool MapTel::checkModifiable(const char* operation) const
+{
+    if(getFrozen() == NULL)
+        return true;
+    debug_err() << "[id=" << getId() << "]" << operation
+        << ": maptel is frozen!\n" << std::flush;
+    assert(getFrozen() == NULL);
+    return false;
 }
 
 void MapTel::insert(const String& source, const String& destination)
@@ -321,263 +1252,3348 @@ void MapTel::insert(const String& source, const String& destination)
         << std::flush;
     assert(isCorrect(source));
     assert(isCorrect(destination));
-    std::map<String, String>::iterator it = tel_transforms.find(source);
-    if(it == tel_transforms.end())
+    if(striped != NULL
+       && striped->insert(TelNumber(source), TelNumber(destination)))
+        return;
+    WriteGuard guard(lock);
+    insertLocked(source, destination);
+    publish();
+}
+
+void MapTel::insertLocked(const String& source, const String& destination)
+{
+    if(!checkModifiable("insert"))
+        return;
+    if(snapshot != NULL)
+        thaw();
+    const TelNumber key(source);
+    const TelNumber value(destination);
+    const Transform* current = tel_transforms.find(key);
+    if(current == NULL)
         debug_info() << "inserting new transform: "
             << source << " -> " << destination << ".\n";
     else
         debug_info() << "changing transform "
             << "to: " << source << " -> " << destination << " ("
-            << "from: " << source << " -> " << it->second << ").\n"
+            << "from: " << source << " -> " << current->destination << ").\n"
             << std::flush;
-    tel_transforms[source] = destination;
+    if(current != NULL && current->destination == value)
+        return;
+    if(journal != NULL)
+        journal->append(TelJournal::INSERT, source, destination);
+    dropViews();
+    longest_number = std::max(longest_number,
+                              std::max(source.size(), destination.size()));
+    if(current == NULL)
+        useArena(tel_transforms.size() + 1);
+    invalidate(key);
+    bool was_cyclic = (current != NULL && current->cyclic);
+    if(current != NULL)
+        unlinkPredecessor(key);
+    /* The new transformation makes the chain from `source` cyclic
+     * iff the chain from `destination` reaches `source` (closing
+     * a new cycle) or it already led to a cycle. Old `cyclic` flags
+     * are valid for chains not going through `source`, and chains
+     * going through `source` had its flag, so the walk is needed
+     * only if both flags are equal and something leads to source. */
+    const Transform* next = tel_transforms.find(value);
+    bool cyclic = (next != NULL && next->cyclic);
+    if(value == key)
+        cyclic = true;
+    else if(cyclic == was_cyclic && predecessors.find(key) != NULL)
+        cyclic = cyclic || reaches(value, key);
+    Transform transform = { value, cyclic,
+                            pushSource(predecessors, value, key) };
+    tel_transforms.insert(key, transform);
+    if(cyclic != was_cyclic)
+        markPreimage(key, cyclic);
+    updateFinals(key);
 }
 
 void MapTel::erase(const String& source)
 {
     assert(isCorrect(source));
-    std::map<String, String>::iterator it = tel_transforms.find(source);
-    if(it == tel_transforms.end())
-        debug_warn() << "erase: source not found, doing nothing.\n"
-            << std::flush;
-    else
-        debug_info() << "erase: source found, erasing transformation: "
-            << source << " -> " << it->second << ".\n" << std::flush;
-    tel_transforms.erase(source);
+    if(striped != NULL) {
+        TelStriped::Lookup erased = striped->erase(TelNumber(source));
+        if(erased == TelStriped::MISSING)
+            debug_warn() << "erase: source not found, doing nothing.\n"
+                << std::flush;
+        if(erased != TelStriped::SETTLED)
+            return;
+    }
+    WriteGuard guard(lock);
+    eraseLocked(source);
+    publish();
 }
 
-String MapTel::transform(const String& source) const
+void MapTel::eraseLocked(const String& source)
 {
-    assert(isCorrect(source));
-    std::map<String, String>::const_iterator it = tel_transforms.find(source);
-    if(it == tel_transforms.end())
-        debug_info() << "transform: source not found, returning "
-            << "`ident` transformation: " << source << " -> " << source << ".\n"
+    if(!checkModifiable("erase"))
+        return;
+    if(snapshot != NULL)
+        thaw();
+    const TelNumber key(source);
+    const Transform* current = tel_transforms.find(key);
+    if(current == NULL) {
+        debug_warn() << "erase: source not found, doing nothing.\n"
             << std::flush;
-    else
-        debug_info() << "transform: source found, returning transformation: "
-            << source << " -> " << it->second << ".\n" << std::flush;
-    if(it != tel_transforms.end())
-        return it->second;
-    return String(source);
+        return;
+    }
+    debug_info() << "erase: source found, erasing transformation: "
+        << source << " -> " << current->destination << ".\n" << std::flush;
+    if(journal != NULL)
+        journal->append(TelJournal::ERASE, source, String());
+    dropViews();
+    invalidate(key);
+    bool was_cyclic = current->cyclic;
+    unlinkPredecessor(key);
+    tel_transforms.erase(key);
+    /* `source` ends chains now, so nothing leads to a cycle through it; */
+    if(was_cyclic)
+        markPreimage(key, false);
+    updateFinals(key);
 }
 
-bool MapTel::isCyclic(const String& source) const
+bool MapTel::reaches(const TelNumber& source, const TelNumber& target) const
 {
-    assert(isCorrect(source));
-    String current_source = String(source);
-    std::set<String> seen = std::set<String>();
-    std::set<String>::iterator seen_it;
-    std::map<String,String>::const_iterator maptel_it;
-    debug_info() << "isCyclic: checking cycle from source: " << source << ";\n"
-        << std::flush;
+    /* Floyd's cycle detection: when the fast walker meets the slow
+     * one, it has already visited every number of the chain; */
+    const TelNumber* slow = &source;
+    const TelNumber* fast = &source;
     while(true) {
-        seen_it = seen.find(current_source);
-        if(seen_it != seen.end()) {
-            debug_info() << "isCyclic: element " << current_source
-                << " was already seen;\n" << std::flush;
-            debug_info() << "isCyclic: cycle found;\n" << std::flush;
-            return true;
+        for(int step = 0; step < 2; step ++) {
+            if(*fast == target)
+                return true;
+            const Transform* next = tel_transforms.find(*fast);
+            if(next == NULL)
+                return false;
+            fast = &next->destination;
         }
-        seen.insert(current_source);
-        maptel_it = tel_transforms.find(current_source);
-        if(maptel_it != tel_transforms.end()) {
-            debug_info() << "isCyclic: transform: " << current_source << " -> "
-                << maptel_it->second << ";\n" << std::flush;
-            current_source = (*maptel_it).second;
-        }
-        else {
-            debug_info() << "isCyclic: transform: " << current_source
-                << " -> ... (none found);\n" << std::flush;
-            debug_info() << "isCyclic: cycle NOT found;\n" << std::flush;
+        slow = &tel_transforms.find(*slow)->destination;
+        if(*slow == *fast)
+            return (*fast == target);
+    }
+}
+
+void MapTel::markPreimage(const TelNumber& number, bool cyclic)
+{
+    debug_info() << "markPreimage: marking numbers leading to " << number
+        << " as " << (cyclic ? "" : "not ") << "cyclic;\n" << std::flush;
+    std::vector<TelNumber> pending(1, number);
+    while(!pending.empty()) {
+        const TelNumber* source = predecessors.find(pending.back());
+        pending.pop_back();
+        while(source != NULL) {
+            /* a copy, as modify() may copy the page holding `source`; */
+            const TelNumber current = *source;
+            const Transform* transform = tel_transforms.find(current);
+            assert(transform != NULL);
+            if(transform->cyclic != cyclic) {
+                tel_transforms.modify(current)->cyclic = cyclic;
+                pending.push_back(current);
+            }
+            source = nextSource(tel_transforms, current);
+        }
+    }
+}
+
+TelNumber MapTel::pushSource(Predecessors& index,
+                             const TelNumber& destination,
+                             const TelNumber& source)
+{
+    TelNumber* first = index.modify(destination);
+    if(first == NULL) {
+        index.insert(destination, source);
+        return TelNumber();
+    }
+    TelNumber next = *first;
+    *first = source;
+    return next;
+}
+
+const TelNumber* MapTel::nextSource(const TelTable& links,
+                                    const TelNumber& source)
+{
+    const Transform* transform = links.find(source);
+    assert(transform != NULL);
+    return transform->next_source.empty() ? NULL : &transform->next_source;
+}
+
+void MapTel::unlinkPredecessor(const TelNumber& source)
+{
+    const Transform* transform = tel_transforms.find(source);
+    assert(transform != NULL);
+    /* copies, as the pages holding them may be copied below; */
+    const TelNumber destination = transform->destination;
+    const TelNumber next = transform->next_source;
+    const TelNumber* first = predecessors.find(destination);
+    assert(first != NULL);
+    if(*first == source) {
+        if(next.empty())
+            predecessors.erase(destination);
+        else
+            *predecessors.modify(destination) = next;
+        return;
+    }
+    /* the list is singly linked, so it is walked to the source
+     * preceding `source` (sources of a number are usually few); */
+    TelNumber previous = *first;
+    while(true) {
+        const Transform* linked = tel_transforms.find(previous);
+        assert(linked != NULL && !linked->next_source.empty());
+        if(linked->next_source == source)
+            break;
+        previous = linked->next_source;
+    }
+    tel_transforms.modify(previous)->next_source = next;
+}
+
+String MapTel::transform(const String& source) const
+{
+    assert(isCorrect(source));
+    if(striped != NULL) {
+        TelNumber destination;
+        switch(striped->find(source.data(), source.size(), destination)) {
+            case TelStriped::FOUND:
+                return destination.toString();
+            case TelStriped::MISSING:
+                return source;
+            default:
+                break;
+        }
+    }
+    if(read_mostly) {
+        TelEpoch::Pin pin;
+        const Version* version = getPublished();
+        if(version != NULL) {
+            const Transform* transform =
+                version->transforms.findProbe(TelProbe(source));
+            return (transform == NULL)
+                ? source : transform->destination.toString();
+        }
+    }
+    QueryGuard guard(*this);
+    String buffer;
+    return transformLocked(source, buffer);
+}
+
+const String& MapTel::transformLocked(const String& source,
+                                      String& buffer) const
+{
+    if(getFrozen() != NULL || snapshot != NULL || !prefix_rules.empty())
+        return nextNumber(source, buffer) ? buffer : source;
+    const Transform* transform = tel_transforms.findProbe(TelProbe(source));
+    if(transform == NULL)
+        debug_info() << "transform: source not found, returning "
+            << "`ident` transformation: " << source << " -> " << source << ".\n"
+            << std::flush;
+    else
+        debug_info() << "transform: source found, returning transformation: "
+            << source << " -> " << transform->destination << ".\n"
+            << std::flush;
+    if(transform == NULL)
+        return source;
+    transform->destination.copyTo(buffer);
+    return buffer;
+}
+
+/** writes '\0' terminated `length` characters of `number` to
+ *  `destination` if they fit in `size` bytes, returns `length`; */
+static size_t writeDigits(const char* number, size_t length,
+                          char* destination, size_t size)
+{
+    if(length < size) {
+        memcpy(destination, number, length);
+        destination[length] = '\0';
+    }
+    return length;
+}
+
+/** writeDigits() of `number`; */
+static size_t writeDigits(const TelNumber& number, char* destination,
+                          size_t size)
+{
+    if(number.size() < size)
+        number.copyTo(destination);
+    return number.size();
+}
+
+size_t MapTel::transformInto(const char* source, size_t length,
+                             char* destination, size_t size) const
+{
+    assert(isCorrect(String(source, length)));
+    const TelProbe probe(source, length);
+    if(striped != NULL) {
+        TelNumber found;
+        switch(striped->find(source, length, found)) {
+            case TelStriped::FOUND:
+                return writeDigits(found, destination, size);
+            case TelStriped::MISSING:
+                return writeDigits(source, length, destination, size);
+            default:
+                break;
+        }
+    }
+    if(read_mostly) {
+        TelEpoch::Pin pin;
+        const Version* version = getPublished();
+        if(version != NULL) {
+            const Transform* transform = version->transforms.findProbe(probe);
+            return (transform == NULL)
+                ? writeDigits(source, length, destination, size)
+                : writeDigits(transform->destination, destination, size);
+        }
+    }
+    QueryGuard guard(*this);
+    const TelFrozen* image = getFrozen();
+    if(!prefix_rules.empty() || snapshot != NULL) {
+        String buffer;
+        const String number(source, length);
+        const String& next = transformLocked(number, buffer);
+        return writeDigits(next.data(), next.size(), destination, size);
+    }
+    if(image != NULL) {
+        const TelFrozen::Slot* slot = image->find(source, length);
+        return (slot == NULL)
+            ? writeDigits(source, length, destination, size)
+            : writeDigits(slot->destination, destination, size);
+    }
+    const Transform* transform = tel_transforms.findProbe(probe);
+    return (transform == NULL)
+        ? writeDigits(source, length, destination, size)
+        : writeDigits(transform->destination, destination, size);
+}
+
+bool MapTel::isCyclic(const String& source) const
+{
+    assert(isCorrect(source));
+    ChainEnd end;
+    String destination;
+    if(walkStriped(source, NO_HOP_LIMIT, end, destination))
+        return end == CHAIN_CYCLIC;
+    if(read_mostly) {
+        TelEpoch::Pin pin;
+        const Version* version = getPublished();
+        if(version != NULL) {
+            const Transform* transform =
+                version->transforms.findProbe(TelProbe(source));
+            return transform != NULL && transform->cyclic;
+        }
+    }
+    QueryGuard guard(*this);
+    const TelFrozen* image = getFrozen();
+    bool cyclic;
+    if(!prefix_rules.empty()) {
+        /* flags of transformations ignore prefix rules; */
+        String destination;
+        walk(source, destination, cyclic);
+    }
+    else if(image != NULL) {
+        const TelFrozen::Slot* slot = image->find(source.data(),
+                                                  source.size());
+        cyclic = (slot != NULL && (slot->flags & TelFrozen::CYCLIC));
+    }
+    else if(snapshot != NULL) {
+        size_t index = snapshot->find(source);
+        cyclic = (index != snapshot->getCount() && snapshot->isCyclic(index));
+    }
+    else {
+        const Transform* transform =
+            tel_transforms.findProbe(TelProbe(source));
+        cyclic = (transform != NULL && transform->cyclic);
+    }
+    debug_info() << "isCyclic: cycle from source " << source
+        << (cyclic ? " found" : " NOT found") << ";\n" << std::flush;
+    return cyclic;
+}
+
+void MapTel::insertPrefix(const String& prefix, const String& destination)
+{
+    debug_info() << "[id=" << getId() << "]insertPrefix: " << prefix
+        << "... -> " << destination << "...;\n" << std::flush;
+    assert(isCorrect(prefix));
+    assert(isCorrect(destination));
+    settle();
+    WriteGuard guard(lock);
+    insertPrefixLocked(prefix, destination);
+    publish();
+}
+
+void MapTel::insertPrefixLocked(const String& prefix,
+                                const String& destination)
+{
+    if(!checkModifiable("insertPrefix"))
+        return;
+    if(journal != NULL)
+        journal->append(TelJournal::INSERT, prefix, destination, true);
+    longest_number = std::max(longest_number,
+                              std::max(prefix.size(), destination.size()));
+    dropViews();
+    prefix_rules.insert(prefix, destination);
+}
+
+void MapTel::erasePrefix(const String& prefix)
+{
+    debug_info() << "[id=" << getId() << "]erasePrefix: " << prefix
+        << "...;\n" << std::flush;
+    assert(isCorrect(prefix));
+    settle();
+    WriteGuard guard(lock);
+    erasePrefixLocked(prefix);
+    publish();
+}
+
+void MapTel::erasePrefixLocked(const String& prefix)
+{
+    if(!checkModifiable("erasePrefix"))
+        return;
+    if(!prefix_rules.erase(prefix)) {
+        debug_warn() << "erasePrefix: prefix not found, doing nothing.\n"
+            << std::flush;
+        return;
+    }
+    if(journal != NULL)
+        journal->append(TelJournal::ERASE, prefix, String(), true);
+    dropViews();
+}
+
+bool MapTel::nextNumber(const String& number, String& next) const
+{
+    const TelFrozen* image = getFrozen();
+    if(image != NULL) {
+        const TelFrozen::Slot* slot = image->find(number.data(),
+                                                  number.size());
+        if(slot != NULL) {
+            slot->destination.copyTo(next);
+            return true;
+        }
+    }
+    else if(snapshot != NULL) {
+        size_t index = snapshot->find(number);
+        if(index != snapshot->getCount()) {
+            next.assign(snapshot->getDestination(index),
+                        snapshot->getDestinationLength(index));
+            return true;
+        }
+    }
+    else {
+        const Transform* transform =
+            tel_transforms.findProbe(TelProbe(number));
+        if(transform != NULL) {
+            transform->destination.copyTo(next);
+            return true;
+        }
+    }
+    size_t length;
+    const String* replacement = prefix_rules.longestMatch(number, length);
+    if(replacement == NULL)
+        return false;
+    debug_info() << "nextNumber: prefix rule " << number.substr(0, length)
+        << "... -> " << *replacement << "... applies to " << number
+        << ";\n" << std::flush;
+    next.assign(*replacement);
+    next.append(number, length, String::npos);
+    return true;
+}
+
+const unsigned long MapTel::NO_HOP_LIMIT;
+
+/** true if numbers given as references into tables are equal; */
+static bool sameNumber(const TelNumber* first, const TelNumber* second)
+{
+    return *first == *second;
+}
+
+static bool sameNumber(const String& first, const String& second)
+{
+    return first == second;
+}
+
+static bool sameNumber(const TelNumber& first, const TelNumber& second)
+{
+    return first == second;
+}
+
+template<typename Number, typename Step>
+MapTel::ChainEnd MapTel::walkChain(const Number& source, Step& step,
+                                   unsigned long max_hops,
+                                   Number& destination)
+{
+    /* The chain is walked up to three times. Steps over a table
+     * changed by concurrent writers (see StripedStep) may differ
+     * between the walks: a later walk which does not agree with
+     * the first one (ends or passes the meeting point) starts over
+     * (with a stable table, it never happens). */
+    while(true) {
+        /* Brent: `hare` walks the chain, `tortoise` waits at the number
+         * of the last hop being a power of two; `hare` meets it when
+         * the chain is cyclic and `power` exceeds the cycle's length; */
+        Number tortoise = source;
+        Number hare = source;
+        Number next = source;
+        unsigned long hops = 0;
+        unsigned long power = 1;
+        unsigned long cycle = 0;
+        while(true) {
+            if(!step(hare, next)) {
+                destination = hare;
+                return CHAIN_ENDED;
+            }
+            if(hops == max_hops) {
+                destination = hare;
+                return CHAIN_CUT;
+            }
+            std::swap(hare, next);
+            hops ++;
+            cycle ++;
+            if(sameNumber(tortoise, hare))
+                break;
+            if(cycle == power) {
+                tortoise = hare;
+                power *= 2;
+                cycle = 0;
+            }
+        }
+        /* `cycle` is the length of the cycle; a walker `cycle` hops
+         * ahead of the other meets it where the cycle starts; */
+        tortoise = source;
+        hare = source;
+        bool agrees = true;
+        for(unsigned long i = 0; agrees && i < cycle; i ++) {
+            agrees = step(hare, next);
+            std::swap(hare, next);
+        }
+        unsigned long start = 0;
+        while(agrees && !sameNumber(tortoise, hare)) {
+            agrees = (start < hops && step(tortoise, next));
+            std::swap(tortoise, next);
+            if(agrees) {
+                agrees = step(hare, next);
+                std::swap(hare, next);
+            }
+            start ++;
+        }
+        if(!agrees)
+            continue;
+        if(max_hops == NO_HOP_LIMIT) {
+            destination = tortoise;
+            return CHAIN_CYCLIC;
+        }
+        /* `max_hops` > `start` (the cycle was walked around before);
+         * go around the cycle as far as the remaining hops take; */
+        for(unsigned long i = (max_hops - start) % cycle;
+            agrees && i > 0;
+            i --) {
+            agrees = step(tortoise, next);
+            std::swap(tortoise, next);
+        }
+        if(!agrees)
+            continue;
+        destination = tortoise;
+        return CHAIN_CUT;
+    }
+}
+
+struct MapTel::TableStep {
+
+    const TelTable& transforms;
+
+    bool operator()(const TelNumber* number, const TelNumber*& next) const
+    {
+        const Transform* transform = transforms.find(*number);
+        if(transform == NULL)
+            return false;
+        next = &transform->destination;
+        return true;
+    }
+
+};
+
+struct MapTel::FrozenStep {
+
+    const TelFrozen& image;
+
+    bool operator()(const TelNumber* number, const TelNumber*& next) const
+    {
+        const TelFrozen::Slot* slot = image.find(*number);
+        if(slot == NULL)
+            return false;
+        next = &slot->destination;
+        return true;
+    }
+
+};
+
+struct MapTel::RuleStep {
+
+    const MapTel& maptel;
+
+    /** numbers longer than that are never reached by a finite
+     *  chain (see walk()); */
+    size_t limit;
+
+    /** set when a number gets longer than `limit`; */
+    bool grows;
+
+    bool operator()(const String& number, String& next)
+    {
+        if(!maptel.nextNumber(number, next))
             return false;
+        if(next.size() > limit) {
+            grows = true;
+            return false;
+        }
+        return true;
+    }
+
+};
+
+struct MapTel::StripedStep {
+
+    const TelStriped& table;
+
+    /** set when the table turns out to be settled; */
+    bool settled;
+
+    bool operator()(const TelNumber& number, TelNumber& next)
+    {
+        TelStriped::Lookup found = table.find(number, next);
+        if(found == TelStriped::SETTLED)
+            settled = true;
+        return found == TelStriped::FOUND;
+    }
+
+};
+
+bool MapTel::walkStriped(const String& source, unsigned long max_hops,
+                         ChainEnd& end, String& destination) const
+{
+    if(striped == NULL)
+        return false;
+    /* every hop is a lookup of its own, so the chain may change
+     * while it is followed; */
+    StripedStep step = { *striped, false };
+    TelNumber last;
+    /* a long number without transformation is not interned; */
+    if(!last.assignPacked(source.data(), source.size()))
+        switch(striped->find(source.data(), source.size(), last)) {
+            case TelStriped::SETTLED:
+                return false;
+            case TelStriped::MISSING:
+                end = CHAIN_ENDED;
+                destination = source;
+                return true;
+            default:
+                break;
+        }
+    end = walkChain(TelNumber(source), step, max_hops, last);
+    if(step.settled)
+        return false;
+    last.copyTo(destination);
+    return true;
+}
+
+void MapTel::settle() const
+{
+    if(striped == NULL || striped->isSettled())
+        return;
+    WriteGuard guard(lock);
+    if(striped->isSettled())
+        return;
+    /* the transformations stay the same, only their representation
+     * changes, so queries may settle the maptel too; */
+    MapTel& self = const_cast<MapTel&>(*this);
+    std::vector<TelStriped::Transformation> transformations;
+    striped->settle(transformations);
+    debug_info() << "[id=" << getId() << "]settle: "
+        << transformations.size() << " transformations;\n" << std::flush;
+    self.useArena(transformations.size());
+    self.tel_transforms.reserve(transformations.size());
+    for(size_t i = 0; i < transformations.size(); i ++) {
+        Transform transform = { transformations[i].destination, false };
+        self.tel_transforms.insert(transformations[i].source, transform);
+        self.longest_number = std::max(self.longest_number,
+            std::max(transformations[i].source.size(),
+                     transformations[i].destination.size()));
+    }
+    self.rebuildIndex();
+}
+
+void MapTel::walk(const String& source, String& destination,
+                  bool& cyclic) const
+{
+    RuleStep step = { *this, std::max(source.size(), longest_number)
+                                 + MAX_STR_LENGTH, false };
+    cyclic = (walkChain(source, step, NO_HOP_LIMIT, destination)
+              == CHAIN_CYCLIC);
+    if(step.grows) {
+        debug_warn() << "walk: chain from " << source
+            << " grows without end;\n" << std::flush;
+        cyclic = true;
+    }
+}
+
+void MapTel::followChain(const TelNumber& source,
+                         std::vector<TelNumber>& path,
+                         size_t& cycle_start) const
+{
+    TableStep step = { tel_transforms };
+    const TelNumber* last;
+    bool cyclic = (walkChain(&source, step, NO_HOP_LIMIT, last)
+                   == CHAIN_CYCLIC);
+    debug_info() << "followChain: chain from " << source
+        << (cyclic ? " enters its cycle at " : " ends at ") << *last
+        << ";\n" << std::flush;
+    /* the shape of the chain is known, so it is walked once more
+     * just to collect its numbers; */
+    const TelNumber* current = &source;
+    bool entered = false;
+    path.clear();
+    while(true) {
+        if(*current == *last) {
+            if(!cyclic) {
+                path.push_back(*current);
+                cycle_start = path.size();
+                return;
+            }
+            if(entered)
+                return;
+            entered = true;
+            cycle_start = path.size();
+        }
+        path.push_back(*current);
+        current = &tel_transforms.find(*current)->destination;
+    }
+}
+
+MapTel::Resolution MapTel::memoize
+    (const std::vector<TelNumber>& path, size_t cycle_start) const
+{
+    Resolution resolution;
+    size_t resolved_count;
+    if(cycle_start == path.size()) {
+        /* straight chain: the last number has no transformation
+         * (and is not memoized), every other number leads to it; */
+        resolution.destination = path.back();
+        resolution.cyclic = false;
+        resolved_count = path.size() - 1;
+    }
+    else {
+        /* numbers before the cycle lead to its first number,
+         * every number of the cycle leads to itself; */
+        resolution.destination = path[cycle_start];
+        resolution.cyclic = true;
+        resolved_count = path.size();
+    }
+    Resolution result = resolution;
+    if(resolved_count == 0)
+        return result;
+    if(cycle_start == 0)
+        result.destination = path[0];
+    WriteGuard guard(resolved_lock);
+    for(size_t i = 0; i < resolved_count; i ++) {
+        if(i >= cycle_start)
+            resolution.destination = path[i];
+        resolved.insert(path[i], resolution);
+    }
+    return result;
+}
+
+void MapTel::invalidate(const TelNumber& source)
+{
+    if(resolved.empty())
+        return;
+    /* Only chains going through `source` change: the ones of its
+     * preimage. A number (other than `source`, which may have no
+     * transformation yet) which is not memoized has no memoized
+     * predecessors, as they would have memoized their whole chains,
+     * so the walk stops at it: it visits forgotten numbers only. */
+    std::vector<TelNumber> pending(1, source);
+    size_t forgotten = resolved.erase(source) ? 1 : 0;
+    while(!pending.empty()) {
+        const TelNumber* source = predecessors.find(pending.back());
+        pending.pop_back();
+        for(; source != NULL; source = nextSource(tel_transforms, *source))
+            if(resolved.erase(*source)) {
+                pending.push_back(*source);
+                forgotten ++;
+            }
+    }
+    debug_info() << "invalidate: forgetting " << forgotten
+        << " resolutions of chains going through " << source << ";\n"
+        << std::flush;
+}
+
+String MapTel::transformEx(const String& source) const
+{
+    assert(isCorrect(source));
+    ChainEnd end;
+    String destination;
+    if(walkStriped(source, NO_HOP_LIMIT, end, destination)) {
+        if(end == CHAIN_CYCLIC)
+            debug_err() << "transformEx: cycle found!\n" << std::flush;
+        assert(end != CHAIN_CYCLIC);
+        return destination;
+    }
+    if(read_mostly) {
+        TelEpoch::Pin pin;
+        const Version* version = getPublished();
+        if(version != NULL && transformExPublished(*version, source,
+                                                   destination))
+            return destination;
+    }
+    QueryGuard guard(*this);
+    return transformExLocked(source);
+}
+
+bool MapTel::transformExPublished(const Version& version,
+                                  const String& source, String& destination)
+{
+    const TelProbe probe(source);
+    /* sources of acyclic chains are all in `finals`, so only other
+     * numbers are looked up among transformations; */
+    const TelNumber* final = version.finals.findProbe(probe);
+    if(final != NULL) {
+        final->copyTo(destination);
+        return true;
+    }
+    const Transform* transform = version.transforms.findProbe(probe);
+    if(transform != NULL) {
+        assert(transform->cyclic);
+        return false;
+    }
+    destination = source;
+    return true;
+}
+
+String MapTel::transformExLocked(const String& source) const
+{
+    debug_info() << "transformEx: checking path from: " << source << ";\n"
+        << std::flush;
+    if(!prefix_rules.empty()) {
+        /* memoized resolutions ignore prefix rules; */
+        String destination;
+        bool cyclic;
+        walk(source, destination, cyclic);
+        if(cyclic)
+            debug_err() << "transformEx: cycle found!\n" << std::flush;
+        assert(!cyclic);
+        return destination;
+    }
+    const TelFrozen* image = getFrozen();
+    if(image != NULL) {
+        /* frozen tables hold results of transformEx(); */
+        const TelFrozen::Slot* slot = image->find(source.data(),
+                                                  source.size());
+        if(slot == NULL)
+            return source;
+        if(slot->flags & TelFrozen::CYCLIC)
+            debug_err() << "transformEx: cycle found!\n" << std::flush;
+        assert(!(slot->flags & TelFrozen::CYCLIC));
+        return slot->final.toString();
+    }
+    if(snapshot != NULL) {
+        /* snapshots hold results of transformEx(); */
+        size_t index = snapshot->find(source);
+        if(index == snapshot->getCount())
+            return source;
+        if(snapshot->isCyclic(index))
+            debug_err() << "transformEx: cycle found!\n" << std::flush;
+        assert(!snapshot->isCyclic(index));
+        return String(snapshot->getFinal(index),
+                      snapshot->getFinalLength(index));
+    }
+    /* a long number without transformation is not interned; */
+    TelNumber key;
+    if(!key.assignPacked(source.data(), source.size())) {
+        size_t index = tel_transforms.indexOfProbe(TelProbe(source));
+        if(index == tel_transforms.size())
+            return source;
+        key = tel_transforms.at(index).key;
+    }
+    Resolution resolution = resolveLocked(key);
+    if(resolution.destination == key)
+        return source;
+    return resolution.destination.toString();
+}
+
+size_t MapTel::transformExInto(const char* source, size_t length,
+                               char* destination, size_t size) const
+{
+    assert(isCorrect(String(source, length)));
+    const TelProbe probe(source, length);
+    if(striped != NULL) {
+        const String final = transformEx(String(source, length));
+        return writeDigits(final.data(), final.size(), destination, size);
+    }
+    if(read_mostly) {
+        TelEpoch::Pin pin;
+        const Version* version = getPublished();
+        if(version != NULL) {
+            /* sources of cyclic chains are left to the locked path
+             * (see transformExPublished()); */
+            const TelNumber* final = version->finals.findProbe(probe);
+            if(final != NULL)
+                return writeDigits(*final, destination, size);
+            if(version->transforms.findProbe(probe) == NULL)
+                return writeDigits(source, length, destination, size);
+        }
+    }
+    QueryGuard guard(*this);
+    const TelFrozen* image = getFrozen();
+    if(!prefix_rules.empty() || snapshot != NULL) {
+        const String final = transformExLocked(String(source, length));
+        return writeDigits(final.data(), final.size(), destination, size);
+    }
+    if(image != NULL) {
+        const TelFrozen::Slot* slot = image->find(source, length);
+        if(slot == NULL)
+            return writeDigits(source, length, destination, size);
+        if(slot->flags & TelFrozen::CYCLIC)
+            debug_err() << "transformEx: cycle found!\n" << std::flush;
+        assert(!(slot->flags & TelFrozen::CYCLIC));
+        return writeDigits(slot->final, destination, size);
+    }
+    /* a long number without transformation is not interned; */
+    TelNumber key;
+    if(!key.assignPacked(source, length)) {
+        size_t index = tel_transforms.indexOfProbe(probe);
+        if(index == tel_transforms.size())
+            return writeDigits(source, length, destination, size);
+        key = tel_transforms.at(index).key;
+    }
+    Resolution resolution = resolveLocked(key);
+    return writeDigits(resolution.destination, destination, size);
+}
+
+MapTel::Resolution MapTel::resolveLocked(const TelNumber& key) const
+{
+    Resolution resolution;
+    bool found = false;
+    {
+        ReadGuard resolved_guard(resolved_lock);
+        const Resolution* memoized = resolved.find(key);
+        if(memoized != NULL) {
+            debug_info() << "transformEx: memoized resolution found;\n"
+                << std::flush;
+            resolution = *memoized;
+            found = true;
+        }
+    }
+    if(!found) {
+        if(tel_transforms.find(key) == NULL) {
+            debug_info() << "transformEx: final destination found: "
+                << key << "\n" << std::flush;
+            resolution.destination = key;
+            resolution.cyclic = false;
+            return resolution;
+        }
+        std::vector<TelNumber> path;
+        size_t cycle_start;
+        followChain(key, path, cycle_start);
+        resolution = memoize(path, cycle_start);
+    }
+    if(resolution.cyclic)
+        debug_err() << "transformEx: cycle found!\n" << std::flush;
+    assert(!resolution.cyclic);
+    debug_info() << "transformEx: final destination found: "
+        << resolution.destination << "\n" << std::flush;
+    return resolution;
+}
+
+const size_t MapTel::VIEW_CHUNK;
+
+const char* MapTel::viewOf(const TelNumber& number, bool held) const
+{
+    if(held && number.longText() != NULL)
+        return number.longText();
+    {
+        ReadGuard views_guard(views_lock);
+        const char* const* view = views.find(number);
+        if(view != NULL)
+            return *view;
+    }
+    WriteGuard views_guard(views_lock);
+    const char* const* view = views.find(number);
+    if(view != NULL)
+        return *view;
+    const char* text = number.longText();
+    if(text == NULL) {
+        /* packed digits have no text, they are copied once; */
+        size_t size = number.size() + 1;
+        if(view_chunks.empty() || view_used + size > view_chunks.back().size) {
+            ViewChunk chunk = { NULL, std::max(size, VIEW_CHUNK), arena };
+            view_chunks.reserve(view_chunks.size() + 1);
+            /* `arena` is set under exclusive `lock` (or is fixed in
+             * a frozen maptel), chunks are taken under `views_lock`; */
+            if(arena != NULL)
+                chunk.text = static_cast<char*>(arena->allocate(chunk.size));
+            else
+                chunk.text = new char[chunk.size];
+            view_chunks.push_back(chunk);
+            view_used = 0;
+        }
+        char* copy = view_chunks.back().text + view_used;
+        String digits;
+        number.copyTo(digits);
+        memcpy(copy, digits.c_str(), size);
+        view_used += size;
+        text = copy;
+    }
+    views.insert(number, text);
+    return text;
+}
+
+void MapTel::dropViews()
+{
+    WriteGuard views_guard(views_lock);
+    if(views.empty())
+        return;
+    debug_info() << "[id=" << getId() << "]dropViews: " << views.size()
+        << " views;\n" << std::flush;
+    views.clear();
+    for(size_t i = 0; i < view_chunks.size(); i ++)
+        if(view_chunks[i].arena != NULL)
+            view_chunks[i].arena->deallocate(view_chunks[i].text,
+                                             view_chunks[i].size);
+        else
+            delete[] view_chunks[i].text;
+    view_chunks.clear();
+    view_used = 0;
+}
+
+void MapTel::releaseViews()
+{
+    WriteGuard guard(lock);
+    dropViews();
+}
+
+void MapTel::transformView(const char* source, size_t& length,
+                           const char*& destination) const
+{
+    assert(isCorrect(String(source, length)));
+    settle();
+    QueryGuard guard(*this);
+    destination = source;
+    const TelFrozen* image = getFrozen();
+    if(!prefix_rules.empty()) {
+        String next;
+        if(nextNumber(String(source, length), next)) {
+            length = next.size();
+            destination = viewOf(TelNumber(next), false);
+        }
+    }
+    else if(image != NULL) {
+        const TelFrozen::Slot* slot = image->find(source, length);
+        if(slot != NULL) {
+            length = slot->destination.size();
+            destination = viewOf(slot->destination, true);
+        }
+    }
+    else if(snapshot != NULL) {
+        /* numbers of snapshots are '\0' terminated in the mapping; */
+        size_t index = snapshot->find(String(source, length));
+        if(index != snapshot->getCount()) {
+            length = snapshot->getDestinationLength(index);
+            destination = snapshot->getDestination(index);
+        }
+    }
+    else {
+        const Transform* transform =
+            tel_transforms.findProbe(TelProbe(source, length));
+        if(transform != NULL) {
+            length = transform->destination.size();
+            destination = viewOf(transform->destination, true);
+        }
+    }
+}
+
+void MapTel::transformExView(const char* source, size_t& length,
+                             const char*& destination) const
+{
+    assert(isCorrect(String(source, length)));
+    settle();
+    QueryGuard guard(*this);
+    destination = source;
+    const TelFrozen* image = getFrozen();
+    if(!prefix_rules.empty()) {
+        const String number(source, length);
+        String final = transformExLocked(number);
+        if(final != number) {
+            length = final.size();
+            destination = viewOf(TelNumber(final), false);
+        }
+    }
+    else if(image != NULL) {
+        const TelFrozen::Slot* slot = image->find(source, length);
+        if(slot != NULL && !(slot->final == slot->source)) {
+            if(slot->flags & TelFrozen::CYCLIC)
+                debug_err() << "transformEx: cycle found!\n" << std::flush;
+            assert(!(slot->flags & TelFrozen::CYCLIC));
+            length = slot->final.size();
+            destination = viewOf(slot->final, true);
+        }
+    }
+    else if(snapshot != NULL) {
+        size_t index = snapshot->find(String(source, length));
+        if(index != snapshot->getCount()) {
+            if(snapshot->isCyclic(index))
+                debug_err() << "transformEx: cycle found!\n" << std::flush;
+            assert(!snapshot->isCyclic(index));
+            length = snapshot->getFinalLength(index);
+            destination = snapshot->getFinal(index);
         }
     }
+    else {
+        TelNumber key;
+        if(!key.assignPacked(source, length)) {
+            size_t index = tel_transforms.indexOfProbe(TelProbe(source,
+                                                                length));
+            if(index == tel_transforms.size())
+                return;
+            key = tel_transforms.at(index).key;
+        }
+        Resolution resolution = resolveLocked(key);
+        if(!(resolution.destination == key)) {
+            length = resolution.destination.size();
+            destination = viewOf(resolution.destination, true);
+        }
+    }
+}
+
+bool MapTel::transformExBounded(const String& source, unsigned long max_hops,
+                                String& destination) const
+{
+    assert(isCorrect(source));
+    debug_info() << "transformExBounded: following at most " << max_hops
+        << " transformations from " << source << ";\n" << std::flush;
+    ChainEnd end;
+    if(walkStriped(source, max_hops, end, destination))
+        return end == CHAIN_ENDED;
+    QueryGuard guard(*this);
+    const TelFrozen* image = getFrozen();
+    if(!prefix_rules.empty() || (image == NULL && snapshot != NULL)) {
+        RuleStep step = { *this, std::max(source.size(), longest_number)
+                                     + MAX_STR_LENGTH, false };
+        end = walkChain(source, step, max_hops, destination);
+        if(step.grows)
+            end = CHAIN_CUT;
+    }
+    else {
+        /* numbers are never copied on the way; a long source
+         * is not interned, the walk starts at the source of its
+         * transformation; */
+        TelNumber key;
+        const TelNumber* first = &key;
+        const TelNumber* last;
+        bool packed = key.assignPacked(source.data(), source.size());
+        if(!packed && image != NULL) {
+            const TelFrozen::Slot* slot = image->find(source.data(),
+                                                      source.size());
+            first = (slot == NULL) ? NULL : &slot->source;
+        }
+        else if(!packed) {
+            size_t index = tel_transforms.indexOfProbe(TelProbe(source));
+            first = (index == tel_transforms.size())
+                ? NULL : &tel_transforms.at(index).key;
+        }
+        if(first == NULL) {
+            end = CHAIN_ENDED;
+            destination = source;
+        }
+        else if(image != NULL) {
+            FrozenStep step = { *image };
+            end = walkChain(first, step, max_hops, last);
+            last->copyTo(destination);
+        }
+        else {
+            TableStep step = { tel_transforms };
+            end = walkChain(first, step, max_hops, last);
+            last->copyTo(destination);
+        }
+    }
+    debug_info() << "transformExBounded: stopped at " << destination
+        << ((end == CHAIN_ENDED) ? " (the end of the chain)" : "")
+        << ";\n" << std::flush;
+    return end == CHAIN_ENDED;
+}
+
+void MapTel::useArena(size_t count)
+{
+    if(arena != NULL || count < ARENA_THRESHOLD)
+        return;
+    debug_info() << "[id=" << getId() << "]useArena: " << count
+        << " transformations.\n" << std::flush;
+    /* pages allocated so far stay on the heap; */
+    arena = TelArena::create(huge_pages);
+    tel_transforms.setArena(arena);
+    predecessors.setArena(arena);
+    finals.setArena(arena);
+}
+
+void MapTel::rebuildIndex()
+{
+    debug_info() << "[id=" << getId() << "]rebuildIndex: "
+        << tel_transforms.size() << " transformations;\n" << std::flush;
+    stale_finals = true;
+    predecessors.clear();
+    predecessors.reserve(tel_transforms.size());
+    for(size_t i = 0; i < tel_transforms.size(); i ++) {
+        const TelTable::Entry& entry = tel_transforms.at(i);
+        TelNumber next = pushSource(predecessors, entry.value.destination,
+                                    entry.key);
+        /* pages shared with clones are copied only if needed; */
+        if(entry.value.next_source != next)
+            tel_transforms.modifyAt(i).value.next_source = next;
+    }
+    /* Every transformation is visited once: a walk stops at a number
+     * without transformation, at a transformation visited by
+     * a previous walk (its flag is already known) or at one visited
+     * by this walk (the walk has closed a cycle). */
+    const char NOT_VISITED = 0;
+    const char ON_PATH = 1;
+    const char DONE = 2;
+    size_t count = tel_transforms.size();
+    std::vector<char> state(count, NOT_VISITED);
+    std::vector<size_t> path;
+    for(size_t first = 0; first < count; first ++) {
+        if(state[first] != NOT_VISITED)
+            continue;
+        bool cyclic;
+        size_t current = first;
+        path.clear();
+        while(true) {
+            if(current == count) {
+                cyclic = false;
+                break;
+            }
+            if(state[current] != NOT_VISITED) {
+                cyclic = (state[current] == ON_PATH)
+                    || tel_transforms.at(current).value.cyclic;
+                break;
+            }
+            state[current] = ON_PATH;
+            path.push_back(current);
+            current = tel_transforms.indexOf(
+                tel_transforms.at(current).value.destination);
+        }
+        for(size_t i = 0; i < path.size(); i ++) {
+            /* pages shared with clones are copied only if needed; */
+            if(tel_transforms.at(path[i]).value.cyclic != cyclic)
+                tel_transforms.modifyAt(path[i]).value.cyclic = cyclic;
+            state[path[i]] = DONE;
+        }
+    }
+}
+
+void MapTel::scanPredecessors(const TelNumber* destination,
+                              Predecessors& index, TelTable& links) const
+{
+    const TelFrozen* image = getFrozen();
+    size_t count = (image != NULL) ? image->getCapacity()
+        : (snapshot != NULL) ? snapshot->getCount() : 0;
+    /* slots of a frozen maptel come in the order of hashes of their
+     * sources, which would pile up in long runs of slots of a table
+     * growing as they are inserted; */
+    if(destination == NULL)
+        links.reserve((image != NULL) ? image->getCount() : count);
+    TelNumber source;
+    TelNumber target;
+    for(size_t i = 0; i < count; i ++) {
+        if(image != NULL) {
+            const TelFrozen::Slot& slot = image->getSlot(i);
+            if(!(slot.flags & TelFrozen::USED))
+                continue;
+            source = slot.source;
+            target = slot.destination;
+        }
+        else {
+            source.assign(snapshot->getSource(i),
+                          snapshot->getSourceLength(i));
+            target.assign(snapshot->getDestination(i),
+                          snapshot->getDestinationLength(i));
+        }
+        if(destination != NULL && target != *destination)
+            continue;
+        Transform transform = { target, false,
+                                pushSource(index, target, source) };
+        links.insert(source, transform);
+    }
+}
+
+void MapTel::sourcesOf(const String& destination,
+                       std::vector<String>& sources) const
+{
+    assert(isCorrect(destination));
+    settle();
+    QueryGuard guard(*this);
+    Predecessors scanned;
+    TelTable scanned_links;
+    const Predecessors* index = &predecessors;
+    const TelTable* links = &tel_transforms;
+    if(getFrozen() != NULL || snapshot != NULL) {
+        /* the scan makes TelNumbers of all numbers anyway; */
+        const TelNumber number(destination);
+        scanPredecessors(&number, scanned, scanned_links);
+        index = &scanned;
+        links = &scanned_links;
+    }
+    size_t found = 0;
+    for(const TelNumber* source = index->findProbe(TelProbe(destination));
+        source != NULL;
+        source = nextSource(*links, *source)) {
+        sources.push_back(source->toString());
+        found ++;
+    }
+    debug_info() << "sourcesOf: " << found << " sources of " << destination
+        << ";\n" << std::flush;
+}
+
+void MapTel::preimage(const String& destination,
+                      std::vector<String>& sources) const
+{
+    assert(isCorrect(destination));
+    settle();
+    QueryGuard guard(*this);
+    /* a frozen or snapshot maptel is scanned once for the whole
+     * query, otherwise the time is proportional to the result; */
+    Predecessors scanned;
+    TelTable scanned_links;
+    const Predecessors* index = &predecessors;
+    const TelTable* links = &tel_transforms;
+    if(getFrozen() != NULL || snapshot != NULL) {
+        scanPredecessors(NULL, scanned, scanned_links);
+        index = &scanned;
+        links = &scanned_links;
+    }
+    /* every number is reported (and followed) once, so a cycle
+     * through `destination` reports it too; */
+    HashTable<TelNumber, bool, TelNumberHash> visited;
+    std::vector<TelNumber> pending;
+    size_t found = 0;
+    /* `destination` is looked up by its digits (a long number
+     * without sources is not interned), numbers it leads from are
+     * taken from the index; */
+    const TelNumber* source = index->findProbe(TelProbe(destination));
+    while(true) {
+        for(; source != NULL; source = nextSource(*links, *source))
+            if(visited.insert(*source, true)) {
+                pending.push_back(*source);
+                sources.push_back(source->toString());
+                found ++;
+            }
+        if(pending.empty())
+            break;
+        source = index->find(pending.back());
+        pending.pop_back();
+    }
+    debug_info() << "preimage: " << found << " numbers lead to "
+        << destination << ";\n" << std::flush;
+}
+
+/** Work of a single thread of MapTel::resolveTable(). */
+struct MapTel::ResolveTask {
+    /** states of transformations; */
+    static const char NOT_VISITED = 0;
+    static const char ON_PATH = 1;
+    static const char DONE = 2;
+    const TelTable* transforms;
+    /** range of transformations for indexDestinationsThread(); */
+    size_t begin;
+    size_t end;
+    /** transformations whose components are resolved by
+     *  resolveComponentsThread() or NULL for all of them; */
+    const std::vector<size_t>* members;
+    /** index of the destination of every transformation (the number
+     *  of transformations if the destination has none); */
+    std::vector<size_t>* next;
+    std::vector<char>* state;
+    std::vector<const TelNumber*>* finals;
+    /** statistics of the task's components or NULL; */
+    Analysis* analysis;
+    /** lengths of chains and flags of transformations from numbers
+     *  being destinations (only for `analysis`); */
+    std::vector<size_t>* lengths;
+    std::vector<char>* has_predecessor;
+};
+
+const char MapTel::ResolveTask::NOT_VISITED;
+
+const char MapTel::ResolveTask::ON_PATH;
+
+const char MapTel::ResolveTask::DONE;
+
+const size_t MapTel::MIN_RESOLVE_COUNT;
+
+/** Deals weakly connected components of the graph of edges
+ *  i -> `next[i]` (`next[i]` equal to the number of vertices
+ *  is no edge) to `parts` lists of `members`, the largest ones
+ *  first to the list having the fewest members. */
+static void partitionComponents(const std::vector<size_t>& next,
+                                size_t parts,
+                                std::vector<std::vector<size_t> >& members)
+{
+    size_t count = next.size();
+    std::vector<size_t> parent(count);
+    std::vector<size_t> size(count, 1);
+    for(size_t i = 0; i < count; i ++)
+        parent[i] = i;
+    /* union-find with path halving, smaller trees join larger ones; */
+    for(size_t i = 0; i < count; i ++) {
+        if(next[i] == count)
+            continue;
+        size_t first = i;
+        size_t second = next[i];
+        while(parent[first] != first)
+            first = parent[first] = parent[parent[first]];
+        while(parent[second] != second)
+            second = parent[second] = parent[parent[second]];
+        if(first == second)
+            continue;
+        if(size[first] < size[second])
+            std::swap(first, second);
+        parent[second] = first;
+        size[first] += size[second];
+    }
+    std::vector<std::pair<size_t, size_t> > components;
+    for(size_t i = 0; i < count; i ++)
+        if(parent[i] == i)
+            components.push_back(std::make_pair(size[i], i));
+    std::sort(components.rbegin(), components.rend());
+    /* `size` of a root becomes the list of its component; */
+    std::vector<size_t> load(parts, 0);
+    for(size_t i = 0; i < components.size(); i ++) {
+        size_t part = std::min_element(load.begin(), load.end())
+            - load.begin();
+        load[part] += components[i].first;
+        size[components[i].second] = part;
+    }
+    members.assign(parts, std::vector<size_t>());
+    for(size_t i = 0; i < parts; i ++)
+        members[i].reserve(load[i]);
+    for(size_t i = 0; i < count; i ++) {
+        size_t root = i;
+        while(parent[root] != root)
+            root = parent[root];
+        members[size[root]].push_back(i);
+    }
+}
+
+void* MapTel::indexDestinationsThread(void* task)
+{
+    ResolveTask* resolve_task = static_cast<ResolveTask*>(task);
+    const TelTable& transforms = *resolve_task->transforms;
+    std::vector<size_t>& next = *resolve_task->next;
+    for(size_t i = resolve_task->begin; i < resolve_task->end; i ++)
+        next[i] = transforms.indexOf(transforms.at(i).value.destination);
+    return NULL;
+}
+
+void* MapTel::resolveComponentsThread(void* task)
+{
+    /* The same walks as in rebuildIndex(). A walk ending at a number
+     * without transformation leads to it, a walk ending at a number
+     * resolved before leads where that number does (a number on
+     * a cycle leads to itself, so it becomes the entry point).
+     * A walk closing a cycle leads to the number it has met again,
+     * and numbers of the cycle lead to themselves. A walk never
+     * leaves the component it has started in, so tasks resolving
+     * different components write different elements. */
+    ResolveTask* resolve_task = static_cast<ResolveTask*>(task);
+    const TelTable& transforms = *resolve_task->transforms;
+    const std::vector<size_t>& next = *resolve_task->next;
+    const std::vector<size_t>* members = resolve_task->members;
+    std::vector<char>& state = *resolve_task->state;
+    std::vector<const TelNumber*>& finals = *resolve_task->finals;
+    Analysis* analysis = resolve_task->analysis;
+    size_t count = next.size();
+    size_t walks = (members == NULL) ? count : members->size();
+    std::vector<size_t> path;
+    for(size_t walk = 0; walk < walks; walk ++) {
+        size_t first = (members == NULL) ? walk : (*members)[walk];
+        if(state[first] != ResolveTask::NOT_VISITED)
+            continue;
+        size_t current = first;
+        path.clear();
+        while(current != count
+              && state[current] == ResolveTask::NOT_VISITED) {
+            state[current] = ResolveTask::ON_PATH;
+            path.push_back(current);
+            current = next[current];
+        }
+        size_t cycle_start = path.size();
+        const TelNumber* final;
+        if(current == count)
+            final = &transforms.at(path.back()).value.destination;
+        else if(state[current] == ResolveTask::DONE)
+            final = finals[current];
+        else {
+            cycle_start = std::find(path.begin(), path.end(), current)
+                - path.begin();
+            final = &transforms.at(current).key;
+        }
+        for(size_t i = 0; i < path.size(); i ++) {
+            finals[path[i]] = (i < cycle_start) ? final
+                : &transforms.at(path[i]).key;
+            state[path[i]] = ResolveTask::DONE;
+        }
+        if(analysis == NULL)
+            continue;
+        /* a chain uses the transformations before its cycle
+         * and all transformations of the cycle; */
+        std::vector<size_t>& lengths = *resolve_task->lengths;
+        size_t length = (cycle_start < path.size())
+            ? path.size() - cycle_start
+            : (current == count) ? 0 : lengths[current];
+        for(size_t i = path.size(); i > 0; i --)
+            lengths[path[i - 1]] = (i - 1 < cycle_start) ? ++ length
+                : path.size() - cycle_start;
+        if(cycle_start < path.size())
+            analysis->cycles.push_back(std::vector<size_t>(
+                path.begin() + cycle_start, path.end()));
+    }
+    if(analysis == NULL)
+        return NULL;
+    const std::vector<size_t>& lengths = *resolve_task->lengths;
+    std::vector<char>& has_predecessor = *resolve_task->has_predecessor;
+    for(size_t walk = 0; walk < walks; walk ++) {
+        size_t member = (members == NULL) ? walk : (*members)[walk];
+        if(next[member] != count)
+            has_predecessor[next[member]] = true;
+    }
+    for(size_t walk = 0; walk < walks; walk ++) {
+        size_t member = (members == NULL) ? walk : (*members)[walk];
+        size_t length = lengths[member];
+        if(analysis->length_counts.size() <= length)
+            analysis->length_counts.resize(length + 1, 0);
+        analysis->length_counts[length] ++;
+        if(!has_predecessor[member])
+            analysis->chains ++;
+        if(transforms.at(member).value.cyclic)
+            analysis->cyclic_sources ++;
+        if(length > analysis->longest_length) {
+            analysis->longest = member;
+            analysis->longest_length = length;
+        }
+    }
+    return NULL;
+}
+
+void MapTel::runResolveTasks(void* (*thread)(void*),
+                             std::vector<ResolveTask>& tasks)
+{
+#if MAPTEL_CONCURRENT
+    std::vector<pthread_t> workers(tasks.size());
+    std::vector<bool> started(tasks.size(), false);
+    for(size_t i = 1; i < tasks.size(); i ++)
+        started[i] = (pthread_create(&workers[i], NULL, thread,
+                                     &tasks[i]) == 0);
+    thread(&tasks[0]);
+    for(size_t i = 1; i < tasks.size(); i ++) {
+        if(started[i])
+            pthread_join(workers[i], NULL);
+        else
+            thread(&tasks[i]);
+    }
+#else
+    for(size_t i = 0; i < tasks.size(); i ++)
+        thread(&tasks[i]);
+#endif
+}
+
+void MapTel::resolveAll(std::vector<const TelNumber*>& finals,
+                        size_t threads) const
+{
+    debug_info() << "[id=" << getId() << "]resolveAll: "
+        << tel_transforms.size() << " transformations;\n" << std::flush;
+    resolveTable(tel_transforms, threads, finals, NULL);
+}
+
+void MapTel::resolveTable(const TelTable& transforms, size_t threads,
+                          std::vector<const TelNumber*>& finals,
+                          Analysis* analysis)
+{
+    size_t count = transforms.size();
+#if MAPTEL_CONCURRENT
+    if(threads == 0)
+        threads = static_cast<size_t>(
+            std::max(1L, sysconf(_SC_NPROCESSORS_ONLN)));
+    threads = std::max(static_cast<size_t>(1),
+                       std::min(threads, count / MIN_RESOLVE_COUNT));
+#else
+    threads = 1;
+#endif
+    std::vector<size_t> next(count);
+    std::vector<char> state(count, ResolveTask::NOT_VISITED);
+    std::vector<size_t> lengths;
+    std::vector<char> has_predecessor;
+    if(analysis != NULL) {
+        lengths.assign(count, 0);
+        has_predecessor.assign(count, false);
+    }
+    std::vector<Analysis> analyses(threads);
+    finals.assign(count, NULL);
+    std::vector<ResolveTask> tasks(threads);
+    for(size_t i = 0; i < threads; i ++) {
+        tasks[i].transforms = &transforms;
+        tasks[i].begin = count / threads * i;
+        tasks[i].end = (i + 1 == threads) ? count : count / threads * (i + 1);
+        tasks[i].members = NULL;
+        tasks[i].next = &next;
+        tasks[i].state = &state;
+        tasks[i].finals = &finals;
+        tasks[i].analysis = (analysis == NULL) ? NULL : &analyses[i];
+        tasks[i].lengths = &lengths;
+        tasks[i].has_predecessor = &has_predecessor;
+        analyses[i].chains = 0;
+        analyses[i].cyclic_sources = 0;
+        analyses[i].longest = count;
+        analyses[i].longest_length = 0;
+    }
+    runResolveTasks(indexDestinationsThread, tasks);
+    std::vector<std::vector<size_t> > members;
+    if(threads > 1) {
+        partitionComponents(next, threads, members);
+        for(size_t i = 0; i < threads; i ++)
+            tasks[i].members = &members[i];
+    }
+    debug_info() << "resolveTable: " << count << " transformations, "
+        << threads << " threads;\n" << std::flush;
+    runResolveTasks(resolveComponentsThread, tasks);
+    if(analysis == NULL)
+        return;
+    *analysis = analyses[0];
+    for(size_t i = 1; i < threads; i ++) {
+        const Analysis& part = analyses[i];
+        if(analysis->length_counts.size() < part.length_counts.size())
+            analysis->length_counts.resize(part.length_counts.size(), 0);
+        for(size_t k = 0; k < part.length_counts.size(); k ++)
+            analysis->length_counts[k] += part.length_counts[k];
+        analysis->chains += part.chains;
+        analysis->cyclic_sources += part.cyclic_sources;
+        if(part.longest_length > analysis->longest_length
+           || (part.longest_length == analysis->longest_length
+               && part.longest < analysis->longest)) {
+            analysis->longest = part.longest;
+            analysis->longest_length = part.longest_length;
+        }
+        analysis->cycles.insert(analysis->cycles.end(),
+                                part.cycles.begin(), part.cycles.end());
+    }
+    /* the order of cycles does not depend on the threads: each one
+     * starts at its first transformation, they are sorted by it; */
+    for(size_t i = 0; i < analysis->cycles.size(); i ++) {
+        std::vector<size_t>& cycle = analysis->cycles[i];
+        std::rotate(cycle.begin(),
+                    std::min_element(cycle.begin(), cycle.end()),
+                    cycle.end());
+    }
+    std::sort(analysis->cycles.begin(), analysis->cycles.end());
+}
+
+void MapTel::analyze(size_t threads, Report& report) const
+{
+    settle();
+    QueryGuard guard(*this);
+    const TelFrozen* image = getFrozen();
+    const TelTable* transforms = &tel_transforms;
+    TelTable copy;
+    if(image != NULL || snapshot != NULL) {
+        /* frozen and snapshot maptels are not kept in a TelTable; */
+        size_t count = (image != NULL) ? image->getCapacity()
+                                       : snapshot->getCount();
+        copy.reserve((image != NULL) ? image->getCount() : count);
+        for(size_t i = 0; i < count; i ++) {
+            Transform transform;
+            if(image != NULL) {
+                const TelFrozen::Slot& slot = image->getSlot(i);
+                if(!(slot.flags & TelFrozen::USED))
+                    continue;
+                transform.destination = slot.destination;
+                transform.cyclic = (slot.flags & TelFrozen::CYCLIC) != 0;
+                copy.insert(slot.source, transform);
+            }
+            else {
+                transform.destination.assign(
+                    snapshot->getDestination(i),
+                    snapshot->getDestinationLength(i));
+                transform.cyclic = snapshot->isCyclic(i);
+                copy.insert(TelNumber(snapshot->getSource(i),
+                                      snapshot->getSourceLength(i)),
+                            transform);
+            }
+        }
+        transforms = &copy;
+    }
+    std::vector<const TelNumber*> finals;
+    Analysis analysis;
+    resolveTable(*transforms, threads, finals, &analysis);
+    report.sources = transforms->size();
+    report.chains = analysis.chains;
+    report.cyclic_sources = analysis.cyclic_sources;
+    report.length_counts.swap(analysis.length_counts);
+    report.longest_source.clear();
+    if(analysis.longest != transforms->size())
+        transforms->at(analysis.longest).key.copyTo(report.longest_source);
+    report.longest_length = analysis.longest_length;
+    report.cycles.assign(analysis.cycles.size(), std::vector<String>());
+    for(size_t i = 0; i < analysis.cycles.size(); i ++)
+        for(size_t j = 0; j < analysis.cycles[i].size(); j ++)
+            report.cycles[i].push_back(
+                transforms->at(analysis.cycles[i][j]).key.toString());
+    debug_info() << "[id=" << getId() << "]analyze: " << report.sources
+        << " sources, " << report.chains << " chains, "
+        << report.cycles.size() << " cycles;\n" << std::flush;
+}
+
+size_t MapTel::resolveEach(size_t threads, maptel_resolve_fn callback,
+                           void* arg) const
+{
+    settle();
+    QueryGuard guard(*this);
+    const TelFrozen* image = getFrozen();
+    size_t count = (image != NULL) ? image->getCapacity()
+        : (snapshot != NULL) ? snapshot->getCount() : tel_transforms.size();
+    /* frozen and snapshot maptels hold results of transformEx(),
+     * results of tables ignore prefix rules; */
+    std::vector<const TelNumber*> finals;
+    if(image == NULL && snapshot == NULL && prefix_rules.empty())
+        resolveAll(finals, threads);
+    String source;
+    String destination;
+    bool cyclic = false;
+    size_t calls = 0;
+    for(size_t i = 0; i < count; i ++) {
+        if(image != NULL) {
+            const TelFrozen::Slot& slot = image->getSlot(i);
+            if(!(slot.flags & TelFrozen::USED))
+                continue;
+            slot.source.copyTo(source);
+            slot.final.copyTo(destination);
+            cyclic = (slot.flags & TelFrozen::CYCLIC) != 0;
+        }
+        else if(snapshot != NULL) {
+            source.assign(snapshot->getSource(i),
+                          snapshot->getSourceLength(i));
+            destination.assign(snapshot->getFinal(i),
+                               snapshot->getFinalLength(i));
+            cyclic = snapshot->isCyclic(i);
+        }
+        else {
+            const TelTable::Entry& entry = tel_transforms.at(i);
+            entry.key.copyTo(source);
+            if(prefix_rules.empty()) {
+                finals[i]->copyTo(destination);
+                cyclic = entry.value.cyclic;
+            }
+        }
+        if(!prefix_rules.empty())
+            walk(source, destination, cyclic);
+        calls ++;
+        if(callback(source.c_str(), destination.c_str(), cyclic ? 1 : 0,
+                    arg) != 0)
+            break;
+    }
+    debug_info() << "[id=" << getId() << "]resolveEach: " << calls
+        << " sources resolved;\n" << std::flush;
+    return calls;
+}
+
+void MapTel::copySnapshot(const TelSnapshot& image)
+{
+    size_t count = image.getCount();
+    debug_info() << "[id=" << getId() << "]copySnapshot: " << count
+        << " transformations;\n" << std::flush;
+    useArena(count);
+    tel_transforms.reserve(count);
+    for(size_t i = 0; i < count; i ++) {
+        Transform transform = {
+            TelNumber(image.getDestination(i), image.getDestinationLength(i)),
+            image.isCyclic(i) };
+        tel_transforms.insert(TelNumber(image.getSource(i),
+                                        image.getSourceLength(i)),
+                              transform);
+    }
+    rebuildIndex();
+}
+
+void MapTel::thaw()
+{
+    debug_info() << "[id=" << getId() << "]thaw: snapshot becomes "
+        << "modifiable;\n" << std::flush;
+    TelSnapshot* image = snapshot;
+    snapshot = NULL;
+    copySnapshot(*image);
+    delete image;
+}
+
+void MapTel::freeze()
+{
+    settle();
+    WriteGuard guard(lock);
+    if(getFrozen() != NULL) {
+        debug_warn() << "[id=" << getId() << "]freeze: maptel is already "
+            << "frozen, doing nothing.\n" << std::flush;
+        return;
+    }
+    TelFrozen* image = buildImage();
+    if(snapshot != NULL) {
+        delete snapshot;
+        snapshot = NULL;
+    }
+    else {
+        tel_transforms.clear();
+        predecessors.clear();
+        resolved.clear();
+    }
+    finals.clear();
+    debug_info() << "[id=" << getId() << "]freeze: " << image->getCount()
+        << " transformations in " << image->getCapacity() << " slots;\n"
+        << std::flush;
+    __atomic_store_n(&frozen, image, __ATOMIC_RELEASE);
+    /* queries of frozen maptels do not lock them anyway; */
+    publish();
+}
+
+TelFrozen* MapTel::buildImage() const
+{
+    TelFrozen* image;
+    if(snapshot != NULL) {
+        size_t count = snapshot->getCount();
+        image = new TelFrozen(count);
+        for(size_t i = 0; i < count; i ++)
+            image->insert(TelNumber(snapshot->getSource(i),
+                                    snapshot->getSourceLength(i)),
+                          TelNumber(snapshot->getDestination(i),
+                                    snapshot->getDestinationLength(i)),
+                          TelNumber(snapshot->getFinal(i),
+                                    snapshot->getFinalLength(i)),
+                          snapshot->isCyclic(i));
+        return image;
+    }
+    std::vector<const TelNumber*> finals;
+    resolveAll(finals, 0);
+    image = new TelFrozen(tel_transforms.size());
+    for(size_t i = 0; i < tel_transforms.size(); i ++) {
+        const TelTable::Entry& entry = tel_transforms.at(i);
+        image->insert(entry.key, entry.value.destination, *finals[i],
+                      entry.value.cyclic);
+    }
+    return image;
+}
+
+void MapTel::disposeVersion(void* version)
+{
+    delete static_cast<Version*>(version);
+}
+
+const MapTel::Version* MapTel::getPublished() const
+{
+    /* pairs with the release in publish(): a reader of the version
+     * sees it filled; */
+    return __atomic_load_n(&published, __ATOMIC_ACQUIRE);
+}
+
+void MapTel::publish()
+{
+    if(!read_mostly)
+        return;
+    Version* version = NULL;
+    if(getFrozen() == NULL && prefix_rules.empty()) {
+        /* readers look transformations up in the tables only; */
+        if(snapshot != NULL)
+            thaw();
+        if(stale_finals)
+            rebuildFinals();
+        version = new Version();
+        version->transforms = tel_transforms;
+        version->finals = finals;
+        debug_info() << "[id=" << getId() << "]publish: "
+            << tel_transforms.size() << " transformations;\n"
+            << std::flush;
+    }
+    Version* retired = published;
+    __atomic_store_n(&published, version, __ATOMIC_RELEASE);
+    /* readers which have loaded the old version may still use it; */
+    if(retired != NULL)
+        TelEpoch::retire(retired, disposeVersion);
+}
+
+void MapTel::updateFinals(const TelNumber& number)
+{
+    if(!read_mostly || stale_finals)
+        return;
+    const Transform* transform = tel_transforms.find(number);
+    bool cyclic = (transform != NULL && transform->cyclic);
+    /* every chain going through `number` ends where its chain does
+     * (or leads to a cycle); */
+    TelNumber final = number;
+    if(transform != NULL && !cyclic) {
+        const TelNumber* next = finals.find(transform->destination);
+        final = (next == NULL) ? transform->destination : *next;
+    }
+    if(transform == NULL || cyclic)
+        finals.erase(number);
+    else
+        finals.insert(number, final);
+    std::vector<const TelNumber*> pending(1, &number);
+    while(!pending.empty()) {
+        const TelNumber* source = predecessors.find(*pending.back());
+        pending.pop_back();
+        for(; source != NULL; source = nextSource(tel_transforms, *source)) {
+            /* the walk has gone round the cycle of `number`; */
+            if(*source == number)
+                continue;
+            if(cyclic)
+                finals.erase(*source);
+            else
+                finals.insert(*source, final);
+            pending.push_back(source);
+        }
+    }
+}
+
+void MapTel::rebuildFinals()
+{
+    std::vector<const TelNumber*> results;
+    resolveAll(results, 0);
+    finals.clear();
+    finals.reserve(tel_transforms.size());
+    for(size_t i = 0; i < tel_transforms.size(); i ++) {
+        const TelTable::Entry& entry = tel_transforms.at(i);
+        if(!entry.value.cyclic)
+            finals.insert(entry.key, *results[i]);
+    }
+    stale_finals = false;
+}
+
+void MapTel::attachSnapshot(TelSnapshot* image)
+{
+    assert(image != NULL && image->isOpen());
+    settle();
+    WriteGuard guard(lock);
+    tel_transforms.clear();
+    predecessors.clear();
+    resolved.clear();
+    finals.clear();
+    stale_finals = true;
+    dropViews();
+    delete snapshot;
+    snapshot = image;
+    /* prefix rules are few, so they are always kept in memory; */
+    prefix_rules.clear();
+    longest_number = 0;
+    String prefix;
+    String destination;
+    for(size_t i = 0; i < image->getPrefixCount(); i ++) {
+        prefix.assign(image->getPrefixSource(i),
+                      image->getPrefixSourceLength(i));
+        destination.assign(image->getPrefixDestination(i),
+                           image->getPrefixDestinationLength(i));
+        prefix_rules.insert(prefix, destination);
+        longest_number = std::max(longest_number,
+                                  std::max(prefix.size(), destination.size()));
+    }
+    for(size_t i = 0; i < image->getCount(); i ++)
+        longest_number = std::max(longest_number,
+                                  std::max(image->getSourceLength(i),
+                                           image->getDestinationLength(i)));
+    publish();
+}
+
+bool MapTel::save(const char* path) const
+{
+    settle();
+    ReadGuard guard(lock);
+    return saveLocked(path);
+}
+
+bool MapTel::saveLocked(const char* path) const
+{
+    std::vector<TelSnapshot::Transformation> transformations;
+    String text;
+    if(snapshot != NULL) {
+        transformations.resize(snapshot->getCount());
+        for(size_t i = 0; i < transformations.size(); i ++) {
+            TelSnapshot::Transformation t = {
+                snapshot->getSource(i), snapshot->getDestination(i),
+                snapshot->getFinal(i),
+                static_cast<uint32_t>(snapshot->getSourceLength(i)),
+                static_cast<uint32_t>(snapshot->getDestinationLength(i)),
+                static_cast<uint32_t>(snapshot->getFinalLength(i)),
+                snapshot->isCyclic(i) };
+            transformations[i] = t;
+        }
+    }
+    else {
+        /* source, destination and final destination
+         * of every transformation; */
+        std::vector<const TelNumber*> numbers;
+        std::vector<bool> cyclic;
+        const TelFrozen* image = getFrozen();
+        if(image != NULL) {
+            for(size_t i = 0; i < image->getCapacity(); i ++) {
+                const TelFrozen::Slot& slot = image->getSlot(i);
+                if(!(slot.flags & TelFrozen::USED))
+                    continue;
+                numbers.push_back(&slot.source);
+                numbers.push_back(&slot.destination);
+                numbers.push_back(&slot.final);
+                cyclic.push_back((slot.flags & TelFrozen::CYCLIC) != 0);
+            }
+        }
+        else {
+            std::vector<const TelNumber*> finals;
+            resolveAll(finals, 0);
+            for(size_t i = 0; i < tel_transforms.size(); i ++) {
+                const TelTable::Entry& entry = tel_transforms.at(i);
+                numbers.push_back(&entry.key);
+                numbers.push_back(&entry.value.destination);
+                numbers.push_back(finals[i]);
+                cyclic.push_back(entry.value.cyclic);
+            }
+        }
+        /* numbers are unpacked to a single buffer (pointers into it
+         * are taken once it is complete); */
+        size_t count = cyclic.size();
+        std::vector<size_t> offsets(3 * count + 1, 0);
+        String number;
+        for(size_t i = 0; i < numbers.size(); i ++) {
+            numbers[i]->copyTo(number);
+            text.append(number);
+            offsets[i + 1] = text.size();
+        }
+        transformations.resize(count);
+        for(size_t i = 0; i < count; i ++) {
+            const size_t* offset = &offsets[3 * i];
+            TelSnapshot::Transformation t = {
+                text.data() + offset[0], text.data() + offset[1],
+                text.data() + offset[2],
+                static_cast<uint32_t>(offset[1] - offset[0]),
+                static_cast<uint32_t>(offset[2] - offset[1]),
+                static_cast<uint32_t>(offset[3] - offset[2]),
+                cyclic[i] };
+            transformations[i] = t;
+        }
+    }
+    std::vector<std::pair<String, String> > rules;
+    prefix_rules.rules(rules);
+    std::vector<TelSnapshot::PrefixRule> prefixes(rules.size());
+    for(size_t i = 0; i < rules.size(); i ++) {
+        TelSnapshot::PrefixRule rule = {
+            rules[i].first.data(), rules[i].second.data(),
+            static_cast<uint32_t>(rules[i].first.size()),
+            static_cast<uint32_t>(rules[i].second.size()) };
+        prefixes[i] = rule;
+    }
+    debug_info() << "[id=" << getId() << "]save: " << transformations.size()
+        << " transformations, " << prefixes.size() << " prefix rules;\n"
+        << std::flush;
+    return TelSnapshot::save(path, transformations, prefixes);
+}
+
+bool MapTel::openJournal(const char* path, size_t group_bytes,
+                         unsigned long group_usec)
+{
+    debug_info() << "[id=" << getId() << "]openJournal: " << path
+        << ";\n" << std::flush;
+    TelJournal* opened = new TelJournal(path, group_bytes, group_usec);
+    if(!opened->isOpen()) {
+        delete opened;
+        return false;
+    }
+    settle();
+    WriteGuard guard(lock);
+    delete journal;
+    journal = opened;
+    return true;
+}
+
+bool MapTel::syncJournal()
+{
+    /* shared `lock` keeps the journal, the journal orders commits; */
+    ReadGuard guard(lock);
+    if(journal == NULL)
+        debug_err() << "[id=" << getId() << "]syncJournal: "
+            << "maptel is not journaled!\n" << std::flush;
+    return journal != NULL && journal->sync();
+}
+
+bool MapTel::closeJournal()
+{
+    WriteGuard guard(lock);
+    if(journal == NULL) {
+        debug_err() << "[id=" << getId() << "]closeJournal: "
+            << "maptel is not journaled!\n" << std::flush;
+        return false;
+    }
+    bool synced = journal->sync();
+    delete journal;
+    journal = NULL;
+    return synced;
+}
+
+bool MapTel::checkpoint(const char* path)
+{
+    debug_info() << "[id=" << getId() << "]checkpoint: " << path
+        << ";\n" << std::flush;
+    settle();
+    /* Nothing may be journaled between saving and truncating. If
+     * the journal outlives the new snapshot (a crash in between),
+     * replaying it is harmless: every record sets or erases
+     * a single transformation, so the result is the same. */
+    WriteGuard guard(lock);
+    if(!saveLocked(path))
+        return false;
+    return journal == NULL || journal->truncate();
+}
+
+void MapTel::replay(const std::vector<TelJournal::Record>& records)
+{
+    debug_info() << "[id=" << getId() << "]replay: " << records.size()
+        << " records;\n" << std::flush;
+    settle();
+    WriteGuard guard(lock);
+    /* `finals` are rebuilt once by publish(); */
+    stale_finals = true;
+    for(size_t i = 0; i < records.size(); i ++)
+        if(records[i].prefix && records[i].operation == TelJournal::INSERT)
+            insertPrefixLocked(records[i].source, records[i].destination);
+        else if(records[i].prefix)
+            erasePrefixLocked(records[i].source);
+        else if(records[i].operation == TelJournal::INSERT)
+            insertLocked(records[i].source, records[i].destination);
+        else
+            eraseLocked(records[i].source);
+    publish();
+}
+
+size_t MapTel::load(const TelFile& file)
+{
+    size_t count = file.getRecordCount();
+    debug_info() << "[id=" << getId() << "]load: " << count
+        << " transformations;\n" << std::flush;
+    settle();
+    WriteGuard guard(lock);
+    if(!checkModifiable("load"))
+        return 0;
+    if(snapshot != NULL)
+        thaw();
+    dropViews();
+    stale_finals = true;
+    bool was_empty = tel_transforms.empty();
+    useArena(tel_transforms.size() + count);
+    tel_transforms.reserve(tel_transforms.size() + count);
+    String source;
+    String destination;
+    for(size_t i = 0; i < file.getChunkCount(); i ++) {
+        const TelFile::Chunk& chunk = file.getChunk(i);
+        for(size_t j = 0; j < chunk.size(); j ++) {
+            const TelFile::Record& record = chunk[j];
+            if(was_empty && journal == NULL) {
+                /* numbers are packed straight from the file,
+                 * indexes are rebuilt once at the end; */
+                Transform transform = {
+                    TelNumber(record.destination, record.destination_length),
+                    false };
+                tel_transforms.insert(TelNumber(record.source,
+                                                record.source_length),
+                                      transform);
+                longest_number = std::max(longest_number,
+                    static_cast<size_t>(std::max(record.source_length,
+                                                 record.destination_length)));
+                continue;
+            }
+            source.assign(record.source, record.source_length);
+            destination.assign(record.destination, record.destination_length);
+            if(was_empty) {
+                journal->append(TelJournal::INSERT, source, destination);
+                Transform transform = { TelNumber(destination), false };
+                tel_transforms.insert(TelNumber(source), transform);
+                longest_number = std::max(longest_number,
+                    std::max(source.size(), destination.size()));
+            }
+            else
+                insertLocked(source, destination);
+        }
+    }
+    if(was_empty)
+        rebuildIndex();
+    publish();
+    return count;
+}
+
+void MapTel::insertBatch(const char* const* sources,
+                         const char* const* destinations, size_t count)
+{
+    debug_info() << "[id=" << getId() << "]insertBatch: " << count
+        << " transformations;\n" << std::flush;
+    if(striped != NULL && !striped->isSettled()) {
+        /* every transformation locks only its stripe; */
+        for(size_t i = 0; i < count; i ++) {
+            if(sources[i] == NULL || destinations[i] == NULL)
+                debug_err() << "insertBatch: element " << i << " is NULL!\n"
+                    << std::flush;
+            assert(sources[i] != NULL);
+            assert(destinations[i] != NULL);
+            if(sources[i] != NULL && destinations[i] != NULL)
+                insert(String(sources[i]), String(destinations[i]));
+        }
+        return;
+    }
+    WriteGuard guard(lock);
+    useArena(tel_transforms.size() + count);
+    tel_transforms.reserve(tel_transforms.size() + count);
+    /* `finals` are rebuilt once by publish(); */
+    stale_finals = true;
+    /* buffers are reused, so short numbers are never allocated; */
+    String source;
+    String destination;
+    for(size_t i = 0; i < count; i ++) {
+        if(sources[i] == NULL || destinations[i] == NULL)
+            debug_err() << "insertBatch: element " << i << " is NULL!\n"
+                << std::flush;
+        assert(sources[i] != NULL);
+        assert(destinations[i] != NULL);
+        if(sources[i] == NULL || destinations[i] == NULL)
+            continue;
+        source.assign(sources[i]);
+        destination.assign(destinations[i]);
+        assert(isCorrect(source));
+        assert(isCorrect(destination));
+        insertLocked(source, destination);
+    }
+    publish();
+}
+
+void MapTel::eraseBatch(const char* const* sources, size_t count)
+{
+    debug_info() << "[id=" << getId() << "]eraseBatch: " << count
+        << " sources;\n" << std::flush;
+    if(striped != NULL && !striped->isSettled()) {
+        for(size_t i = 0; i < count; i ++) {
+            if(sources[i] == NULL)
+                debug_err() << "eraseBatch: element " << i << " is NULL!\n"
+                    << std::flush;
+            assert(sources[i] != NULL);
+            if(sources[i] != NULL)
+                erase(String(sources[i]));
+        }
+        return;
+    }
+    WriteGuard guard(lock);
+    stale_finals = true;
+    String source;
+    for(size_t i = 0; i < count; i ++) {
+        if(sources[i] == NULL)
+            debug_err() << "eraseBatch: element " << i << " is NULL!\n"
+                << std::flush;
+        assert(sources[i] != NULL);
+        if(sources[i] == NULL)
+            continue;
+        source.assign(sources[i]);
+        assert(isCorrect(source));
+        eraseLocked(source);
+    }
+    publish();
+}
+
+/** Copies `number` to `tel_dst` if it fits in `len` bytes,
+ *  otherwise writes an empty string. */
+static void copyNumber(const String& number, char* tel_dst, size_t len)
+{
+    if(len < number.size() + 1) {
+        debug_err() << "batch: amount of given memory (" << len
+            << "B) is to small for writing returned dest: "
+            << "#\"" << number << "\\0\" = " << number.size() + 1
+            << " > " << len << ".\n" << std::flush;
+        tel_dst[0] = '\0';
+        return;
+    }
+    memcpy(tel_dst, number.data(), number.size());
+    tel_dst[number.size()] = '\0';
+}
+
+void MapTel::transformBatch(const char* const* sources, char* destinations,
+                            size_t len, size_t count) const
+{
+    debug_info() << "[id=" << getId() << "]transformBatch: " << count
+        << " sources;\n" << std::flush;
+    if(read_mostly) {
+        /* the whole batch reads a single copy; */
+        TelEpoch::Pin pin;
+        const Version* version = getPublished();
+        if(version != NULL) {
+            String source;
+            for(size_t i = 0; i < count; i ++) {
+                char* tel_dst = destinations + i * len;
+                if(sources[i] == NULL) {
+                    debug_err() << "transformBatch: element " << i
+                        << " is NULL!\n" << std::flush;
+                    tel_dst[0] = '\0';
+                    continue;
+                }
+                source.assign(sources[i]);
+                assert(isCorrect(source));
+                const Transform* transform =
+                    version->transforms.findProbe(TelProbe(source));
+                if(transform != NULL)
+                    transform->destination.copyTo(source);
+                copyNumber(source, tel_dst, len);
+            }
+            return;
+        }
+    }
+    QueryGuard guard(*this);
+    /* `striped` is settled only with exclusive `lock`; */
+    bool by_stripes = (striped != NULL && !striped->isSettled());
+    String source;
+    String buffer;
+    for(size_t i = 0; i < count; i ++) {
+        char* tel_dst = destinations + i * len;
+        if(sources[i] == NULL) {
+            debug_err() << "transformBatch: element " << i << " is NULL!\n"
+                << std::flush;
+            tel_dst[0] = '\0';
+            continue;
+        }
+        source.assign(sources[i]);
+        assert(isCorrect(source));
+        if(by_stripes)
+            copyNumber(transform(source), tel_dst, len);
+        else
+            copyNumber(transformLocked(source, buffer), tel_dst, len);
+    }
+}
+
+void MapTel::transformExBatch(const char* const* sources, char* destinations,
+                              size_t len, size_t count) const
+{
+    debug_info() << "[id=" << getId() << "]transformExBatch: " << count
+        << " sources;\n" << std::flush;
+    if(read_mostly) {
+        TelEpoch::Pin pin;
+        const Version* version = getPublished();
+        if(version != NULL) {
+            String source;
+            String destination;
+            for(size_t i = 0; i < count; i ++) {
+                char* tel_dst = destinations + i * len;
+                if(sources[i] == NULL) {
+                    debug_err() << "transformExBatch: element " << i
+                        << " is NULL!\n" << std::flush;
+                    tel_dst[0] = '\0';
+                    continue;
+                }
+                source.assign(sources[i]);
+                assert(isCorrect(source));
+                /* cycles are reported by transformEx(); */
+                if(transformExPublished(*version, source, destination))
+                    copyNumber(destination, tel_dst, len);
+                else
+                    copyNumber(transformEx(source), tel_dst, len);
+            }
+            return;
+        }
+    }
+    QueryGuard guard(*this);
+    bool by_stripes = (striped != NULL && !striped->isSettled());
+    String source;
+    for(size_t i = 0; i < count; i ++) {
+        char* tel_dst = destinations + i * len;
+        if(sources[i] == NULL) {
+            debug_err() << "transformExBatch: element " << i
+                << " is NULL!\n" << std::flush;
+            tel_dst[0] = '\0';
+            continue;
+        }
+        source.assign(sources[i]);
+        assert(isCorrect(source));
+        if(by_stripes)
+            copyNumber(transformEx(source), tel_dst, len);
+        else
+            copyNumber(transformExLocked(source), tel_dst, len);
+    }
+}
+
+unsigned long maptel_create()
+{
+    return MapTel::createMapTel(0).getId();
+}
+
+unsigned long maptel_create_ex(unsigned flags)
+{
+    debug_info() << "create_ex: flags = " << flags << ".\n" << std::flush;
+    return MapTel::createMapTel(flags).getId();
+}
+
+void maptel_delete(unsigned long id)
+{
+    MapTel::deleteMapTel(id);
+}
+
+void maptel_insert
+(unsigned long id, const char *tel_src, const char *tel_dst)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]insert:\n"
+        << std::flush;
+    if(tel_src == NULL)
+        debug_err() << "insert: tel_src is NULL!\n"
+            << std::flush;
+    if(tel_dst == NULL)
+        debug_err() << "insert: tel_dst is NULL!\n"
+            << std::flush;
+    assert(tel_src != NULL);
+    assert(tel_dst != NULL);
+    if(!MapTel::exists(id))
+        debug_err() << "insert: maptel of id = "
+                    << id << " does not exist!\n"
+                    << std::flush;
+    assert(MapTel::exists(id));
+    if((tel_src != NULL) && (tel_dst != NULL) && (MapTel::exists(id))) {
+        String src = String(tel_src);
+        String dst = String(tel_dst);
+        MapTel::getMapTel(id).insert(src, dst);
+    }
+}
+
+void maptel_erase(unsigned long id, const char *tel_src)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]erase:\n"
+        << std::flush;
+    if(tel_src == NULL)
+        debug_err() << "erase: tel_src is NULL!\n"
+            << std::flush;
+    assert(tel_src != NULL);
+    if(!MapTel::exists(id))
+        debug_err() << "erase: maptel of id = "
+            << id << " does not exist!\n" << std::flush;
+    assert(MapTel::exists(id));
+    if(tel_src != NULL) {
+        String src = String(tel_src);
+        MapTel::getMapTel(id).erase(src);
+    }
+}
+
+void maptel_transform
+(unsigned long id, const char *tel_src, char *tel_dst, size_t len)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]transform:\n" << std::flush;
+    if(tel_src == NULL)
+        debug_err() << "transform: tel_src is NULL!\n" << std::flush;
+    if(tel_dst == NULL)
+        debug_err() << "transform: tel_dst is NULL!\n" << std::flush;
+    if(len < 1)
+        debug_err() << "transform: len must be >= 1!\n" << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "transform: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(tel_src != NULL);
+    assert(tel_dst != NULL);
+    assert(len >= 1);
+    assert(MapTel::exists(id));
+    if(tel_src != NULL && tel_dst != NULL && len > 1 && MapTel::exists(id)) {
+        const String src = String(tel_src);
+        const String dst = MapTel::getMapTel(id).transform(src);
+        if(len < dst.size() + 1)
+            debug_err() << "transform: amount "
+                << "of given memory (" << sizeof(char) * len
+                << "B) is to small for writing returned dest: "
+                << "#\"" << dst << "\\0\" = " << dst.size() + 1
+                << " > " << len << ".\n" << std::flush;
+        else
+            debug_info() << "transform: amount "
+                << "of given memory (" << sizeof(char) * len << "B) correct: "
+                << "#\"" << dst << "\\0\" = " << dst.size() + 1
+                << " <= " << len << ".\n" << std::flush;
+        assert(dst.size() + 1 <= len);
+        for(size_t i = 0; i < dst.size(); i ++)
+            tel_dst[i] = dst.at(i);
+        tel_dst[dst.size()] = '\0';
+    }
+}
+
+int maptel_is_cyclic(unsigned long id, const char *tel_src)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]isCyclic:\n" << std::flush;
+    if(tel_src == NULL)
+        debug_err() << "isCyclic: tel_src is NULL!\n" << std::flush;
+    assert(tel_src != NULL);
+    if(!MapTel::exists(id))
+        debug_err() << "isCyclic: maptel of id = "
+            << id << " does not exist!\n";
+    assert(MapTel::exists(id));
+    if(tel_src != NULL && MapTel::exists(id)) {
+        const String src = String(tel_src);
+        return static_cast<int>(MapTel::getMapTel(id).isCyclic(src));
+    }
+    return -1;
+}
+
+void maptel_transform_ex
+(unsigned long id, const char *tel_src, char *tel_dst, size_t len)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]transform:\n" << std::flush;
+    if(tel_src == NULL)
+        debug_err() << "transform: tel_src is NULL!\n" << std::flush;
+    if(tel_dst == NULL)
+        debug_err() << "transform: tel_dst is NULL!\n" << std::flush;
+    if(len < 1)
+        debug_err() << "transform: len must be >= 1!\n" << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "transform: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(tel_src != NULL);
+    assert(tel_dst != NULL);
+    assert(len >= 1);
+    assert(MapTel::exists(id));
+    if(tel_src != NULL && tel_dst != NULL && MapTel::exists(id)) {
+        const String src = String(tel_src);
+        const String dst = MapTel::getMapTel(id).transformEx(src);
+        if(len < dst.size() + 1)
+            debug_err() << "transformEx: amount of "
+                << "given memory (" << sizeof(char) * len << "B) to small "
+                << "for writing returned dest: "
+                << "#\"" << dst << "\\0\" = " << dst.size() + 1
+                << " > " << len << ".\n" << std::flush;
+        else {
+            debug_info() << "transformEx: amount "
+                << "of given memory (" << sizeof(char) * len << "B) correct: "
+                << "#\"" << dst << "\\0\" = " << dst.size() + 1 << " <= "
+                << len << ".\n" << std::flush;
+            for(size_t i = 0; i < dst.size(); i ++)
+                tel_dst[i] = dst.at(i);
+            tel_dst[dst.size()] = '\0';
+        }
+        assert(dst.size() + 1 <= len);
+    }
+}
+
+int maptel_transform_ex_bounded(unsigned long id, const char *tel_src,
+                                char *tel_dst, size_t len,
+                                unsigned long max_hops)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]transform_ex_bounded:\n"
+        << std::flush;
+    if(tel_src == NULL)
+        debug_err() << "transform_ex_bounded: tel_src is NULL!\n"
+            << std::flush;
+    if(tel_dst == NULL)
+        debug_err() << "transform_ex_bounded: tel_dst is NULL!\n"
+            << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "transform_ex_bounded: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(tel_src != NULL);
+    assert(tel_dst != NULL);
+    assert(MapTel::exists(id));
+    if(tel_src == NULL || tel_dst == NULL || !MapTel::exists(id))
+        return -1;
+    String dst;
+    bool ended = MapTel::getMapTel(id).transformExBounded(String(tel_src),
+                                                          max_hops, dst);
+    if(len < dst.size() + 1) {
+        debug_err() << "transform_ex_bounded: amount of given memory ("
+            << len << "B) to small for writing returned dest: #\""
+            << dst << "\\0\" = " << dst.size() + 1 << " > " << len
+            << ".\n" << std::flush;
+        return -1;
+    }
+    memcpy(tel_dst, dst.data(), dst.size());
+    tel_dst[dst.size()] = '\0';
+    return ended ? 1 : 0;
+}
+
+/** maptel_transform_view() (`ex` selects transformEx()). */
+static int transformView(const char* name, unsigned long id,
+                         const char* tel_src, const char** tel_dst,
+                         size_t* len, bool ex)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]" << name << ":\n" << std::flush;
+    if(tel_src == NULL)
+        debug_err() << name << ": tel_src is NULL!\n" << std::flush;
+    if(tel_dst == NULL || len == NULL)
+        debug_err() << name << ": tel_dst or len is NULL!\n" << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << name << ": maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(tel_src != NULL);
+    assert(tel_dst != NULL && len != NULL);
+    assert(MapTel::exists(id));
+    if(tel_src == NULL || tel_dst == NULL || len == NULL
+       || !MapTel::exists(id))
+        return -1;
+    *len = strlen(tel_src);
+    if(ex)
+        MapTel::getMapTel(id).transformExView(tel_src, *len, *tel_dst);
+    else
+        MapTel::getMapTel(id).transformView(tel_src, *len, *tel_dst);
+    return 0;
+}
+
+int maptel_transform_view(unsigned long id, const char *tel_src,
+                          const char **tel_dst, size_t *len)
+{
+    return transformView("transform_view", id, tel_src, tel_dst, len, false);
+}
+
+int maptel_transform_ex_view(unsigned long id, const char *tel_src,
+                             const char **tel_dst, size_t *len)
+{
+    return transformView("transform_ex_view", id, tel_src, tel_dst, len,
+                         true);
+}
+
+void maptel_release_views(unsigned long id)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]release_views:\n" << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "release_views: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(MapTel::exists(id));
+    if(MapTel::exists(id))
+        MapTel::getMapTel(id).releaseViews();
+}
+
+
+void maptel_insert_batch(unsigned long id, const char * const *tel_src,
+                         const char * const *tel_dst, size_t count)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]insert_batch:\n" << std::flush;
+    if(tel_src == NULL || tel_dst == NULL)
+        debug_err() << "insert_batch: tel_src or tel_dst is NULL!\n"
+            << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "insert_batch: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(tel_src != NULL);
+    assert(tel_dst != NULL);
+    assert(MapTel::exists(id));
+    if(tel_src != NULL && tel_dst != NULL && MapTel::exists(id))
+        MapTel::getMapTel(id).insertBatch(tel_src, tel_dst, count);
+}
+
+void maptel_erase_batch(unsigned long id, const char * const *tel_src,
+                        size_t count)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]erase_batch:\n" << std::flush;
+    if(tel_src == NULL)
+        debug_err() << "erase_batch: tel_src is NULL!\n" << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "erase_batch: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(tel_src != NULL);
+    assert(MapTel::exists(id));
+    if(tel_src != NULL && MapTel::exists(id))
+        MapTel::getMapTel(id).eraseBatch(tel_src, count);
+}
+
+void maptel_transform_batch(unsigned long id, const char * const *tel_src,
+                            char *tel_dst, size_t len, size_t count)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]transform_batch:\n" << std::flush;
+    if(tel_src == NULL || tel_dst == NULL)
+        debug_err() << "transform_batch: tel_src or tel_dst is NULL!\n"
+            << std::flush;
+    if(len < 1)
+        debug_err() << "transform_batch: len must be >= 1!\n" << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "transform_batch: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(tel_src != NULL);
+    assert(tel_dst != NULL);
+    assert(len >= 1);
+    assert(MapTel::exists(id));
+    if(tel_src != NULL && tel_dst != NULL && len >= 1 && MapTel::exists(id))
+        MapTel::getMapTel(id).transformBatch(tel_src, tel_dst, len, count);
+}
+
+void maptel_transform_ex_batch(unsigned long id, const char * const *tel_src,
+                               char *tel_dst, size_t len, size_t count)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]transform_ex_batch:\n" << std::flush;
+    if(tel_src == NULL || tel_dst == NULL)
+        debug_err() << "transform_ex_batch: tel_src or tel_dst is NULL!\n"
+            << std::flush;
+    if(len < 1)
+        debug_err() << "transform_ex_batch: len must be >= 1!\n"
+            << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "transform_ex_batch: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(tel_src != NULL);
+    assert(tel_dst != NULL);
+    assert(len >= 1);
+    assert(MapTel::exists(id));
+    if(tel_src != NULL && tel_dst != NULL && len >= 1 && MapTel::exists(id))
+        MapTel::getMapTel(id).transformExBatch(tel_src, tel_dst, len, count);
+}
+
+long maptel_load_file(unsigned long id, const char *path)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]load_file:\n" << std::flush;
+    if(path == NULL)
+        debug_err() << "load_file: path is NULL!\n" << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "load_file: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(path != NULL);
+    assert(MapTel::exists(id));
+    if(path == NULL || !MapTel::exists(id))
+        return -1;
+    TelFile file(path);
+    if(!file.isOpen())
+        return -1;
+    file.parse(0);
+    if(file.getInvalidCount() > 0)
+        debug_warn() << "load_file: " << file.getInvalidCount()
+            << " malformed lines skipped.\n" << std::flush;
+    return static_cast<long>(MapTel::getMapTel(id).load(file));
+}
+
+int maptel_save(unsigned long id, const char *path)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]save:\n" << std::flush;
+    if(path == NULL)
+        debug_err() << "save: path is NULL!\n" << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "save: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(path != NULL);
+    assert(MapTel::exists(id));
+    if(path == NULL || !MapTel::exists(id))
+        return -1;
+    return MapTel::getMapTel(id).save(path) ? 0 : -1;
+}
+
+int maptel_open_snapshot(const char *path, unsigned long *id)
+{
+    debug_info() << "open_snapshot:\n" << std::flush;
+    if(path == NULL || id == NULL)
+        debug_err() << "open_snapshot: path or id is NULL!\n" << std::flush;
+    assert(path != NULL);
+    assert(id != NULL);
+    if(path == NULL || id == NULL)
+        return -1;
+    TelSnapshot* image = new TelSnapshot(path);
+    if(!image->isOpen()) {
+        delete image;
+        return -1;
+    }
+    Integer created = MapTel::createMapTel(0).getId();
+    MapTel::IdPin pin(created);
+    MapTel::getMapTel(created).attachSnapshot(image);
+    *id = created;
+    return 0;
+}
+
+int maptel_clone(unsigned long id, unsigned long *clone_id)
+{
+    debug_info() << "[id=" << id << "]clone:\n" << std::flush;
+    if(clone_id == NULL)
+        debug_err() << "clone: clone_id is NULL!\n" << std::flush;
+    assert(clone_id != NULL);
+    if(clone_id == NULL)
+        return -1;
+    MapTel* clone = MapTel::cloneMapTel(id);
+    if(clone == NULL)
+        debug_err() << "clone: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(clone != NULL);
+    if(clone == NULL)
+        return -1;
+    *clone_id = clone->getId();
+    return 0;
+}
+
+int maptel_swap(unsigned long id_live, unsigned long id_staged)
+{
+    debug_info() << "[id=" << id_live << "]swap: with maptel of id = "
+        << id_staged << ";\n" << std::flush;
+    bool swapped = MapTel::swapMapTels(id_live, id_staged);
+    if(!swapped)
+        debug_err() << "swap: maptel of id = " << id_live << " or "
+            << id_staged << " does not exist!\n" << std::flush;
+    assert(swapped);
+    if(!swapped)
+        return -1;
+    return 0;
 }
 
-String MapTel::transformEx(const String& source) const
+/** Passes `numbers` to `callback` until it returns non zero;
+ *  returns the number of passed numbers. */
+static long reportNumbers(const std::vector<String>& numbers,
+                          maptel_number_fn callback, void *arg)
 {
-    assert(isCorrect(source));
-    String current_source = String(source);
-    std::set<String> seen = std::set<String>();
-    std::set<String>::iterator seen_it;
-    std::map<String,String>::const_iterator maptel_it;
-    debug_info() << "transformEx: checking path from: " << source << ";\n"
-        << std::flush;
-    while(true) {
-        seen_it = seen.find(current_source);
-        if(seen_it != seen.end()) {
-            debug_err() << "transformEx: element: "
-                << current_source << " was already seen;\n" << std::flush;
-            debug_err() << "transformEx: cycle found!\n" << std::flush;
-        }
-        assert(seen_it == seen.end());
-        if(seen_it != seen.end())
+    long reported = 0;
+    for(size_t i = 0; i < numbers.size(); i ++) {
+        reported ++;
+        if(callback(numbers[i].c_str(), arg) != 0)
             break;
-        seen.insert(current_source);
-        maptel_it = tel_transforms.find(current_source);
-        if(maptel_it != tel_transforms.end()) {
-            debug_info() << "transformEx: transform: "
-                << current_source << " -> " << maptel_it->second << ";\n"
-                << std::flush;
-            current_source = (*maptel_it).second;
-        }
-        else {
-            debug_info() << "transformEx: transform: "
-                << current_source << " -> ... (none found);\n" << std::flush;
-            debug_info() << "transformEx: "
-                << "final destination found: "
-                << current_source << "\n" << std::flush;
-            break;
-        }
     }
-    return String(current_source);
+    return reported;
 }
 
-unsigned long maptel_create()
+long maptel_sources_of(unsigned long id, const char *tel_dst,
+                       maptel_number_fn callback, void *arg)
 {
-    return MapTel::createMapTel().getId();
+    std::vector<String> sources;
+    {
+        /* callbacks are called without locks, so they may use
+         * the maptel; */
+        MapTel::IdPin pin(id);
+        debug_info() << "[id=" << id << "]sources_of:\n" << std::flush;
+        if(tel_dst == NULL)
+            debug_err() << "sources_of: tel_dst is NULL!\n" << std::flush;
+        if(callback == NULL)
+            debug_err() << "sources_of: callback is NULL!\n" << std::flush;
+        if(!MapTel::exists(id))
+            debug_err() << "sources_of: maptel of id = " << id
+                << " does not exist!\n" << std::flush;
+        assert(tel_dst != NULL);
+        assert(callback != NULL);
+        assert(MapTel::exists(id));
+        if(tel_dst == NULL || callback == NULL || !MapTel::exists(id))
+            return -1;
+        MapTel::getMapTel(id).sourcesOf(String(tel_dst), sources);
+    }
+    return reportNumbers(sources, callback, arg);
 }
 
-void maptel_delete(unsigned long id)
+long maptel_preimage(unsigned long id, const char *tel_dst,
+                     maptel_number_fn callback, void *arg)
 {
-    MapTel::deleteMapTel(id);
+    std::vector<String> sources;
+    {
+        /* as in maptel_sources_of(); */
+        MapTel::IdPin pin(id);
+        debug_info() << "[id=" << id << "]preimage:\n" << std::flush;
+        if(tel_dst == NULL)
+            debug_err() << "preimage: tel_dst is NULL!\n" << std::flush;
+        if(callback == NULL)
+            debug_err() << "preimage: callback is NULL!\n" << std::flush;
+        if(!MapTel::exists(id))
+            debug_err() << "preimage: maptel of id = " << id
+                << " does not exist!\n" << std::flush;
+        assert(tel_dst != NULL);
+        assert(callback != NULL);
+        assert(MapTel::exists(id));
+        if(tel_dst == NULL || callback == NULL || !MapTel::exists(id))
+            return -1;
+        MapTel::getMapTel(id).preimage(String(tel_dst), sources);
+    }
+    return reportNumbers(sources, callback, arg);
 }
 
-void maptel_insert
-(unsigned long id, const char *tel_src, const char *tel_dst)
+/** maptel_resolve_all() with up to `threads` threads, `name`
+ *  is the caller's name. */
+static long resolveMapTel(const char* name, unsigned long id,
+                          size_t threads, maptel_resolve_fn callback,
+                          void *arg)
 {
-    debug_info() << "[id=" << id << "]insert:\n"
-        << std::flush;
-    if(tel_src == NULL)
-        debug_err() << "insert: tel_src is NULL!\n"
-            << std::flush;
-    if(tel_dst == NULL)
-        debug_err() << "insert: tel_dst is NULL!\n"
-            << std::flush;
-    assert(tel_src != NULL);
-    assert(tel_dst != NULL);
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]" << name << ":\n" << std::flush;
+    if(callback == NULL)
+        debug_err() << name << ": callback is NULL!\n" << std::flush;
     if(!MapTel::exists(id))
-        debug_err() << "insert: maptel of id = "
-                    << id << " does not exist!\n"
-                    << std::flush;
+        debug_err() << name << ": maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(callback != NULL);
     assert(MapTel::exists(id));
-    if((tel_src != NULL) && (tel_dst != NULL) && (MapTel::exists(id))) {
-        String src = String(tel_src);
-        String dst = String(tel_dst);
-        MapTel::getMapTel(id).insert(src, dst);
-    }
+    if(callback == NULL || !MapTel::exists(id))
+        return -1;
+    return static_cast<long>(
+        MapTel::getMapTel(id).resolveEach(threads, callback, arg));
 }
 
-void maptel_erase(unsigned long id, const char *tel_src)
+long maptel_resolve_all(unsigned long id, maptel_resolve_fn callback,
+                        void *arg)
 {
-    debug_info() << "[id=" << id << "]erase:\n"
-        << std::flush;
-    if(tel_src == NULL)
-        debug_err() << "erase: tel_src is NULL!\n"
+    return resolveMapTel("resolve_all", id, 1, callback, arg);
+}
+
+long maptel_resolve_all_parallel(unsigned long id, unsigned threads,
+                                 maptel_resolve_fn callback, void *arg)
+{
+    return resolveMapTel("resolve_all_parallel", id, threads, callback,
+                         arg);
+}
+
+/** Returns a malloc()ed copy of `number` or NULL. */
+static char* copyString(const String& number)
+{
+    char* copy = static_cast<char*>(malloc(number.size() + 1));
+    if(copy != NULL)
+        memcpy(copy, number.c_str(), number.size() + 1);
+    return copy;
+}
+
+int maptel_analyze(unsigned long id, maptel_report *report)
+{
+    MapTel::Report analysis;
+    {
+        MapTel::IdPin pin(id);
+        debug_info() << "[id=" << id << "]analyze:\n" << std::flush;
+        if(report == NULL)
+            debug_err() << "analyze: report is NULL!\n" << std::flush;
+        if(!MapTel::exists(id))
+            debug_err() << "analyze: maptel of id = " << id
+                << " does not exist!\n" << std::flush;
+        assert(report != NULL);
+        assert(MapTel::exists(id));
+        if(report == NULL || !MapTel::exists(id))
+            return -1;
+        MapTel::getMapTel(id).analyze(0, analysis);
+    }
+    memset(report, 0, sizeof(*report));
+    report->sources = analysis.sources;
+    report->chains = analysis.chains;
+    report->cyclic_sources = analysis.cyclic_sources;
+    report->length_count_size = analysis.length_counts.size();
+    report->longest_length = analysis.longest_length;
+    report->cycle_count = analysis.cycles.size();
+    size_t members = 0;
+    for(size_t i = 0; i < analysis.cycles.size(); i ++)
+        members += analysis.cycles[i].size();
+    /* one more element, so empty arrays are not NULL; */
+    report->length_counts = static_cast<unsigned long*>(
+        malloc((analysis.length_counts.size() + 1) * sizeof(unsigned long)));
+    report->longest_source = copyString(analysis.longest_source);
+    report->cycle_offsets = static_cast<unsigned long*>(
+        malloc((analysis.cycles.size() + 1) * sizeof(unsigned long)));
+    report->cycle_members = static_cast<char**>(
+        calloc(members + 1, sizeof(char*)));
+    bool allocated = report->length_counts != NULL
+        && report->longest_source != NULL && report->cycle_offsets != NULL
+        && report->cycle_members != NULL;
+    size_t offset = 0;
+    if(allocated) {
+        std::copy(analysis.length_counts.begin(),
+                  analysis.length_counts.end(), report->length_counts);
+        for(size_t i = 0; i < analysis.cycles.size() && allocated; i ++) {
+            report->cycle_offsets[i] = offset;
+            for(size_t j = 0; j < analysis.cycles[i].size(); j ++) {
+                report->cycle_members[offset] =
+                    copyString(analysis.cycles[i][j]);
+                allocated = allocated
+                    && report->cycle_members[offset] != NULL;
+                offset ++;
+            }
+        }
+    }
+    /* members copied so far are freed by maptel_report_free(); */
+    if(report->cycle_offsets != NULL)
+        report->cycle_offsets[analysis.cycles.size()] = offset;
+    if(!allocated) {
+        debug_err() << "analyze: cannot allocate the report!\n"
             << std::flush;
-    assert(tel_src != NULL);
+        maptel_report_free(report);
+        return -1;
+    }
+    return 0;
+}
+
+void maptel_report_free(maptel_report *report)
+{
+    if(report == NULL)
+        return;
+    if(report->cycle_members != NULL && report->cycle_offsets != NULL) {
+        unsigned long members = report->cycle_offsets[report->cycle_count];
+        for(unsigned long i = 0; i < members; i ++)
+            free(report->cycle_members[i]);
+    }
+    free(report->length_counts);
+    free(report->longest_source);
+    free(report->cycle_offsets);
+    free(report->cycle_members);
+    memset(report, 0, sizeof(*report));
+}
+
+void maptel_freeze(unsigned long id)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]freeze:\n" << std::flush;
     if(!MapTel::exists(id))
-        debug_err() << "erase: maptel of id = "
-            << id << " does not exist!\n" << std::flush;
+        debug_err() << "freeze: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
     assert(MapTel::exists(id));
-    if(tel_src != NULL) {
-        String src = String(tel_src);
-        MapTel::getMapTel(id).erase(src);
-    }
+    if(MapTel::exists(id))
+        MapTel::getMapTel(id).freeze();
 }
 
-void maptel_transform
-(unsigned long id, const char *tel_src, char *tel_dst, size_t len)
+int maptel_journal_open(unsigned long id, const char *path,
+                        size_t group_bytes, unsigned long group_usec)
 {
-    debug_info() << "[id=" << id << "]transform:\n" << std::flush;
-    if(tel_src == NULL)
-        debug_err() << "transform: tel_src is NULL!\n" << std::flush;
-    if(tel_dst == NULL)
-        debug_err() << "transform: tel_dst is NULL!\n" << std::flush;
-    if(len < 1)
-        debug_err() << "transform: len must be >= 1!\n" << std::flush;
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]journal_open:\n" << std::flush;
+    if(path == NULL)
+        debug_err() << "journal_open: path is NULL!\n" << std::flush;
     if(!MapTel::exists(id))
-        debug_err() << "transform: maptel of id = " << id
+        debug_err() << "journal_open: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(path != NULL);
+    assert(MapTel::exists(id));
+    if(path == NULL || !MapTel::exists(id))
+        return -1;
+    return MapTel::getMapTel(id).openJournal(path, group_bytes, group_usec)
+        ? 0 : -1;
+}
+
+int maptel_journal_sync(unsigned long id)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]journal_sync:\n" << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "journal_sync: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(MapTel::exists(id));
+    if(!MapTel::exists(id))
+        return -1;
+    return MapTel::getMapTel(id).syncJournal() ? 0 : -1;
+}
+
+int maptel_journal_close(unsigned long id)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]journal_close:\n" << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "journal_close: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(MapTel::exists(id));
+    if(!MapTel::exists(id))
+        return -1;
+    return MapTel::getMapTel(id).closeJournal() ? 0 : -1;
+}
+
+int maptel_checkpoint(unsigned long id, const char *snapshot_path)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]checkpoint:\n" << std::flush;
+    if(snapshot_path == NULL)
+        debug_err() << "checkpoint: snapshot_path is NULL!\n" << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "checkpoint: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(snapshot_path != NULL);
+    assert(MapTel::exists(id));
+    if(snapshot_path == NULL || !MapTel::exists(id))
+        return -1;
+    return MapTel::getMapTel(id).checkpoint(snapshot_path) ? 0 : -1;
+}
+
+int maptel_recover(const char *snapshot_path, const char *journal_path,
+                   unsigned long *id)
+{
+    debug_info() << "recover:\n" << std::flush;
+    if(journal_path == NULL || id == NULL)
+        debug_err() << "recover: journal_path or id is NULL!\n" << std::flush;
+    assert(journal_path != NULL);
+    assert(id != NULL);
+    if(journal_path == NULL || id == NULL)
+        return -1;
+    std::vector<TelJournal::Record> records;
+    if(!TelJournal::recover(journal_path, records))
+        return -1;
+    Integer created;
+    if(snapshot_path == NULL)
+        created = MapTel::createMapTel(0).getId();
+    else if(maptel_open_snapshot(snapshot_path, &created) != 0)
+        return -1;
+    MapTel::IdPin pin(created);
+    MapTel::getMapTel(created).replay(records);
+    *id = created;
+    return 0;
+}
+
+/** Returns maptel of given handle. */
+static MapTel& fromHandle(maptel_handle_t handle)
+{
+    return *reinterpret_cast<MapTel*>(handle);
+}
+
+/** Copies `number` to `tel_dst` if it fits in `len` bytes
+ *  (reporting an error otherwise), `name` is the caller's name. */
+static void writeResult(const char* name, const String& number,
+                        char* tel_dst, size_t len)
+{
+    if(len < number.size() + 1)
+        debug_err() << name << ": amount of given memory (" << len
+            << "B) is to small for writing returned dest: "
+            << "#\"" << number << "\\0\" = " << number.size() + 1
+            << " > " << len << ".\n" << std::flush;
+    assert(number.size() + 1 <= len);
+    copyNumber(number, tel_dst, len);
+}
+
+maptel_handle_t maptel_open(unsigned long id)
+{
+    debug_info() << "[id=" << id << "]open:\n" << std::flush;
+    MapTel* maptel = MapTel::openHandle(id);
+    if(maptel == NULL)
+        debug_err() << "open: maptel of id = " << id
             << " does not exist!\n" << std::flush;
+    assert(maptel != NULL);
+    return reinterpret_cast<maptel_handle_t>(maptel);
+}
+
+void maptel_close(maptel_handle_t handle)
+{
+    if(handle == NULL)
+        debug_err() << "close: handle is NULL!\n" << std::flush;
+    assert(handle != NULL);
+    if(handle != NULL)
+        MapTel::closeHandle(fromHandle(handle));
+}
+
+void maptel_h_insert
+(maptel_handle_t handle, const char *tel_src, const char *tel_dst)
+{
+    if(handle == NULL || tel_src == NULL || tel_dst == NULL)
+        debug_err() << "h_insert: handle, tel_src or tel_dst is NULL!\n"
+            << std::flush;
+    assert(handle != NULL);
+    assert(tel_src != NULL);
+    assert(tel_dst != NULL);
+    if(handle != NULL && tel_src != NULL && tel_dst != NULL)
+        fromHandle(handle).insert(String(tel_src), String(tel_dst));
+}
+
+void maptel_h_erase(maptel_handle_t handle, const char *tel_src)
+{
+    if(handle == NULL || tel_src == NULL)
+        debug_err() << "h_erase: handle or tel_src is NULL!\n" << std::flush;
+    assert(handle != NULL);
+    assert(tel_src != NULL);
+    if(handle != NULL && tel_src != NULL)
+        fromHandle(handle).erase(String(tel_src));
+}
+
+void maptel_h_transform
+(maptel_handle_t handle, const char *tel_src, char *tel_dst, size_t len)
+{
+    if(handle == NULL || tel_src == NULL || tel_dst == NULL)
+        debug_err() << "h_transform: handle, tel_src or tel_dst is NULL!\n"
+            << std::flush;
+    if(len < 1)
+        debug_err() << "h_transform: len must be >= 1!\n" << std::flush;
+    assert(handle != NULL);
     assert(tel_src != NULL);
     assert(tel_dst != NULL);
     assert(len >= 1);
-    assert(MapTel::exists(id));
-    if(tel_src != NULL && tel_dst != NULL && len > 1 && MapTel::exists(id)) {
-        const String src = String(tel_src);
-        const String dst = MapTel::getMapTel(id).transform(src);
-        if(len < dst.size() + 1)
-            debug_err() << "transform: amount "
-                << "of given memory (" << sizeof(char) * len
-                << "B) is to small for writing returned dest: "
-                << "#\"" << dst << "\\0\" = " << dst.size() + 1
-                << " > " << len << ".\n" << std::flush;
-        else
-            debug_info() << "transform: amount "
-                << "of given memory (" << sizeof(char) * len << "B) correct: "
-                << "#\"" << dst << "\\0\" = " << dst.size() + 1
-                << " <= " << len << ".\n" << std::flush;
-        assert(dst.size() + 1 <= len);
-        for(size_t i = 0; i < dst.size(); i ++)
-            tel_dst[i] = dst.at(i);
-        tel_dst[dst.size()] = '\0';
-    }
+    if(handle != NULL && tel_src != NULL && tel_dst != NULL && len >= 1)
+        writeResult("h_transform", fromHandle(handle).transform(String(tel_src)),
+                    tel_dst, len);
 }
 
-int maptel_is_cyclic(unsigned long id, const char *tel_src)
+int maptel_h_is_cyclic(maptel_handle_t handle, const char *tel_src)
 {
-    debug_info() << "[id=" << id << "]isCyclic:\n" << std::flush;
-    if(tel_src == NULL)
-        debug_err() << "isCyclic: tel_src is NULL!\n" << std::flush;
+    if(handle == NULL || tel_src == NULL)
+        debug_err() << "h_is_cyclic: handle or tel_src is NULL!\n"
+            << std::flush;
+    assert(handle != NULL);
     assert(tel_src != NULL);
-    if(!MapTel::exists(id))
-        debug_err() << "isCyclic: maptel of id = "
-            << id << " does not exist!\n";
-    assert(MapTel::exists(id));
-    if(tel_src != NULL && MapTel::exists(id)) {
-        const String src = String(tel_src);
-        return static_cast<int>(MapTel::getMapTel(id).isCyclic(src));
-    }
+    if(handle != NULL && tel_src != NULL)
+        return static_cast<int>(fromHandle(handle).isCyclic(String(tel_src)));
     return -1;
 }
 
-void maptel_transform_ex
-(unsigned long id, const char *tel_src, char *tel_dst, size_t len)
+void maptel_h_transform_ex
+(maptel_handle_t handle, const char *tel_src, char *tel_dst, size_t len)
 {
-    debug_info() << "[id=" << id << "]transform:\n" << std::flush;
-    if(tel_src == NULL)
-        debug_err() << "transform: tel_src is NULL!\n" << std::flush;
-    if(tel_dst == NULL)
-        debug_err() << "transform: tel_dst is NULL!\n" << std::flush;
+    if(handle == NULL || tel_src == NULL || tel_dst == NULL)
+        debug_err() << "h_transform_ex: handle, tel_src or tel_dst is NULL!\n"
+            << std::flush;
     if(len < 1)
-        debug_err() << "transform: len must be >= 1!\n" << std::flush;
-    if(!MapTel::exists(id))
-        debug_err() << "transform: maptel of id = " << id
-            << " does not exist!\n" << std::flush;
+        debug_err() << "h_transform_ex: len must be >= 1!\n" << std::flush;
+    assert(handle != NULL);
     assert(tel_src != NULL);
     assert(tel_dst != NULL);
     assert(len >= 1);
+    if(handle != NULL && tel_src != NULL && tel_dst != NULL && len >= 1)
+        writeResult("h_transform_ex",
+                    fromHandle(handle).transformEx(String(tel_src)),
+                    tel_dst, len);
+}
+
+unsigned long maptel_h_id(maptel_handle_t handle)
+{
+    if(handle == NULL)
+        debug_err() << "h_id: handle is NULL!\n" << std::flush;
+    assert(handle != NULL);
+    if(handle != NULL)
+        return fromHandle(handle).getId();
+    return 0;
+}
+
+void maptel_h_insert_n(maptel_handle_t handle,
+                       const char *tel_src, size_t src_len,
+                       const char *tel_dst, size_t dst_len)
+{
+    if(handle == NULL || tel_src == NULL || tel_dst == NULL)
+        debug_err() << "h_insert_n: handle, tel_src or tel_dst is NULL!\n"
+            << std::flush;
+    assert(handle != NULL);
+    assert(tel_src != NULL);
+    assert(tel_dst != NULL);
+    if(handle != NULL && tel_src != NULL && tel_dst != NULL)
+        fromHandle(handle).insert(String(tel_src, src_len),
+                                  String(tel_dst, dst_len));
+}
+
+void maptel_h_erase_n
+(maptel_handle_t handle, const char *tel_src, size_t src_len)
+{
+    if(handle == NULL || tel_src == NULL)
+        debug_err() << "h_erase_n: handle or tel_src is NULL!\n"
+            << std::flush;
+    assert(handle != NULL);
+    assert(tel_src != NULL);
+    if(handle != NULL && tel_src != NULL)
+        fromHandle(handle).erase(String(tel_src, src_len));
+}
+
+int maptel_h_is_cyclic_n
+(maptel_handle_t handle, const char *tel_src, size_t src_len)
+{
+    if(handle == NULL || tel_src == NULL)
+        debug_err() << "h_is_cyclic_n: handle or tel_src is NULL!\n"
+            << std::flush;
+    assert(handle != NULL);
+    assert(tel_src != NULL);
+    if(handle != NULL && tel_src != NULL)
+        return static_cast<int>(
+            fromHandle(handle).isCyclic(String(tel_src, src_len)));
+    return -1;
+}
+
+/** maptel_h_transform_n() (`ex` selects transformEx()). */
+static size_t transformSized(const char* name, maptel_handle_t handle,
+                             const char* tel_src, size_t src_len,
+                             char* tel_dst, size_t len, bool ex)
+{
+    if(handle == NULL || tel_src == NULL)
+        debug_err() << name << ": handle or tel_src is NULL!\n"
+            << std::flush;
+    if(tel_dst == NULL && len > 0)
+        debug_err() << name << ": tel_dst is NULL!\n" << std::flush;
+    assert(handle != NULL);
+    assert(tel_src != NULL);
+    assert(tel_dst != NULL || len == 0);
+    if(handle == NULL || tel_src == NULL || (tel_dst == NULL && len > 0))
+        return static_cast<size_t>(-1);
+    const MapTel& maptel = fromHandle(handle);
+    return ex ? maptel.transformExInto(tel_src, src_len, tel_dst, len)
+              : maptel.transformInto(tel_src, src_len, tel_dst, len);
+}
+
+size_t maptel_h_transform_n(maptel_handle_t handle,
+                            const char *tel_src, size_t src_len,
+                            char *tel_dst, size_t len)
+{
+    return transformSized("h_transform_n", handle, tel_src, src_len,
+                          tel_dst, len, false);
+}
+
+size_t maptel_h_transform_ex_n(maptel_handle_t handle,
+                               const char *tel_src, size_t src_len,
+                               char *tel_dst, size_t len)
+{
+    return transformSized("h_transform_ex_n", handle, tel_src, src_len,
+                          tel_dst, len, true);
+}
+
+/** maptel_h_transform_view_n() (`ex` selects transformEx()). */
+static int transformViewSized(const char* name, maptel_handle_t handle,
+                              const char* tel_src, size_t src_len,
+                              const char** tel_dst, size_t* len, bool ex)
+{
+    if(handle == NULL || tel_src == NULL)
+        debug_err() << name << ": handle or tel_src is NULL!\n"
+            << std::flush;
+    if(tel_dst == NULL || len == NULL)
+        debug_err() << name << ": tel_dst or len is NULL!\n" << std::flush;
+    assert(handle != NULL);
+    assert(tel_src != NULL);
+    assert(tel_dst != NULL && len != NULL);
+    if(handle == NULL || tel_src == NULL || tel_dst == NULL || len == NULL)
+        return -1;
+    *len = src_len;
+    if(ex)
+        fromHandle(handle).transformExView(tel_src, *len, *tel_dst);
+    else
+        fromHandle(handle).transformView(tel_src, *len, *tel_dst);
+    return 0;
+}
+
+int maptel_h_transform_view_n(maptel_handle_t handle,
+                              const char *tel_src, size_t src_len,
+                              const char **tel_dst, size_t *len)
+{
+    return transformViewSized("h_transform_view_n", handle, tel_src,
+                              src_len, tel_dst, len, false);
+}
+
+int maptel_h_transform_ex_view_n(maptel_handle_t handle,
+                                 const char *tel_src, size_t src_len,
+                                 const char **tel_dst, size_t *len)
+{
+    return transformViewSized("h_transform_ex_view_n", handle, tel_src,
+                              src_len, tel_dst, len, true);
+}
+
+void maptel_h_release_views(maptel_handle_t handle)
+{
+    if(handle == NULL)
+        debug_err() << "h_release_views: handle is NULL!\n" << std::flush;
+    assert(handle != NULL);
+    if(handle != NULL)
+        fromHandle(handle).releaseViews();
+}
+
+void maptel_insert_prefix
+(unsigned long id, const char *prefix_src, const char *prefix_dst)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]insert_prefix:\n" << std::flush;
+    if(prefix_src == NULL || prefix_dst == NULL)
+        debug_err() << "insert_prefix: prefix_src or prefix_dst is NULL!\n"
+            << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "insert_prefix: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(prefix_src != NULL);
+    assert(prefix_dst != NULL);
     assert(MapTel::exists(id));
-    if(tel_src != NULL && tel_dst != NULL && MapTel::exists(id)) {
-        const String src = String(tel_src);
-        const String dst = MapTel::getMapTel(id).transformEx(src);
-        if(len < dst.size() + 1)
-            debug_err() << "transformEx: amount of "
-                << "given memory (" << sizeof(char) * len << "B) to small "
-                << "for writing returned dest: "
-                << "#\"" << dst << "\\0\" = " << dst.size() + 1
-                << " > " << len << ".\n" << std::flush;
-        else {
-            debug_info() << "transformEx: amount "
-                << "of given memory (" << sizeof(char) * len << "B) correct: "
-                << "#\"" << dst << "\\0\" = " << dst.size() + 1 << " <= "
-                << len << ".\n" << std::flush;
-            for(size_t i = 0; i < dst.size(); i ++)
-                tel_dst[i] = dst.at(i);
-            tel_dst[dst.size()] = '\0';
-        }
-        assert(dst.size() + 1 <= len);
-    }
+    if(prefix_src != NULL && prefix_dst != NULL && MapTel::exists(id))
+        MapTel::getMapTel(id).insertPrefix(String(prefix_src),
+                                           String(prefix_dst));
 }
 
+void maptel_erase_prefix(unsigned long id, const char *prefix_src)
+{
+    MapTel::IdPin pin(id);
+    debug_info() << "[id=" << id << "]erase_prefix:\n" << std::flush;
+    if(prefix_src == NULL)
+        debug_err() << "erase_prefix: prefix_src is NULL!\n" << std::flush;
+    if(!MapTel::exists(id))
+        debug_err() << "erase_prefix: maptel of id = " << id
+            << " does not exist!\n" << std::flush;
+    assert(prefix_src != NULL);
+    assert(MapTel::exists(id));
+    if(prefix_src != NULL && MapTel::exists(id))
+        MapTel::getMapTel(id).erasePrefix(String(prefix_src));
+}
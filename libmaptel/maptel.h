@@ -21,6 +21,57 @@ extern "C" {
  *   identificator of created maptel. */
 unsigned long maptel_create();
 
+/** Flags of maptel_create_ex(). */
+#define MAPTEL_HUGE_PAGES 1u
+#define MAPTEL_CONCURRENT_WRITES 2u
+#define MAPTEL_READ_MOSTLY 4u
+
+/** Creates new maptel like maptel_create().
+ * Small maptels keep transformations on the heap; from a few
+ * thousand transformations on they are kept in the maptel's own
+ * arena of chunks, which are freed at once by maptel_delete()
+ * (its 2 MB chunks are kept for arenas of later maptels).
+ * Args:
+ *   `flags`: MAPTEL_HUGE_PAGES backs the arena with transparent
+ *            huge pages (if the system supports them; pays off
+ *            for maptels of millions of transformations).
+ *            MAPTEL_CONCURRENT_WRITES spreads transformations
+ *            over lock striped tables: maptel_insert() and
+ *            maptel_erase() lock only the table of their source,
+ *            so writers of different sources run in parallel,
+ *            and queries (maptel_transform(), maptel_transform_ex(),
+ *            maptel_is_cyclic(), maptel_transform_ex_bounded(),
+ *            their handle and batch versions) take no locks, so
+ *            they never wait for writers. Chains are followed
+ *            hop by hop (a chain changed meanwhile is seen partly
+ *            before and partly after the change) and
+ *            maptel_is_cyclic() follows the whole chain. Memory
+ *            of replaced transformations is freed in batches once
+ *            no query may use it. The first call of any other
+ *            function on the maptel (maptel_clone(), maptel_save(),
+ *            views, prefix rules, journaling, ...) turns it into
+ *            an ordinary maptel for good.
+ *            MAPTEL_READ_MOSTLY (ignored with the flag above, whose
+ *            queries take no locks anyway) makes every modification
+ *            publish a read only version of all transformations with
+ *            results of maptel_transform_ex(),
+ *            which maptel_transform(), maptel_transform_ex(),
+ *            maptel_is_cyclic(), their handle and batch versions
+ *            read without locking the maptel, so their latency does
+ *            not depend on writers. A version shares its pages with
+ *            the maptel, so a modification copies only the pages it
+ *            writes (and a pointer per 64 transformations) and
+ *            updates results of the chains going through it; batches
+ *            and maptel_load_file() recompute all results once.
+ *            Versions are freed when no reader may use them any more.
+ *            Calls by id look their maptels up without locks
+ *            too (see maptel_swap()). Maptels with prefix
+ *            rules publish nothing and are queried as ordinary ones;
+ *            clones of read mostly maptels are read mostly too.
+ * Return value:
+ *   identificator of created maptel. */
+unsigned long maptel_create_ex(unsigned flags);
+
 /** Removes maptel of given `id`.
  * In debuglevel > 0: maptel of given `id` must exist.
  * In debuglevel = 0: if maptel of given `id` does not exist ->
@@ -94,8 +145,10 @@ int maptel_is_cyclic(unsigned long id, const char *tel_src);
  * to `tel_dst` using maximum of `len` bytes.
  * In debuglevel > 0: maptel of given `id` must exist.
  * `len` must be counted with string's terminal '\0'.
- * In debuglevel = 0, when cycle is found, one of values
- * in the cycle is given.
+ * In debuglevel > 0: the chain from `tel_src` must not lead to
+ * a cycle (a cycle fails an assertion).
+ * In debuglevel = 0, when cycle is found, the number at which
+ * the chain enters the cycle is given.
  * Args:
  *   `id`: maptel identificator.
  *   `tel_src`: source telephone number for transformation.
@@ -108,6 +161,590 @@ int maptel_is_cyclic(unsigned long id, const char *tel_src);
 void maptel_transform_ex
 (unsigned long id, const char *tel_src, char *tel_dst, size_t len);
 
+/** Follows at most `max_hops` transformations from `tel_src`
+ * in maptel of given `id` and copies the number it stops at
+ * to `tel_dst` using maximum of `len` bytes. Unlike
+ * maptel_transform_ex() it is safe for cyclic chains: they are
+ * followed around their cycles (in constant time per hop of
+ * the chain before the cycle and of the cycle itself, however
+ * large `max_hops` is). Nothing is allocated for numbers of
+ * up to 15 digits.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `tel_src`: source telephone number for transformation.
+ *   `tel_dst`: pointer to block of memory for the result.
+ *   `len`: size of memory allocated for the result (counted
+ *          with string's terminal '\0').
+ *   `max_hops`: maximal number of transformations to follow;
+ *               with ULONG_MAX a cyclic chain stops at the number
+ *               it enters its cycle at (as in maptel_transform_ex()
+ *               with debuglevel = 0).
+ * Return value:
+ *   `1` if the chain ends within `max_hops` transformations
+ *       (`tel_dst` is the same as of maptel_transform_ex()),
+ *   `0` if it does not (`tel_dst` is the number reached after
+ *       `max_hops` transformations),
+ *   `-1` if any of pointers is NULL, maptel does not exist
+ *       or `len` is too short to write the result. */
+int maptel_transform_ex_bounded(unsigned long id, const char *tel_src,
+                                char *tel_dst, size_t len,
+                                unsigned long max_hops);
+
+/** Gives transformation of given `tel_src` in maptel of given `id`
+ * (see maptel_transform()) without copying it: sets `*tel_dst`
+ * to the '\0' terminated destination and `*len` to its length.
+ * The destination is `tel_src` itself if there is no
+ * transformation, otherwise it is held by the maptel until the next
+ * modification of the maptel (maptel_freeze() too), its deletion
+ * or maptel_release_views(). A number is copied at most once while
+ * it is held, so repeated queries neither copy nor allocate.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `tel_src`: source telephone number for transformation.
+ *   `tel_dst`: receives pointer to the destination.
+ *   `len`: receives length of the destination.
+ * Return value:
+ *   `0` on success,
+ *   `-1` if any of pointers is NULL or maptel does not exist. */
+int maptel_transform_view(unsigned long id, const char *tel_src,
+                          const char **tel_dst, size_t *len);
+
+/** The same as maptel_transform_view() but gives recursive
+ * transformation (see maptel_transform_ex()). */
+int maptel_transform_ex_view(unsigned long id, const char *tel_src,
+                             const char **tel_dst, size_t *len);
+
+/** Invalidates all destinations given by maptel_transform_view()
+ * and maptel_transform_ex_view() for maptel of given `id`
+ * and frees memory holding them.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ * Return value:
+ *   none (void). */
+void maptel_release_views(unsigned long id);
+
+/** Inserts `count` transformations (`tel_src[i]` -> `tel_dst[i]`)
+ * into maptel of given `id`; the maptel is looked up and locked
+ * once for the whole batch.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `tel_src`: array of `count` source telephone numbers.
+ *   `tel_dst`: array of `count` destination telephone numbers.
+ *   `count`: number of transformations.
+ * Return value:
+ *   none (void). */
+void maptel_insert_batch(unsigned long id, const char * const *tel_src,
+                         const char * const *tel_dst, size_t count);
+
+/** Erases transformations of all given sources
+ * in maptel of given `id` (see maptel_erase()).
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `tel_src`: array of `count` source telephone numbers.
+ *   `count`: number of sources.
+ * Return value:
+ *   none (void). */
+void maptel_erase_batch(unsigned long id, const char * const *tel_src,
+                        size_t count);
+
+/** Gives single transformations of all given sources
+ * in maptel of given `id` (see maptel_transform()).
+ * Result for `tel_src[i]` is written to `tel_dst + i * len`;
+ * if it does not fit in `len` bytes an empty string is written.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `tel_src`: array of `count` source telephone numbers.
+ *   `tel_dst`: pointer to block of memory of `count * len` bytes
+ *              for the results.
+ *   `len`: size of memory for a single result
+ *          (counted with string's terminal '\0').
+ *   `count`: number of sources.
+ * Return value:
+ *   none (void). */
+void maptel_transform_batch(unsigned long id, const char * const *tel_src,
+                            char *tel_dst, size_t len, size_t count);
+
+/** Gives recursive transformations of all given sources
+ * in maptel of given `id` (see maptel_transform_ex()).
+ * Results are written as in maptel_transform_batch().
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `tel_src`: array of `count` source telephone numbers.
+ *   `tel_dst`: pointer to block of memory of `count * len` bytes
+ *              for the results.
+ *   `len`: size of memory for a single result
+ *          (counted with string's terminal '\0').
+ *   `count`: number of sources.
+ * Return value:
+ *   none (void). */
+void maptel_transform_ex_batch(unsigned long id, const char * const *tel_src,
+                               char *tel_dst, size_t len, size_t count);
+
+/** Inserts all transformations listed in numbering plan file
+ * `path` into maptel of given `id` (in file order, so later lines
+ * override earlier ones). Every line of the file holds source and
+ * destination number separated by spaces or tabs; empty lines
+ * and lines starting with '#' are ignored, malformed lines are
+ * skipped. The file is memory mapped and parsed in parallel.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `path`: path of the numbering plan file.
+ * Return value:
+ *   number of inserted transformations,
+ *  `-1` (`error`) if maptel does not exist or the file
+ *       cannot be read. */
+long maptel_load_file(unsigned long id, const char *path);
+
+/** Saves all transformations of maptel of given `id` to snapshot
+ * file `path`: a versioned and checksummed binary image (holding
+ * also results of maptel_transform_ex() and maptel_is_cyclic())
+ * which can be opened by maptel_open_snapshot(). The file is
+ * replaced atomically.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `path`: path of the snapshot file.
+ * Return value:
+ *   `0` if the snapshot has been written,
+ *  `-1` (`error`) if maptel does not exist or the file
+ *       cannot be written. */
+int maptel_save(unsigned long id, const char *path);
+
+/** Creates a new maptel answering queries directly from snapshot
+ * file `path` written by maptel_save(). The file is memory mapped
+ * read only and shared, so opening costs one pass verifying it
+ * and processes opening the same snapshot share its memory.
+ * The first modification of the maptel copies the snapshot
+ * into private memory.
+ * Args:
+ *   `path`: path of the snapshot file.
+ *   `id`: receives identificator of the new maptel.
+ * Return value:
+ *   `0` if the maptel has been created,
+ *  `-1` (`error`) if the file cannot be read, is not a snapshot,
+ *       has different version or is corrupted (no maptel
+ *       is created then). */
+int maptel_open_snapshot(const char *path, unsigned long *id);
+
+/** Creates a new maptel with the same transformations and prefix
+ * rules as maptel of given `id`. Cloning takes constant time:
+ * the maptels share their tables, which are split into small
+ * pages, and a later modification of either copies only the pages
+ * it touches (the first one copies also the list of pages).
+ * Clones of frozen or snapshot maptels are full copies. The journal
+ * is not cloned.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: identificator of the cloned maptel.
+ *   `clone_id`: receives identificator of the new maptel.
+ * Return value:
+ *   `0` if the maptel has been cloned,
+ *  `-1` (`error`) if maptel of given `id` does not exist. */
+int maptel_clone(unsigned long id, unsigned long *clone_id);
+
+/** Atomically publishes transformations of maptel `id_staged` under
+ * `id_live`: the maptels are exchanged, so `id_live` refers to the
+ * staged transformations, prefix rules and journal, and `id_staged`
+ * to the old ones (delete it to free them or keep it to swap back).
+ * A query by id sees either the old or the new transformations, never
+ * a mix of them; calls by id look ids up without locks (a maptel
+ * deleted meanwhile is destroyed after they return) and the swap only
+ * exchanges two pointers, so the staged maptel should be built (or
+ * cloned and modified, see maptel_clone()) before. Handles keep
+ * querying the transformations they were opened on: the old ones
+ * are destroyed when `id_staged` is deleted and the last such handle
+ * is closed.
+ * In debuglevel > 0: both maptels must exist.
+ * Args:
+ *   `id_live`: identificator of the maptel to be refreshed.
+ *   `id_staged`: identificator of the maptel holding new contents.
+ * Return value:
+ *   `0` if the maptels have been swapped,
+ *  `-1` (`error`) if either of them does not exist. */
+int maptel_swap(unsigned long id_live, unsigned long id_staged);
+
+/** Freezes maptel of given `id`: its transformations are moved to
+ * a read only table laid out for lookups touching a single cache
+ * line (holding also results of maptel_transform_ex() and
+ * maptel_is_cyclic()). Queries of a frozen maptel do not lock it,
+ * so any number of threads query it without contention. A frozen
+ * maptel cannot be modified (insert, erase, prefix rules and
+ * maptel_load_file() do nothing and report an error); it can still
+ * be saved (maptel_save()) and deleted.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ * Return value:
+ *   none (void). */
+void maptel_freeze(unsigned long id);
+
+/** Starts journaling modifications of maptel of given `id` to file
+ * `path` (appending if it exists, so an existing journal must be
+ * recovered first by maptel_recover()). Modifications are buffered
+ * and committed in groups (one write and one fdatasync() each):
+ * when `group_bytes` bytes of records are buffered or `group_usec`
+ * microseconds after the first buffered modification, whichever
+ * comes first (without threads: checked on every modification).
+ * Replaces the previous journal of the maptel.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `path`: path of the journal file.
+ *   `group_bytes`: commit size threshold (0: commit every record).
+ *   `group_usec`: commit time threshold.
+ * Return value:
+ *   `0` if journaling has started,
+ *  `-1` (`error`) if maptel does not exist or the file
+ *       cannot be opened or is not a journal. */
+int maptel_journal_open(unsigned long id, const char *path,
+                        size_t group_bytes, unsigned long group_usec);
+
+/** Commits all journaled modifications of maptel of given `id`.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ * Return value:
+ *   `0` if modifications are durable,
+ *  `-1` (`error`) if maptel does not exist, is not journaled
+ *       or the journal cannot be written. */
+int maptel_journal_sync(unsigned long id);
+
+/** Commits all journaled modifications of maptel of given `id`
+ * and stops journaling (deleting a maptel does it as well).
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ * Return value:
+ *   `0` if modifications are durable,
+ *  `-1` (`error`) if maptel does not exist, is not journaled
+ *       or the journal cannot be written. */
+int maptel_journal_close(unsigned long id);
+
+/** Saves snapshot of maptel of given `id` to file `snapshot_path`
+ * (see maptel_save()) and empties its journal, which holds
+ * modifications made after the snapshot only then.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `snapshot_path`: path of the snapshot file.
+ * Return value:
+ *   `0` if the checkpoint has been made,
+ *  `-1` (`error`) if maptel does not exist or a file
+ *       cannot be written. */
+int maptel_checkpoint(unsigned long id, const char *snapshot_path);
+
+/** Creates a new maptel from snapshot `snapshot_path` (see
+ * maptel_open_snapshot(), NULL: start empty) and replays committed
+ * modifications of journal `journal_path` on top of it (a missing
+ * journal is empty). A group torn by a crash is cut off the journal,
+ * which can be reopened by maptel_journal_open() then.
+ * Args:
+ *   `snapshot_path`: path of the snapshot file or NULL.
+ *   `journal_path`: path of the journal file.
+ *   `id`: receives identificator of the new maptel.
+ * Return value:
+ *   `0` if the maptel has been recovered,
+ *  `-1` (`error`) if a file cannot be read or is corrupted
+ *       (no maptel is created then). */
+int maptel_recover(const char *snapshot_path, const char *journal_path,
+                   unsigned long *id);
+
+/** Inserts prefix rule (`prefix_src` -> `prefix_dst`) into maptel
+ * of given `id`: a number starting with `prefix_src` has it replaced
+ * with `prefix_dst` (for example rule 4822 -> 4812 transforms 4822555
+ * into 4812555). A number is transformed by its exact transformation
+ * (maptel_insert()) if it has one, otherwise by the rule of its
+ * longest prefix having a rule. maptel_transform_ex() follows both
+ * kinds; chains of prefix rules making numbers longer without end
+ * are treated as cycles.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `prefix_src`: prefix of source numbers (non empty digits).
+ *   `prefix_dst`: replacement of the prefix (non empty digits).
+ * Return value:
+ *   none (void). */
+void maptel_insert_prefix
+(unsigned long id, const char *prefix_src, const char *prefix_dst);
+
+/** Erases prefix rule of given `prefix_src` (rules of other
+ * prefixes, also longer or shorter ones, stay).
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `prefix_src`: prefix of the rule, that is to be deleted.
+ * Return value:
+ *   none (void). */
+void maptel_erase_prefix(unsigned long id, const char *prefix_src);
+
+/** Callback receiving numbers found by maptel_sources_of() and
+ * maptel_preimage(), one call per number.
+ * Args:
+ *   `tel`: the number ('\0' terminated, valid during the call).
+ *   `arg`: argument given to the query.
+ * Return value:
+ *   `0` to continue, non zero to stop the query. */
+typedef int (*maptel_number_fn)(const char *tel, void *arg);
+
+/** Gives all sources of transformations to `tel_dst` in maptel
+ * of given `id` (the numbers which maptel_transform() changes into
+ * `tel_dst`; prefix rules are not reversed), in no particular
+ * order. The maptel keeps an index of sources of every destination,
+ * so the time is proportional to the number of results (a frozen
+ * or snapshot maptel is scanned whole). Results are collected
+ * first, so `callback` may use the maptel.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `tel_dst`: destination telephone number.
+ *   `callback`: called for every source.
+ *   `arg`: passed to `callback`.
+ * Return value:
+ *   number of calls of `callback`,
+ *  `-1` (`error`) if any of pointers is NULL or maptel
+ *       does not exist. */
+long maptel_sources_of(unsigned long id, const char *tel_dst,
+                       maptel_number_fn callback, void *arg);
+
+/** Gives all sources whose chains of transformations pass through
+ * `tel_dst` in maptel of given `id` (the transitive closure of
+ * maptel_sources_of(); `tel_dst` itself is given only if it lies
+ * on a cycle), each once, in no particular order. The time is
+ * proportional to the number of results (a frozen or snapshot
+ * maptel is scanned whole). Results are collected first, so
+ * `callback` may use the maptel.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `tel_dst`: destination telephone number.
+ *   `callback`: called for every source.
+ *   `arg`: passed to `callback`.
+ * Return value:
+ *   number of calls of `callback`,
+ *  `-1` (`error`) if any of pointers is NULL or maptel
+ *       does not exist. */
+long maptel_preimage(unsigned long id, const char *tel_dst,
+                     maptel_number_fn callback, void *arg);
+
+/** Callback receiving results of maptel_resolve_all(), one call
+ * per source.
+ * Args:
+ *   `tel_src`: source of a transformation ('\0' terminated, valid
+ *              during the call).
+ *   `tel_dst`: maptel_transform_ex() of `tel_src`; if the chain is
+ *              cyclic, the number it enters its cycle at.
+ *   `cyclic`: `1` if maptel_is_cyclic() is true for `tel_src`,
+ *             `0` otherwise.
+ *   `arg`: argument given to maptel_resolve_all().
+ * Return value:
+ *   `0` to continue, non zero to stop. */
+typedef int (*maptel_resolve_fn)
+(const char *tel_src, const char *tel_dst, int cyclic, void *arg);
+
+/** Resolves every source of a transformation in maptel of given
+ * `id` at once: `callback` receives the source, its final
+ * destination and cycle flag. Every transformation is followed
+ * once, so the time is linear in the number of transformations
+ * (maptel_transform_ex() of every source is not, when chains are
+ * long); with prefix rules every source is followed separately.
+ * Sources are given in no particular order; frozen and snapshot
+ * maptels hold the results already. `callback` runs while
+ * the maptel is locked, so it must not call functions of libmaptel.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `callback`: called for every source.
+ *   `arg`: passed to `callback`.
+ * Return value:
+ *   number of calls of `callback`,
+ *  `-1` (`error`) if `callback` is NULL or maptel does not exist. */
+long maptel_resolve_all(unsigned long id, maptel_resolve_fn callback,
+                        void *arg);
+
+/** The same as maptel_resolve_all(), but up to `threads` threads
+ * (`0`: one per processor) resolve independent components of
+ * the graph of transformations (numbers linked by them); small
+ * maptels are resolved by one thread. `callback` is still called
+ * from the calling thread only, in the same order. */
+long maptel_resolve_all_parallel(unsigned long id, unsigned threads,
+                                 maptel_resolve_fn callback, void *arg);
+
+/** Statistics of chains of transformations of a maptel (see
+ * maptel_analyze()). The chain of a source uses the transformations
+ * maptel_transform_ex() follows from it (for a cyclic chain: the
+ * ones before its cycle and all of the cycle); prefix rules are
+ * not followed. */
+typedef struct maptel_report {
+    /** number of transformations (sources); */
+    unsigned long sources;
+    /** number of chains: sources which are not destinations of any
+     *  transformation (so chains going around a cycle only are not
+     *  counted); */
+    unsigned long chains;
+    /** number of sources whose chains lead to cycles; */
+    unsigned long cyclic_sources;
+    /** `length_counts[k]` is the number of sources whose chains use
+     *  k transformations, for k < `length_count_size`; */
+    unsigned long *length_counts;
+    unsigned long length_count_size;
+    /** source of the longest chain ("" if there are no
+     *  transformations) and the length of the chain; */
+    char *longest_source;
+    unsigned long longest_length;
+    /** number of distinct cycles; members of the i-th one are
+     *  `cycle_members[cycle_offsets[i]]`, ...,
+     *  `cycle_members[cycle_offsets[i + 1] - 1]`, starting at
+     *  the first member in order of the transformations; */
+    unsigned long cycle_count;
+    unsigned long *cycle_offsets;
+    char **cycle_members;
+} maptel_report;
+
+/** Fills `report` with statistics of chains of transformations
+ * of maptel of given `id`. All chains are analyzed at once by up
+ * to one thread per processor, every transformation is followed
+ * once (maptel_is_cyclic() of every source is not linear in the
+ * number of transformations when chains are long). Frozen and
+ * snapshot maptels are copied first. The report must be released
+ * with maptel_report_free().
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ *   `report`: pointer to the report to fill.
+ * Return value:
+ *   `0` on success,
+ *  `-1` (`error`) if `report` is NULL, maptel does not exist
+ *       or memory for the report cannot be allocated. */
+int maptel_analyze(unsigned long id, maptel_report *report);
+
+/** Frees memory of a report filled by maptel_analyze() (the report
+ * is zeroed, so freeing it again does nothing).
+ * Args:
+ *   `report`: the report.
+ * Return value:
+ *   none (void). */
+void maptel_report_free(maptel_report *report);
+
+/** Opaque handle of a maptel (see maptel_open()). */
+typedef struct maptel_handle *maptel_handle_t;
+
+/** Opens handle of maptel of given `id`. Calls taking the handle
+ * (maptel_h_*) work directly on the maptel, without looking up and
+ * validating the id. The maptel stays usable through the handle
+ * (but not by its id) after maptel_delete(), until the handle
+ * is closed.
+ * In debuglevel > 0: maptel of given `id` must exist.
+ * Args:
+ *   `id`: maptel identificator.
+ * Return value:
+ *   handle of the maptel,
+ *   NULL (`error`) if maptel does not exist. */
+maptel_handle_t maptel_open(unsigned long id);
+
+/** Closes handle opened by maptel_open().
+ * Args:
+ *   `handle`: handle of a maptel.
+ * Return value:
+ *   none (void). */
+void maptel_close(maptel_handle_t handle);
+
+/** maptel_insert() on maptel of given `handle`. */
+void maptel_h_insert
+(maptel_handle_t handle, const char *tel_src, const char *tel_dst);
+
+/** maptel_erase() on maptel of given `handle`. */
+void maptel_h_erase(maptel_handle_t handle, const char *tel_src);
+
+/** maptel_transform() on maptel of given `handle`;
+ * an empty string is written if the result does not fit
+ * in `len` bytes. */
+void maptel_h_transform
+(maptel_handle_t handle, const char *tel_src, char *tel_dst, size_t len);
+
+/** maptel_is_cyclic() on maptel of given `handle`. */
+int maptel_h_is_cyclic(maptel_handle_t handle, const char *tel_src);
+
+/** maptel_transform_ex() on maptel of given `handle`;
+ * an empty string is written if the result does not fit
+ * in `len` bytes. */
+void maptel_h_transform_ex
+(maptel_handle_t handle, const char *tel_src, char *tel_dst, size_t len);
+
+/** Gives identificator of maptel of given `handle` (it changes
+ * when the maptel is swapped, see maptel_swap()).
+ * Args:
+ *   `handle`: handle of a maptel.
+ * Return value:
+ *   identificator of the maptel,
+ *   `0` (`error`) if `handle` is NULL. */
+unsigned long maptel_h_id(maptel_handle_t handle);
+
+/* Calls below take numbers with their lengths (`tel_src` of
+ * `src_len` characters need not be '\0' terminated), so they are
+ * not counted. maptel_h_transform_n() and maptel_h_transform_ex_n()
+ * look numbers up by their digits and write results straight to
+ * `tel_dst` (numbers are copied to strings only for maptels with
+ * prefix rules, opened snapshots and by maptel_h_transform_ex_n()
+ * of MAPTEL_CONCURRENT_WRITES maptels). The other calls copy their
+ * numbers to strings first (modifications store them anyway). */
+
+/** maptel_h_insert() of `src_len` characters of `tel_src`
+ * and `dst_len` characters of `tel_dst`. */
+void maptel_h_insert_n(maptel_handle_t handle,
+                       const char *tel_src, size_t src_len,
+                       const char *tel_dst, size_t dst_len);
+
+/** maptel_h_erase() of `src_len` characters of `tel_src`. */
+void maptel_h_erase_n
+(maptel_handle_t handle, const char *tel_src, size_t src_len);
+
+/** maptel_h_is_cyclic() of `src_len` characters of `tel_src`. */
+int maptel_h_is_cyclic_n
+(maptel_handle_t handle, const char *tel_src, size_t src_len);
+
+/** Gives transformation of `src_len` characters of `tel_src`
+ * in maptel of given `handle` (see maptel_transform()). Like
+ * snprintf() it writes the '\0' terminated result to `tel_dst`
+ * only if it fits in `len` bytes and returns its length anyway,
+ * so a too short `tel_dst` can be replaced by a long enough one.
+ * Return value:
+ *   length of the result (without '\0'); nothing is written
+ *   if it is not less than `len`,
+ *   `(size_t) -1` (`error`) if `handle` or `tel_src` is NULL. */
+size_t maptel_h_transform_n(maptel_handle_t handle,
+                            const char *tel_src, size_t src_len,
+                            char *tel_dst, size_t len);
+
+/** The same as maptel_h_transform_n() but gives recursive
+ * transformation (see maptel_transform_ex()). */
+size_t maptel_h_transform_ex_n(maptel_handle_t handle,
+                               const char *tel_src, size_t src_len,
+                               char *tel_dst, size_t len);
+
+/** maptel_transform_view() of `src_len` characters of `tel_src`
+ * in maptel of given `handle`. The destination is '\0' terminated
+ * unless it is `tel_src` itself (there is no transformation). */
+int maptel_h_transform_view_n(maptel_handle_t handle,
+                              const char *tel_src, size_t src_len,
+                              const char **tel_dst, size_t *len);
+
+/** maptel_transform_ex_view() of `src_len` characters of `tel_src`
+ * in maptel of given `handle` (see maptel_h_transform_view_n()). */
+int maptel_h_transform_ex_view_n(maptel_handle_t handle,
+                                 const char *tel_src, size_t src_len,
+                                 const char **tel_dst, size_t *len);
+
+/** maptel_release_views() on maptel of given `handle`. */
+void maptel_h_release_views(maptel_handle_t handle);
+
 #ifdef __cplusplus
 }
 #endif
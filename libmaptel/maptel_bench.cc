@@ -0,0 +1,1684 @@
+/** Maptel benchmarks.                   *
+ *  author: Cezary Bartoszuk             *
+ *  e-mail: cbart@students.mimuw.edu.pl  *
+ *  usage:                               *
+ *    maptel_bench scaling [max_threads] [entries] [queries]  *
+ *    maptel_bench table [entries] [queries]                  *
+ *    maptel_bench batch [entries] [batch_size]               *
+ *    maptel_bench load [entries]                             *
+ *    maptel_bench snapshot [entries] [queries]               *
+ *    maptel_bench journal [entries] [group_bytes] [group_usec] *
+ *    maptel_bench ids [maptels] [rounds]                     *
+ *    maptel_bench handle [entries] [queries]                 *
+ *    maptel_bench prefix [rules] [queries]                   *
+ *    maptel_bench freeze [max_threads] [entries] [queries]   *
+ *    maptel_bench clone [entries] [edits]                    *
+ *    maptel_bench swap [entries] [rounds]                    *
+ *    maptel_bench reverse [entries] [queries]                *
+ *    maptel_bench resolve [max_threads] [entries]            *
+ *    maptel_bench analyze [entries]                          *
+ *    maptel_bench intern [maptels] [entries]                 *
+ *    maptel_bench arena [maptels] [entries]                  *
+ *    maptel_bench walk [entries] [max_hops]                  *
+ *    maptel_bench view [entries] [queries]                   *
+ *    maptel_bench cxx [entries] [queries]                    *
+ *    maptel_bench writers [max_threads] [entries] [operations] *
+ *    maptel_bench readers [threads] [entries] [queries]      */
+
+#include <map>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <time.h>
+#include <unistd.h>
+
+#include "./maptel.h"
+#if __cplusplus >= 201703L
+#include "./maptel_map.h"
+#endif
+#include "./rw_lock.h"
+#include "./hash_table.h"
+#include "./cow_table.h"
+
+#if MAPTEL_CONCURRENT
+#include <pthread.h>
+#endif
+
+typedef unsigned long Integer;
+
+typedef std::string String;
+
+/** Length of every chain of transformations inserted by benchmarks. */
+const Integer CHAIN_LENGTH = 8;
+
+/** Returns monotonic time in seconds. */
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** Simple xorshift generator (rand() is not thread safe). */
+class Random {
+
+    private:
+
+        unsigned long long state;
+
+    public:
+
+        explicit Random(unsigned long long seed)
+            : state(seed * 2685821657736338717ULL + 1)
+        {
+        }
+
+        unsigned long long next()
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 2685821657736338717ULL;
+        }
+
+};
+
+/** Returns `count` distinct 11 digit phone numbers. */
+std::vector<String> makeNumbers(Integer count)
+{
+    std::vector<String> numbers;
+    numbers.reserve(count);
+    char buffer[32];
+    for(Integer i = 0; i < count; i ++) {
+        /* 48 prefix + 9 digits; multiplying by an odd constant
+         * modulo 10^9 keeps numbers distinct and scattered. */
+        unsigned long long body = (i * 387420489ULL + 12345) % 1000000000ULL;
+        snprintf(buffer, sizeof(buffer), "48%09llu", body);
+        numbers.push_back(String(buffer));
+    }
+    return numbers;
+}
+
+/** Fills maptel `id` with chains of CHAIN_LENGTH transformations. */
+void fillChains(unsigned long id, const std::vector<String>& numbers)
+{
+    for(Integer i = 0; i + 1 < numbers.size(); i ++)
+        if((i + 1) % CHAIN_LENGTH != 0)
+            maptel_insert(id, numbers[i].c_str(), numbers[i + 1].c_str());
+}
+
+/** Arguments and result of a single benchmarking thread. */
+struct ScalingTask {
+    unsigned long id;
+    const std::vector<String>* numbers;
+    Integer queries;
+    Integer seed;
+    Integer checksum;
+};
+
+/** Runs mixed read queries (transform, transformEx, isCyclic). */
+void* scalingWorker(void* arg)
+{
+    ScalingTask* task = static_cast<ScalingTask*>(arg);
+    const std::vector<String>& numbers = *task->numbers;
+    Random random(task->seed);
+    char tel_dst[128];
+    Integer checksum = 0;
+    for(Integer i = 0; i < task->queries; i ++) {
+        const char* src = numbers[random.next() % numbers.size()].c_str();
+        switch(i % 4) {
+            case 0:
+            case 1:
+                maptel_transform(task->id, src, tel_dst, sizeof(tel_dst));
+                break;
+            case 2:
+                maptel_transform_ex(task->id, src, tel_dst, sizeof(tel_dst));
+                break;
+            default:
+                tel_dst[0] = '0' + maptel_is_cyclic(task->id, src);
+                break;
+        }
+        checksum += tel_dst[0];
+    }
+    task->checksum = checksum;
+    return NULL;
+}
+
+/** Prints read throughput of maptel `id` queried by 1, 2, ...,
+ *  `max_threads` threads (see scalingWorker()). */
+void runScaling(unsigned long id, const std::vector<String>& numbers,
+                Integer max_threads, Integer queries)
+{
+    std::cout << "threads     Mops/s    speedup\n";
+    double base = 0.0;
+    for(Integer threads = 1; threads <= max_threads; threads ++) {
+        std::vector<ScalingTask> tasks(threads);
+        for(Integer t = 0; t < threads; t ++) {
+            tasks[t].id = id;
+            tasks[t].numbers = &numbers;
+            tasks[t].queries = queries;
+            tasks[t].seed = t + 1;
+            tasks[t].checksum = 0;
+        }
+        double start = now();
+#if MAPTEL_CONCURRENT
+        std::vector<pthread_t> workers(threads);
+        for(Integer t = 0; t < threads; t ++)
+            pthread_create(&workers[t], NULL, scalingWorker, &tasks[t]);
+        for(Integer t = 0; t < threads; t ++)
+            pthread_join(workers[t], NULL);
+#else
+        scalingWorker(&tasks[0]);
+#endif
+        double elapsed = now() - start;
+        double mops = threads * queries / elapsed / 1e6;
+        if(threads == 1)
+            base = mops;
+        std::cout << std::setw(7) << threads
+            << std::setw(11) << std::fixed << std::setprecision(3) << mops
+            << std::setw(11) << std::setprecision(2) << mops / base
+            << "\n" << std::flush;
+    }
+}
+
+/** Measures read throughput of a single shared maptel
+ *  with 1, 2, ..., `max_threads` querying threads. */
+int benchScaling(Integer max_threads, Integer entries, Integer queries)
+{
+#if !MAPTEL_CONCURRENT
+    if(max_threads > 1)
+        std::cerr << "scaling: library built without concurrent mode, "
+            << "running single thread only.\n";
+    max_threads = 1;
+#endif
+    std::vector<String> numbers = makeNumbers(entries);
+    unsigned long id = maptel_create();
+    fillChains(id, numbers);
+    std::cout << "scaling: " << entries << " entries, "
+        << queries << " queries per thread\n";
+    runScaling(id, numbers, max_threads, queries);
+    maptel_delete(id);
+    return 0;
+}
+
+/** The same as benchScaling() but for a mutable and then
+ *  for the same maptel frozen (queried without locking). */
+int benchFreeze(Integer max_threads, Integer entries, Integer queries)
+{
+#if !MAPTEL_CONCURRENT
+    if(max_threads > 1)
+        std::cerr << "freeze: library built without concurrent mode, "
+            << "running single thread only.\n";
+    max_threads = 1;
+#endif
+    std::vector<String> numbers = makeNumbers(entries);
+    unsigned long id = maptel_create();
+    fillChains(id, numbers);
+    std::cout << "freeze: " << entries << " entries, "
+        << queries << " queries per thread\nmutable:\n";
+    runScaling(id, numbers, max_threads, queries);
+    double start = now();
+    maptel_freeze(id);
+    std::cout << "frozen (freeze took " << std::fixed
+        << std::setprecision(3) << now() - start << " s):\n";
+    runScaling(id, numbers, max_threads, queries);
+    maptel_delete(id);
+    return 0;
+}
+
+/** Prints throughput of a table (see benchTable()). */
+void reportTable(const char* name, Integer entries, Integer queries,
+                 double start, double inserted, double queried,
+                 double erased)
+{
+    std::cout << std::setw(10) << name
+        << std::setw(15) << std::fixed << std::setprecision(3)
+        << entries / (inserted - start) / 1e6
+        << std::setw(15) << queries / (queried - inserted) / 1e6
+        << std::setw(15) << entries / 2 / (erased - queried) / 1e6
+        << "\n" << std::flush;
+}
+
+/** Inserts all `numbers` (i -> i + 1) into std::map, queries it
+ *  `queries` times (every second query misses) and erases every
+ *  second number. */
+Integer benchStdMap(const std::vector<String>& numbers,
+                    const std::vector<String>& misses, Integer queries)
+{
+    std::map<String, String> table;
+    double start = now();
+    for(Integer i = 0; i < numbers.size(); i ++)
+        table[numbers[i]] = numbers[(i + 1) % numbers.size()];
+    double inserted = now();
+    Random random(1);
+    Integer checksum = 0;
+    for(Integer i = 0; i < queries; i ++) {
+        Integer index = random.next() % numbers.size();
+        const String& key = (i % 2 == 0) ? numbers[index] : misses[index];
+        std::map<String, String>::const_iterator it = table.find(key);
+        if(it != table.end())
+            checksum += it->second.size();
+    }
+    double queried = now();
+    for(Integer i = 0; i < numbers.size(); i += 2)
+        table.erase(numbers[i]);
+    reportTable("std::map", numbers.size(), queries,
+                start, inserted, queried, now());
+    return checksum;
+}
+
+/** The same as benchStdMap() but for HashTable or CowTable (`name`);
+ *  if `copied`, a copy of the table is kept while it is erased from,
+ *  so erasures copy pages the copy shares. */
+template<typename Table>
+Integer benchHashTable(const char* name, bool copied,
+                       const std::vector<String>& numbers,
+                       const std::vector<String>& misses, Integer queries)
+{
+    Table table;
+    double start = now();
+    for(Integer i = 0; i < numbers.size(); i ++)
+        table.insert(numbers[i], numbers[(i + 1) % numbers.size()]);
+    double inserted = now();
+    Random random(1);
+    Integer checksum = 0;
+    for(Integer i = 0; i < queries; i ++) {
+        Integer index = random.next() % numbers.size();
+        const String& key = (i % 2 == 0) ? numbers[index] : misses[index];
+        const String* value = table.find(key);
+        if(value != NULL)
+            checksum += value->size();
+    }
+    Table copy;
+    if(copied)
+        copy = table;
+    double queried = now();
+    for(Integer i = 0; i < numbers.size(); i += 2)
+        table.erase(numbers[i]);
+    reportTable(name, numbers.size(), queries,
+                start, inserted, queried, now());
+    return checksum;
+}
+
+/** Compares insert, lookup and erase throughput of std::map,
+ *  of HashTable and of CowTable (maptel's storage engine), also
+ *  one sharing its pages with a copy. */
+int benchTable(Integer entries, Integer queries)
+{
+    std::vector<String> numbers = makeNumbers(entries);
+    std::vector<String> misses(numbers.size());
+    for(Integer i = 0; i < numbers.size(); i ++)
+        misses[i] = numbers[i] + "0";
+    std::cout << "table: " << entries << " entries, "
+        << queries << " queries (50% hits)\n"
+        << "     table   insert Mops/s   lookup Mops/s    erase Mops/s\n";
+    Integer map_checksum = benchStdMap(numbers, misses, queries);
+    Integer hash_checksum = benchHashTable<
+        HashTable<String, String, StringHash> >("HashTable", false,
+                                                numbers, misses, queries);
+    Integer cow_checksum = benchHashTable<
+        CowTable<String, String, StringHash> >("CowTable", false,
+                                               numbers, misses, queries);
+    Integer copied_checksum = benchHashTable<
+        CowTable<String, String, StringHash> >("copied", true,
+                                               numbers, misses, queries);
+    return (map_checksum == hash_checksum && hash_checksum == cow_checksum
+            && cow_checksum == copied_checksum) ? 0 : 1;
+}
+
+/** Prints throughput of `operations` done in `seconds`. */
+void reportBatch(const char* name, Integer operations, double seconds)
+{
+    std::cout << std::setw(20) << name
+        << std::setw(11) << std::fixed << std::setprecision(3)
+        << operations / seconds / 1e6 << "\n" << std::flush;
+}
+
+/** Compares single calls with batched calls of the C API. */
+int benchBatch(Integer entries, Integer batch_size)
+{
+    std::vector<String> numbers = makeNumbers(entries);
+    std::vector<const char*> sources(entries);
+    std::vector<const char*> destinations(entries);
+    for(Integer i = 0; i < entries; i ++) {
+        sources[i] = numbers[i].c_str();
+        destinations[i] = numbers[(i + 1) % entries].c_str();
+    }
+    const size_t len = 32;
+    std::vector<char> results(batch_size * len);
+    std::cout << "batch: " << entries << " entries, batches of "
+        << batch_size << "\n"
+        << "           operation     Mops/s\n";
+
+    unsigned long single = maptel_create();
+    double start = now();
+    for(Integer i = 0; i < entries; i ++)
+        maptel_insert(single, sources[i], destinations[i]);
+    reportBatch("insert", entries, now() - start);
+
+    unsigned long batched = maptel_create();
+    start = now();
+    for(Integer i = 0; i < entries; i += batch_size)
+        maptel_insert_batch(batched, &sources[i], &destinations[i],
+                            std::min(batch_size, entries - i));
+    reportBatch("insert_batch", entries, now() - start);
+
+    start = now();
+    for(Integer i = 0; i < entries; i ++)
+        maptel_transform(single, sources[i], &results[0], len);
+    reportBatch("transform", entries, now() - start);
+
+    start = now();
+    for(Integer i = 0; i < entries; i += batch_size)
+        maptel_transform_batch(batched, &sources[i], &results[0], len,
+                               std::min(batch_size, entries - i));
+    reportBatch("transform_batch", entries, now() - start);
+
+    /* the whole maptel is a single cycle, erase every 8th
+     * transformation to get straight chains; */
+    for(Integer i = 0; i < entries; i += CHAIN_LENGTH) {
+        maptel_erase(single, sources[i]);
+        maptel_erase(batched, sources[i]);
+    }
+    start = now();
+    for(Integer i = 0; i < entries; i ++)
+        maptel_transform_ex(single, sources[i], &results[0], len);
+    reportBatch("transform_ex", entries, now() - start);
+
+    start = now();
+    for(Integer i = 0; i < entries; i += batch_size)
+        maptel_transform_ex_batch(batched, &sources[i], &results[0], len,
+                                  std::min(batch_size, entries - i));
+    reportBatch("transform_ex_batch", entries, now() - start);
+
+    start = now();
+    for(Integer i = 0; i < entries; i ++)
+        maptel_erase(single, sources[i]);
+    reportBatch("erase", entries, now() - start);
+
+    start = now();
+    for(Integer i = 0; i < entries; i += batch_size)
+        maptel_erase_batch(batched, &sources[i],
+                           std::min(batch_size, entries - i));
+    reportBatch("erase_batch", entries, now() - start);
+
+    maptel_delete(single);
+    maptel_delete(batched);
+    return 0;
+}
+
+/** Compares maptel_load_file() with reading the same numbering
+ *  plan line by line and calling maptel_insert(). */
+int benchLoad(Integer entries)
+{
+    std::vector<String> numbers = makeNumbers(entries);
+    char path[] = "/tmp/maptel_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0) {
+        std::cerr << "load: cannot create temporary file.\n";
+        return 1;
+    }
+    FILE* plan = fdopen(fd, "w");
+    for(Integer i = 0; i + 1 < numbers.size(); i ++)
+        if((i + 1) % CHAIN_LENGTH != 0)
+            fprintf(plan, "%s %s\n", numbers[i].c_str(),
+                    numbers[i + 1].c_str());
+    fclose(plan);
+    std::cout << "load: " << entries << " numbers in chains of "
+        << CHAIN_LENGTH << "\n"
+        << "           operation    seconds\n";
+
+    unsigned long single = maptel_create();
+    double start = now();
+    plan = fopen(path, "r");
+    char source[128];
+    char destination[128];
+    while(fscanf(plan, "%127s %127s", source, destination) == 2)
+        maptel_insert(single, source, destination);
+    fclose(plan);
+    std::cout << std::setw(20) << "fscanf + insert"
+        << std::setw(11) << std::fixed << std::setprecision(3)
+        << now() - start << "\n" << std::flush;
+
+    unsigned long loaded = maptel_create();
+    start = now();
+    long count = maptel_load_file(loaded, path);
+    std::cout << std::setw(20) << "load_file"
+        << std::setw(11) << std::fixed << std::setprecision(3)
+        << now() - start << "\n" << std::flush;
+
+    unlink(path);
+    maptel_delete(single);
+    maptel_delete(loaded);
+    return (count < 0) ? 1 : 0;
+}
+
+/** Compares starting a maptel from a numbering plan (maptel_load_file())
+ *  with opening its snapshot, and queries on both maptels. */
+int benchSnapshot(Integer entries, Integer queries)
+{
+    std::vector<String> numbers = makeNumbers(entries);
+    char plan_path[] = "/tmp/maptel_bench_XXXXXX";
+    int fd = mkstemp(plan_path);
+    if(fd < 0) {
+        std::cerr << "snapshot: cannot create temporary file.\n";
+        return 1;
+    }
+    FILE* plan = fdopen(fd, "w");
+    for(Integer i = 0; i + 1 < numbers.size(); i ++)
+        if((i + 1) % CHAIN_LENGTH != 0)
+            fprintf(plan, "%s %s\n", numbers[i].c_str(),
+                    numbers[i + 1].c_str());
+    fclose(plan);
+    String snapshot_path = String(plan_path) + ".snapshot";
+    std::cout << "snapshot: " << entries << " numbers in chains of "
+        << CHAIN_LENGTH << ", " << queries << " queries\n"
+        << "           operation    seconds\n";
+
+    unsigned long loaded = maptel_create();
+    double start = now();
+    long count = maptel_load_file(loaded, plan_path);
+    std::cout << std::setw(20) << "load_file"
+        << std::setw(11) << std::fixed << std::setprecision(3)
+        << now() - start << "\n";
+
+    start = now();
+    int saved = maptel_save(loaded, snapshot_path.c_str());
+    std::cout << std::setw(20) << "save"
+        << std::setw(11) << std::fixed << std::setprecision(3)
+        << now() - start << "\n";
+
+    unsigned long opened = 0;
+    start = now();
+    int open_result = maptel_open_snapshot(snapshot_path.c_str(), &opened);
+    std::cout << std::setw(20) << "open_snapshot"
+        << std::setw(11) << std::fixed << std::setprecision(3)
+        << now() - start << "\n" << std::flush;
+
+    if(open_result == 0) {
+        const unsigned long ids[2] = { loaded, opened };
+        const char* names[2] = { "transform_ex (heap)",
+                                 "transform_ex (snap)" };
+        char result[64];
+        for(int m = 0; m < 2; m ++) {
+            Random random(1);
+            start = now();
+            for(Integer i = 0; i < queries; i ++)
+                maptel_transform_ex(ids[m],
+                    numbers[random.next() % entries].c_str(),
+                    result, sizeof(result));
+            std::cout << std::setw(20) << names[m]
+                << std::setw(11) << std::fixed << std::setprecision(3)
+                << now() - start << "\n" << std::flush;
+        }
+        maptel_delete(opened);
+    }
+
+    unlink(plan_path);
+    unlink(snapshot_path.c_str());
+    maptel_delete(loaded);
+    return (count < 0 || saved != 0 || open_result != 0) ? 1 : 0;
+}
+
+/** Measures the cost of journaling on the insert path: the same
+ *  inserts into a plain and into a journaled maptel. */
+int benchJournal(Integer entries, Integer group_bytes, Integer group_usec)
+{
+    std::vector<String> numbers = makeNumbers(entries);
+    char path[] = "/tmp/maptel_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0) {
+        std::cerr << "journal: cannot create temporary file.\n";
+        return 1;
+    }
+    close(fd);
+    unlink(path);
+    std::cout << "journal: " << entries << " inserts, groups of "
+        << group_bytes << "B or " << group_usec << "us\n"
+        << "           operation    seconds   ns/insert\n";
+
+    unsigned long plain = maptel_create();
+    unsigned long journaled = maptel_create();
+    if(maptel_journal_open(journaled, path, group_bytes, group_usec) != 0) {
+        std::cerr << "journal: cannot open journal.\n";
+        return 1;
+    }
+    const unsigned long ids[2] = { plain, journaled };
+    const char* names[2] = { "insert", "journaled insert" };
+    double seconds[2];
+    for(int m = 0; m < 2; m ++) {
+        double start = now();
+        for(Integer i = 0; i + 1 < entries; i ++)
+            maptel_insert(ids[m], numbers[i].c_str(), numbers[i + 1].c_str());
+        if(m == 1)
+            maptel_journal_sync(journaled);
+        seconds[m] = now() - start;
+        std::cout << std::setw(20) << names[m]
+            << std::setw(11) << std::fixed << std::setprecision(3)
+            << seconds[m] << std::setw(12) << std::setprecision(1)
+            << seconds[m] * 1e9 / entries << "\n" << std::flush;
+    }
+    std::cout << std::setw(20) << "journaling cost"
+        << std::setw(23) << std::fixed << std::setprecision(1)
+        << (seconds[1] - seconds[0]) * 1e9 / entries << "\n";
+
+    maptel_delete(plain);
+    maptel_delete(journaled);
+    unlink(path);
+    return 0;
+}
+
+/** Measures short-lived maptels (create, insert, transform, delete)
+ *  and id resolution with many live maptels. */
+int benchIds(Integer maptels, Integer rounds)
+{
+    std::cout << "ids: " << maptels << " live maptels, " << rounds
+        << " rounds\n"
+        << "           operation    seconds     ns/call\n";
+    std::vector<unsigned long> ids(maptels);
+    for(Integer i = 0; i < maptels; i ++)
+        ids[i] = maptel_create();
+    char result[64];
+
+    double start = now();
+    for(Integer i = 0; i < rounds; i ++) {
+        unsigned long id = maptel_create();
+        maptel_insert(id, "123", "456");
+        maptel_transform(id, "123", result, sizeof(result));
+        maptel_delete(id);
+    }
+    double seconds = now() - start;
+    std::cout << std::setw(20) << "short-lived maptel"
+        << std::setw(11) << std::fixed << std::setprecision(3) << seconds
+        << std::setw(12) << std::setprecision(1) << seconds * 1e9 / rounds
+        << "\n" << std::flush;
+
+    Random random(1);
+    start = now();
+    for(Integer i = 0; i < rounds; i ++)
+        maptel_is_cyclic(ids[random.next() % maptels], "123");
+    seconds = now() - start;
+    std::cout << std::setw(20) << "is_cyclic"
+        << std::setw(11) << std::fixed << std::setprecision(3) << seconds
+        << std::setw(12) << std::setprecision(1) << seconds * 1e9 / rounds
+        << "\n" << std::flush;
+
+    for(Integer i = 0; i < maptels; i ++)
+        maptel_delete(ids[i]);
+    return 0;
+}
+
+/** Compares queries by id with queries by handle. */
+int benchHandle(Integer entries, Integer queries)
+{
+    std::vector<String> numbers = makeNumbers(entries);
+    unsigned long id = maptel_create();
+    fillChains(id, numbers);
+    maptel_handle_t handle = maptel_open(id);
+    std::cout << "handle: " << entries << " numbers, " << queries
+        << " queries\n"
+        << "           operation    seconds     ns/call\n";
+    char result[64];
+    for(int m = 0; m < 4; m ++) {
+        Random random(1);
+        double start = now();
+        for(Integer i = 0; i < queries; i ++) {
+            const char* source = numbers[random.next() % entries].c_str();
+            switch(m) {
+                case 0:
+                    maptel_transform(id, source, result, sizeof(result));
+                    break;
+                case 1:
+                    maptel_h_transform(handle, source, result, sizeof(result));
+                    break;
+                case 2:
+                    maptel_transform_ex(id, source, result, sizeof(result));
+                    break;
+                default:
+                    maptel_h_transform_ex(handle, source, result,
+                                          sizeof(result));
+            }
+        }
+        double seconds = now() - start;
+        const char* names[4] = { "transform", "h_transform",
+                                 "transform_ex", "h_transform_ex" };
+        std::cout << std::setw(20) << names[m]
+            << std::setw(11) << std::fixed << std::setprecision(3) << seconds
+            << std::setw(12) << std::setprecision(1)
+            << seconds * 1e9 / queries << "\n" << std::flush;
+    }
+    maptel_close(handle);
+    maptel_delete(id);
+    return 0;
+}
+
+/** Measures queries of numbers transformed by prefix rules. */
+int benchPrefix(Integer rules, Integer queries)
+{
+    std::vector<String> numbers = makeNumbers(queries < 1000000 ? queries
+                                                                : 1000000);
+    unsigned long id = maptel_create();
+    Random random(7);
+    char prefix[16];
+    char destination[16];
+    for(Integer i = 0; i < rules; i ++) {
+        /* prefixes of 3 to 7 digits, renumbering into another area; */
+        int length = 3 + static_cast<int>(random.next() % 5);
+        unsigned long long value = random.next();
+        for(int d = 0; d < length; d ++) {
+            prefix[d] = static_cast<char>('0' + (value >> (4 * d)) % 10);
+            destination[d] = (d == 0) ? '9' : prefix[d];
+        }
+        prefix[length] = destination[length] = '\0';
+        maptel_insert_prefix(id, prefix, destination);
+    }
+    std::cout << "prefix: " << rules << " rules, " << queries << " queries\n"
+        << "           operation    seconds     ns/call\n";
+    char result[64];
+    for(int m = 0; m < 2; m ++) {
+        Random picks(1);
+        double start = now();
+        for(Integer i = 0; i < queries; i ++) {
+            const char* source =
+                numbers[picks.next() % numbers.size()].c_str();
+            if(m == 0)
+                maptel_transform(id, source, result, sizeof(result));
+            else
+                maptel_transform_ex(id, source, result, sizeof(result));
+        }
+        double seconds = now() - start;
+        const char* names[2] = { "transform", "transform_ex" };
+        std::cout << std::setw(20) << names[m]
+            << std::setw(11) << std::fixed << std::setprecision(3) << seconds
+            << std::setw(12) << std::setprecision(1)
+            << seconds * 1e9 / queries << "\n" << std::flush;
+    }
+    maptel_delete(id);
+    return 0;
+}
+
+/** Measures staging a renumbering: cloning a maptel (compared
+ *  with copying it by inserts) and editing the clone. */
+int benchClone(Integer entries, Integer edits)
+{
+    std::vector<String> numbers = makeNumbers(entries);
+    unsigned long id = maptel_create();
+    fillChains(id, numbers);
+    std::cout << "clone: " << entries << " numbers in chains of "
+        << CHAIN_LENGTH << ", " << edits << " edits\n"
+        << "           operation    seconds\n";
+
+    double start = now();
+    unsigned long copy = maptel_create();
+    fillChains(copy, numbers);
+    std::cout << std::setw(20) << "copy by inserts"
+        << std::setw(11) << std::fixed << std::setprecision(6)
+        << now() - start << "\n" << std::flush;
+
+    unsigned long clone = 0;
+    start = now();
+    int result = maptel_clone(id, &clone);
+    std::cout << std::setw(20) << "clone"
+        << std::setw(11) << std::fixed << std::setprecision(6)
+        << now() - start << "\n" << std::flush;
+
+    if(result == 0) {
+        const unsigned long ids[2] = { copy, clone };
+        const char* names[2] = { "edit copy", "edit clone" };
+        for(int m = 0; m < 2; m ++) {
+            Random random(1);
+            start = now();
+            for(Integer i = 0; i < edits; i ++)
+                maptel_insert(ids[m], numbers[random.next() % entries].c_str(),
+                              numbers[random.next() % entries].c_str());
+            std::cout << std::setw(20) << names[m]
+                << std::setw(11) << std::fixed << std::setprecision(6)
+                << now() - start << "\n" << std::flush;
+        }
+        maptel_delete(clone);
+    }
+    maptel_delete(copy);
+    maptel_delete(id);
+    return (result == 0) ? 0 : 1;
+}
+
+/** Reader of a maptel being refreshed (see benchSwap()). */
+struct SwapTask {
+    unsigned long id;
+    const std::vector<String>* numbers;
+    /** set by the refreshing thread to stop the reader; */
+    int stop;
+    Integer reads;
+    /** reads not finding a transformation which is in every
+     *  version of the maptel (reads of a half updated maptel); */
+    Integer missing;
+    double max_latency;
+};
+
+/** Transforms numbers having a transformation until stopped. */
+void* swapReader(void* arg)
+{
+    SwapTask* task = static_cast<SwapTask*>(arg);
+    const std::vector<String>& numbers = *task->numbers;
+    Random random(1);
+    char tel_dst[128];
+    while(!__atomic_load_n(&task->stop, __ATOMIC_RELAXED)) {
+        Integer i = random.next() % numbers.size();
+        /* last numbers of chains have no transformation; */
+        if((i + 1) % CHAIN_LENGTH == 0 || i + 1 == numbers.size())
+            continue;
+        double start = now();
+        maptel_transform(task->id, numbers[i].c_str(), tel_dst,
+                         sizeof(tel_dst));
+        task->max_latency = std::max(task->max_latency, now() - start);
+        task->reads ++;
+        if(numbers[i] == tel_dst)
+            task->missing ++;
+    }
+    return NULL;
+}
+
+/** Compares refreshing a maptel queried by another thread in place
+ *  (erasing and inserting all transformations) with building
+ *  a staged maptel and publishing it with maptel_swap(). */
+int benchSwap(Integer entries, Integer rounds)
+{
+#if !MAPTEL_CONCURRENT
+    std::cerr << "swap: library built without concurrent mode.\n";
+    return 1;
+#else
+    std::vector<String> numbers = makeNumbers(entries);
+    unsigned long live = maptel_create();
+    fillChains(live, numbers);
+    std::cout << "swap: " << entries << " numbers in chains of "
+        << CHAIN_LENGTH << ", " << rounds << " refreshes\n"
+        << "           operation    seconds       reads     missing"
+        << "  max read [ms]\n";
+    const char* names[2] = { "in place", "staged + swap" };
+    for(int m = 0; m < 2; m ++) {
+        SwapTask task = { live, &numbers, 0, 0, 0, 0.0 };
+        pthread_t reader;
+        pthread_create(&reader, NULL, swapReader, &task);
+        double start = now();
+        for(Integer r = 0; r < rounds; r ++) {
+            if(m == 0) {
+                for(Integer i = 0; i < numbers.size(); i ++)
+                    maptel_erase(live, numbers[i].c_str());
+                fillChains(live, numbers);
+                continue;
+            }
+            unsigned long staged = maptel_create();
+            fillChains(staged, numbers);
+            maptel_swap(live, staged);
+            maptel_delete(staged);
+        }
+        double seconds = now() - start;
+        __atomic_store_n(&task.stop, 1, __ATOMIC_RELAXED);
+        pthread_join(reader, NULL);
+        std::cout << std::setw(20) << names[m]
+            << std::setw(11) << std::fixed << std::setprecision(3) << seconds
+            << std::setw(12) << task.reads
+            << std::setw(12) << task.missing
+            << std::setw(15) << task.max_latency * 1e3 << "\n" << std::flush;
+    }
+    maptel_delete(live);
+    return 0;
+#endif
+}
+
+/** Counts numbers given by maptel_sources_of() and maptel_preimage(). */
+int countNumber(const char* tel, void* arg)
+{
+    (void) tel;
+    ++ *static_cast<Integer*>(arg);
+    return 0;
+}
+
+/** Measures maptel_sources_of() and maptel_preimage() of a mutable
+ *  maptel (indexed) and of its frozen clone (scanned). */
+int benchReverse(Integer entries, Integer queries)
+{
+    std::vector<String> numbers = makeNumbers(entries);
+    unsigned long id = maptel_create();
+    fillChains(id, numbers);
+    unsigned long frozen = 0;
+    maptel_clone(id, &frozen);
+    maptel_freeze(frozen);
+    std::cout << "reverse: " << entries << " numbers in chains of "
+        << CHAIN_LENGTH << ", " << queries << " queries\n"
+        << "           operation    seconds     us/call     results\n";
+    const char* names[4] = { "sources_of", "preimage",
+                             "frozen sources_of", "frozen preimage" };
+    for(int m = 0; m < 4; m ++) {
+        Random random(1);
+        Integer found = 0;
+        /* frozen maptels are scanned, so they get fewer queries; */
+        Integer count = (m < 2) ? queries : queries / 100000 + 1;
+        double start = now();
+        for(Integer i = 0; i < count; i ++) {
+            const char* number = numbers[random.next() % entries].c_str();
+            if(m % 2 == 0)
+                maptel_sources_of((m < 2) ? id : frozen, number,
+                                  countNumber, &found);
+            else
+                maptel_preimage((m < 2) ? id : frozen, number,
+                                countNumber, &found);
+        }
+        double seconds = now() - start;
+        std::cout << std::setw(20) << names[m]
+            << std::setw(11) << std::fixed << std::setprecision(3) << seconds
+            << std::setw(12) << std::setprecision(2)
+            << seconds * 1e6 / count
+            << std::setw(12) << found << "\n" << std::flush;
+    }
+    maptel_delete(frozen);
+    maptel_delete(id);
+    return 0;
+}
+
+/** Counts sources given by maptel_resolve_all() (and adds lengths
+ *  of their destinations to the checksum after the count). */
+int countResolved(const char* tel_src, const char* tel_dst, int cyclic,
+                  void* arg)
+{
+    (void) tel_src;
+    Integer* counters = static_cast<Integer*>(arg);
+    counters[0] ++;
+    counters[1] += strlen(tel_dst) + cyclic;
+    return 0;
+}
+
+/** Compares maptel_transform_ex() of every source with
+ *  maptel_resolve_all() and maptel_resolve_all_parallel() with 1, 2,
+ *  ..., `max_threads` threads. */
+int benchResolve(Integer max_threads, Integer entries)
+{
+#if !MAPTEL_CONCURRENT
+    if(max_threads > 1)
+        std::cerr << "resolve: library built without concurrent mode, "
+            << "running single thread only.\n";
+    max_threads = 1;
+#endif
+    std::vector<String> numbers = makeNumbers(entries);
+    std::cout << "resolve: " << entries << " numbers in chains of "
+        << CHAIN_LENGTH << "\n"
+        << "           operation    seconds   ns/source    checksum\n";
+    for(Integer m = 0; m < max_threads + 2; m ++) {
+        /* a fresh maptel, so transformEx() memoizes nothing before; */
+        unsigned long id = maptel_create();
+        fillChains(id, numbers);
+        Integer counters[2] = { 0, 0 };
+        char result[64];
+        double start = now();
+        if(m == 0)
+            for(Integer i = 0; i < entries; i ++) {
+                if((i + 1) % CHAIN_LENGTH == 0)
+                    continue;
+                maptel_transform_ex(id, numbers[i].c_str(), result,
+                                    sizeof(result));
+                counters[0] ++;
+                counters[1] += strlen(result);
+            }
+        else if(m == 1)
+            maptel_resolve_all(id, countResolved, counters);
+        else
+            maptel_resolve_all_parallel(id, m - 1, countResolved, counters);
+        double seconds = now() - start;
+        std::ostringstream name;
+        if(m == 0)
+            name << "transform_ex";
+        else if(m == 1)
+            name << "resolve_all";
+        else
+            name << "parallel x" << m - 1;
+        std::cout << std::setw(20) << name.str()
+            << std::setw(11) << std::fixed << std::setprecision(3) << seconds
+            << std::setw(12) << std::setprecision(1)
+            << seconds * 1e9 / counters[0]
+            << std::setw(12) << counters[1] << "\n" << std::flush;
+        maptel_delete(id);
+    }
+    return 0;
+}
+
+/** Compares maptel_is_cyclic() of every source with maptel_analyze()
+ *  of chains of which every tenth one is closed into a cycle. */
+int benchAnalyze(Integer entries)
+{
+    std::vector<String> numbers = makeNumbers(entries);
+    unsigned long id = maptel_create();
+    fillChains(id, numbers);
+    for(Integer i = CHAIN_LENGTH - 1; i < entries; i += 10 * CHAIN_LENGTH)
+        maptel_insert(id, numbers[i].c_str(),
+                      numbers[i + 1 - CHAIN_LENGTH].c_str());
+    std::cout << "analyze: " << entries << " numbers in chains of "
+        << CHAIN_LENGTH << "\n";
+    double start = now();
+    Integer cyclic = 0;
+    for(Integer i = 0; i < entries; i ++)
+        cyclic += maptel_is_cyclic(id, numbers[i].c_str());
+    std::cout << "is_cyclic of every number: " << std::fixed
+        << std::setprecision(3) << now() - start << " s, " << cyclic
+        << " cyclic\n";
+    maptel_report report;
+    start = now();
+    maptel_analyze(id, &report);
+    std::cout << "analyze: " << std::fixed << std::setprecision(3)
+        << now() - start << " s, " << report.sources << " sources, "
+        << report.chains << " chains, " << report.cyclic_sources
+        << " cyclic, " << report.cycle_count << " cycles, longest chain "
+        << report.longest_length << " from " << report.longest_source
+        << "\nlength     sources\n";
+    for(unsigned long k = 0; k < report.length_count_size; k ++)
+        if(report.length_counts[k] != 0)
+            std::cout << std::setw(6) << k << std::setw(12)
+                << report.length_counts[k] << "\n";
+    maptel_report_free(&report);
+    maptel_delete(id);
+    return 0;
+}
+
+/** Returns resident memory of the process in bytes. */
+Integer residentBytes()
+{
+    unsigned long pages = 0;
+    unsigned long resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if(statm != NULL) {
+        if(fscanf(statm, "%lu %lu", &pages, &resident) != 2)
+            resident = 0;
+        fclose(statm);
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+/** Fills `maptels` maptels with the same chains of 20 digit numbers
+ *  (too long to be packed) and measures memory and queries. */
+int benchIntern(Integer maptels, Integer entries)
+{
+    std::vector<String> numbers = makeNumbers(entries);
+    for(Integer i = 0; i < entries; i ++)
+        numbers[i] = "004812345" + numbers[i];
+    std::cout << "intern: " << maptels << " maptels of " << entries
+        << " 20 digit numbers in chains of " << CHAIN_LENGTH << "\n";
+    Integer before = residentBytes();
+    std::vector<unsigned long> ids(maptels);
+    double start = now();
+    for(Integer m = 0; m < maptels; m ++) {
+        ids[m] = maptel_create();
+        fillChains(ids[m], numbers);
+    }
+    double seconds = now() - start;
+    std::cout << "insert: " << std::fixed << std::setprecision(3)
+        << seconds << " s, " << std::setprecision(1)
+        << (residentBytes() - before) / 1048576.0 << " MB\n";
+    char result[64];
+    Random random(1);
+    start = now();
+    for(Integer i = 0; i < entries; i ++)
+        maptel_transform_ex(ids[i % maptels],
+                            numbers[random.next() % entries].c_str(),
+                            result, sizeof(result));
+    std::cout << "transform_ex: " << std::setprecision(1)
+        << (now() - start) * 1e9 / entries << " ns/call\n";
+    start = now();
+    for(Integer m = 0; m < maptels; m ++)
+        maptel_delete(ids[m]);
+    std::cout << "delete: " << std::setprecision(3) << now() - start
+        << " s\n";
+    return 0;
+}
+
+/** Fills `maptels` maptels created with given `flags` (see
+ *  maptel_create_ex()), queries and deletes them one by one. */
+void benchArenaFlags(const char* name, unsigned flags, Integer maptels,
+                     const std::vector<String>& numbers)
+{
+    std::vector<unsigned long> ids(maptels);
+    double start = now();
+    for(Integer m = 0; m < maptels; m ++) {
+        ids[m] = maptel_create_ex(flags);
+        fillChains(ids[m], numbers);
+    }
+    double inserted = now();
+    char result[64];
+    Random random(1);
+    for(Integer i = 0; i < numbers.size(); i ++)
+        maptel_transform(ids[i % maptels],
+                         numbers[random.next() % numbers.size()].c_str(),
+                         result, sizeof(result));
+    double queried = now();
+    double longest = 0;
+    for(Integer m = 0; m < maptels; m ++) {
+        double deleting = now();
+        maptel_delete(ids[m]);
+        longest = std::max(longest, now() - deleting);
+    }
+    std::cout << std::setw(10) << name << std::fixed << std::setprecision(1)
+        << std::setw(12) << (inserted - start) * 1e9
+            / (maptels * numbers.size())
+        << std::setw(12) << (queried - inserted) * 1e9 / numbers.size()
+        << std::setprecision(3) << std::setw(12) << longest * 1e3 << "\n";
+}
+
+/** Compares maptels in arenas of ordinary and huge pages. */
+int benchArena(Integer maptels, Integer entries)
+{
+    std::vector<String> numbers = makeNumbers(entries);
+    std::cout << "arena: " << maptels << " maptels of " << entries
+        << " numbers in chains of " << CHAIN_LENGTH << "\n"
+        << "     pages   insert ns   query ns   delete ms (max)\n";
+    benchArenaFlags("small", 0, maptels, numbers);
+    benchArenaFlags("huge", MAPTEL_HUGE_PAGES, maptels, numbers);
+    return 0;
+}
+
+/** Measures chain walks: maptel_transform_ex_bounded() on chains
+ *  some of which are cyclic, and queries walking chains because
+ *  of a prefix rule. */
+int benchWalk(Integer entries, Integer max_hops)
+{
+    std::vector<String> numbers = makeNumbers(entries);
+    unsigned long id = maptel_create();
+    fillChains(id, numbers);
+    for(Integer i = CHAIN_LENGTH - 1; i < entries; i += 10 * CHAIN_LENGTH)
+        maptel_insert(id, numbers[i].c_str(),
+                      numbers[i + 1 - CHAIN_LENGTH].c_str());
+    std::cout << "walk: " << entries << " numbers in chains of "
+        << CHAIN_LENGTH << ", every 10th chain cyclic\n";
+    char result[64];
+    Integer ended = 0;
+    double start = now();
+    for(Integer i = 0; i < entries; i ++)
+        ended += maptel_transform_ex_bounded(id, numbers[i].c_str(), result,
+                                             sizeof(result), max_hops);
+    std::cout << "transform_ex_bounded(" << max_hops << "): " << std::fixed
+        << std::setprecision(1) << (now() - start) * 1e9 / entries
+        << " ns/call, " << ended << " ended\n";
+    ended = 0;
+    start = now();
+    for(Integer i = 0; i < entries; i ++)
+        ended += maptel_transform_ex_bounded(id, numbers[i].c_str(), result,
+                                             sizeof(result), ~0UL);
+    std::cout << "transform_ex_bounded(unbounded): " << std::setprecision(1)
+        << (now() - start) * 1e9 / entries << " ns/call, " << ended
+        << " ended\n";
+    /* a rule no number matches still makes queries walk chains; */
+    maptel_insert_prefix(id, "9", "8");
+    Integer cyclic = 0;
+    start = now();
+    for(Integer i = 0; i < entries; i ++)
+        cyclic += maptel_is_cyclic(id, numbers[i].c_str());
+    std::cout << "is_cyclic with a prefix rule: " << std::setprecision(1)
+        << (now() - start) * 1e9 / entries << " ns/call, " << cyclic
+        << " cyclic\n";
+    maptel_delete(id);
+    return 0;
+}
+
+/** Measures `queries` random queries of maptel `id` copying results
+ *  (maptel_transform(), maptel_transform_ex()) and taking views;
+ *  returns false if they give different results. */
+bool benchViewQueries(const char* name, unsigned long id,
+                      const std::vector<String>& numbers, Integer queries)
+{
+    char result[64];
+    const char* view;
+    size_t length;
+    Integer copied = 0;
+    Integer viewed = 0;
+    for(int ex = 0; ex < 2; ex ++) {
+        Random random(1);
+        double start = now();
+        for(Integer i = 0; i < queries; i ++) {
+            const char* source =
+                numbers[random.next() % numbers.size()].c_str();
+            if(ex)
+                maptel_transform_ex(id, source, result, sizeof(result));
+            else
+                maptel_transform(id, source, result, sizeof(result));
+            copied += result[strlen(result) - 1];
+        }
+        double copying = now() - start;
+        random = Random(1);
+        start = now();
+        for(Integer i = 0; i < queries; i ++) {
+            const char* source =
+                numbers[random.next() % numbers.size()].c_str();
+            if(ex)
+                maptel_transform_ex_view(id, source, &view, &length);
+            else
+                maptel_transform_view(id, source, &view, &length);
+            viewed += view[length - 1];
+        }
+        double viewing = now() - start;
+        std::cout << std::setw(8) << name << std::setw(6)
+            << (ex ? "ex" : "") << std::fixed << std::setprecision(1)
+            << std::setw(12) << copying * 1e9 / queries << std::setw(12)
+            << viewing * 1e9 / queries << "\n";
+    }
+    if(copied != viewed) {
+        std::cout << "checksums differ!\n";
+        return false;
+    }
+    return true;
+}
+
+/** Compares copying transformations with taking views of them
+ *  for numbers which are packed and for longer ones. */
+int benchView(Integer entries, Integer queries)
+{
+    char snapshot_path[] = "/tmp/maptel_bench_XXXXXX";
+    int fd = mkstemp(snapshot_path);
+    if(fd < 0) {
+        std::cerr << "view: cannot create temporary file.\n";
+        return 1;
+    }
+    close(fd);
+    std::cout << "view: " << entries << " numbers in chains of "
+        << CHAIN_LENGTH << ", " << queries << " queries\n"
+        << "  maptel  call   copy ns/op   view ns/op\n";
+    bool same = true;
+    for(int digits = 11; digits <= 20; digits += 9) {
+        std::vector<String> numbers = makeNumbers(entries);
+        for(Integer i = 0; digits > 11 && i < entries; i ++)
+            numbers[i] = "004812345" + numbers[i];
+        std::cout << digits << " digits:\n";
+        unsigned long id = maptel_create();
+        fillChains(id, numbers);
+        same = benchViewQueries("mutable", id, numbers, queries) && same;
+        maptel_save(id, snapshot_path);
+        maptel_freeze(id);
+        same = benchViewQueries("frozen", id, numbers, queries) && same;
+        maptel_delete(id);
+        if(maptel_open_snapshot(snapshot_path, &id) == 0) {
+            same = benchViewQueries("snapshot", id, numbers, queries)
+                && same;
+            maptel_delete(id);
+        }
+    }
+    unlink(snapshot_path);
+    return same ? 0 : 1;
+}
+
+/** Arguments and result of a thread of benchWriters(). */
+struct WritersTask {
+    maptel_handle_t handle;
+    const std::vector<String>* numbers;
+    Integer operations;
+    /** percent of operations which are queries; */
+    Integer read_percent;
+    Integer seed;
+    Integer checksum;
+};
+
+/** Runs queries (transform, transformEx) mixed with modifications:
+ *  a random transformation of a chain is erased and inserted back
+ *  by the next modification, so chains stay as fillChains() made
+ *  them (but for transformations of other threads being erased). */
+void* writersWorker(void* arg)
+{
+    WritersTask* task = static_cast<WritersTask*>(arg);
+    const std::vector<String>& numbers = *task->numbers;
+    Random random(task->seed);
+    char tel_dst[128];
+    Integer checksum = 0;
+    Integer erased = numbers.size();
+    for(Integer i = 0; i < task->operations; i ++) {
+        Integer pick = random.next();
+        if(pick % 100 < task->read_percent) {
+            const char* src = numbers[(pick >> 8) % numbers.size()].c_str();
+            if(i % 4 == 3)
+                maptel_h_transform_ex(task->handle, src, tel_dst,
+                                      sizeof(tel_dst));
+            else
+                maptel_h_transform(task->handle, src, tel_dst,
+                                   sizeof(tel_dst));
+            checksum += tel_dst[0];
+        }
+        else if(erased != numbers.size()) {
+            maptel_h_insert(task->handle, numbers[erased].c_str(),
+                            numbers[erased + 1].c_str());
+            erased = numbers.size();
+        }
+        else {
+            erased = (pick >> 8) % (numbers.size() - 1);
+            if((erased + 1) % CHAIN_LENGTH == 0)
+                erased --;
+            maptel_h_erase(task->handle, numbers[erased].c_str());
+        }
+    }
+    if(erased != numbers.size())
+        maptel_h_insert(task->handle, numbers[erased].c_str(),
+                        numbers[erased + 1].c_str());
+    task->checksum = checksum;
+    return NULL;
+}
+
+/** Measures throughput of a single maptel queried and modified by
+ *  1, 2, 4, ..., `max_threads` threads (see writersWorker()) with
+ *  mixed read/write ratios, for an ordinary maptel and for one
+ *  created with MAPTEL_CONCURRENT_WRITES. */
+int benchWriters(Integer max_threads, Integer entries, Integer operations)
+{
+#if !MAPTEL_CONCURRENT
+    if(max_threads > 1)
+        std::cerr << "writers: library built without concurrent mode, "
+            << "running single thread only.\n";
+    max_threads = 1;
+#endif
+    std::vector<String> numbers = makeNumbers(entries);
+    std::cout << "writers: " << entries << " entries, " << operations
+        << " operations per thread\n"
+        << "  reads threads  ordinary Mops/s  concurrent Mops/s\n";
+    const Integer read_percents[3] = { 50, 90, 99 };
+    for(int r = 0; r < 3; r ++)
+        for(Integer threads = 1; threads <= max_threads; threads *= 2) {
+            std::cout << std::setw(6) << read_percents[r] << "%"
+                << std::setw(8) << threads;
+            for(unsigned flags = 0; flags <= MAPTEL_CONCURRENT_WRITES;
+                flags += MAPTEL_CONCURRENT_WRITES) {
+                unsigned long id = maptel_create_ex(flags);
+                fillChains(id, numbers);
+                maptel_handle_t handle = maptel_open(id);
+                std::vector<WritersTask> tasks(threads);
+                for(Integer t = 0; t < threads; t ++) {
+                    tasks[t].handle = handle;
+                    tasks[t].numbers = &numbers;
+                    tasks[t].operations = operations;
+                    tasks[t].read_percent = read_percents[r];
+                    tasks[t].seed = t + 1;
+                    tasks[t].checksum = 0;
+                }
+                double start = now();
+#if MAPTEL_CONCURRENT
+                std::vector<pthread_t> workers(threads);
+                for(Integer t = 0; t < threads; t ++)
+                    pthread_create(&workers[t], NULL, writersWorker,
+                                   &tasks[t]);
+                for(Integer t = 0; t < threads; t ++)
+                    pthread_join(workers[t], NULL);
+#else
+                writersWorker(&tasks[0]);
+#endif
+                double elapsed = now() - start;
+                std::cout << std::setw(flags == 0 ? 17 : 19) << std::fixed
+                    << std::setprecision(3)
+                    << threads * operations / elapsed / 1e6;
+                maptel_close(handle);
+                maptel_delete(id);
+            }
+            std::cout << "\n" << std::flush;
+        }
+    return 0;
+}
+
+#if MAPTEL_CONCURRENT
+/** Arguments and result of a thread of benchReaders(). */
+struct ReadersTask {
+    maptel_handle_t handle;
+    const std::vector<String>* numbers;
+    Integer queries;
+    Integer seed;
+    /** latencies of every 16th query (in ns); */
+    std::vector<double> samples;
+    double elapsed;
+    Integer checksum;
+};
+
+/** Runs queries (transform, transformEx) timing every 16th one. */
+void* readersWorker(void* arg)
+{
+    ReadersTask* task = static_cast<ReadersTask*>(arg);
+    const std::vector<String>& numbers = *task->numbers;
+    Random random(task->seed);
+    char tel_dst[128];
+    Integer checksum = 0;
+    task->samples.reserve(task->queries / 16 + 1);
+    double start = now();
+    for(Integer i = 0; i < task->queries; i ++) {
+        const char* src = numbers[random.next() % numbers.size()].c_str();
+        double before = (i % 16 == 0) ? now() : 0;
+        if(i % 4 == 3)
+            maptel_h_transform_ex(task->handle, src, tel_dst,
+                                  sizeof(tel_dst));
+        else
+            maptel_h_transform(task->handle, src, tel_dst, sizeof(tel_dst));
+        if(i % 16 == 0)
+            task->samples.push_back((now() - before) * 1e9);
+        checksum += tel_dst[0];
+    }
+    task->elapsed = now() - start;
+    task->checksum = checksum;
+    return NULL;
+}
+
+/** Arguments and result of the writer of benchReaders(). */
+struct ReadersWriter {
+    maptel_handle_t handle;
+    const std::vector<String>* numbers;
+    /** modifications per second; */
+    Integer rate;
+    /** set when the readers are done; */
+    int stop;
+    Integer writes;
+};
+
+/** Erases a random transformation of a chain and inserts it back
+ *  (two modifications) `rate` times a second until `stop`. */
+void* readersWriterThread(void* arg)
+{
+    ReadersWriter* writer = static_cast<ReadersWriter*>(arg);
+    const std::vector<String>& numbers = *writer->numbers;
+    Random random(7);
+    double start = now();
+    Integer writes = 0;
+    while(!__atomic_load_n(&writer->stop, __ATOMIC_ACQUIRE)) {
+        double due = start + writes / static_cast<double>(writer->rate);
+        double wait = due - now();
+        if(wait > 0) {
+            struct timespec pause;
+            pause.tv_sec = 0;
+            pause.tv_nsec = static_cast<long>(std::min(wait, 1e-3) * 1e9);
+            nanosleep(&pause, NULL);
+            continue;
+        }
+        Integer erased = random.next() % (numbers.size() - 1);
+        if((erased + 1) % CHAIN_LENGTH == 0)
+            erased --;
+        maptel_h_erase(writer->handle, numbers[erased].c_str());
+        maptel_h_insert(writer->handle, numbers[erased].c_str(),
+                        numbers[erased + 1].c_str());
+        writes += 2;
+    }
+    writer->writes = writes;
+    return NULL;
+}
+#endif
+
+/** Measures latency of queries of `threads` threads while another
+ *  thread modifies the maptel at increasing rates, for an ordinary
+ *  maptel and for one created with MAPTEL_READ_MOSTLY (filled by
+ *  a single batch, which computes results of all chains once). */
+int benchReaders(Integer threads, Integer entries, Integer queries)
+{
+#if !MAPTEL_CONCURRENT
+    (void) threads;
+    (void) entries;
+    (void) queries;
+    std::cerr << "readers: library built without concurrent mode.\n";
+    return 1;
+#else
+    std::vector<String> numbers = makeNumbers(entries);
+    std::vector<const char*> sources;
+    std::vector<const char*> destinations;
+    for(Integer i = 0; i + 1 < numbers.size(); i ++)
+        if((i + 1) % CHAIN_LENGTH != 0) {
+            sources.push_back(numbers[i].c_str());
+            destinations.push_back(numbers[i + 1].c_str());
+        }
+    std::cout << "readers: " << entries << " numbers in chains of "
+        << CHAIN_LENGTH << ", " << threads << " threads x " << queries
+        << " queries\n"
+        << "  writes/s        ordinary ns/op  p50  p99"
+        << "     read mostly ns/op  p50  p99\n";
+    const Integer rates[5] = { 0, 1, 10, 100, 1000 };
+    for(int r = 0; r < 5; r ++) {
+        std::cout << std::setw(10) << rates[r];
+        for(unsigned flags = 0; flags <= MAPTEL_READ_MOSTLY;
+            flags += MAPTEL_READ_MOSTLY) {
+            unsigned long id = maptel_create_ex(flags);
+            maptel_insert_batch(id, &sources[0], &destinations[0],
+                                sources.size());
+            maptel_handle_t handle = maptel_open(id);
+            ReadersWriter writer = { handle, &numbers, rates[r], 0, 0 };
+            pthread_t writer_thread;
+            if(rates[r] > 0)
+                pthread_create(&writer_thread, NULL, readersWriterThread,
+                               &writer);
+            std::vector<ReadersTask> tasks(threads);
+            std::vector<pthread_t> workers(threads);
+            for(Integer t = 0; t < threads; t ++) {
+                tasks[t].handle = handle;
+                tasks[t].numbers = &numbers;
+                tasks[t].queries = queries;
+                tasks[t].seed = t + 1;
+                pthread_create(&workers[t], NULL, readersWorker, &tasks[t]);
+            }
+            std::vector<double> samples;
+            double elapsed = 0;
+            for(Integer t = 0; t < threads; t ++) {
+                pthread_join(workers[t], NULL);
+                samples.insert(samples.end(), tasks[t].samples.begin(),
+                               tasks[t].samples.end());
+                elapsed += tasks[t].elapsed;
+            }
+            __atomic_store_n(&writer.stop, 1, __ATOMIC_RELEASE);
+            if(rates[r] > 0)
+                pthread_join(writer_thread, NULL);
+            std::sort(samples.begin(), samples.end());
+            std::cout << std::setw(flags == 0 ? 22 : 23) << std::fixed
+                << std::setprecision(1) << elapsed * 1e9 / (threads * queries)
+                << std::setw(5) << std::setprecision(0)
+                << samples[samples.size() / 2]
+                << std::setw(5) << samples[samples.size() * 99 / 100];
+            maptel_close(handle);
+            maptel_delete(id);
+        }
+        std::cout << "\n" << std::flush;
+    }
+    return 0;
+#endif
+}
+
+#if __cplusplus >= 201703L
+/** Compares the C interface with maptel::Map for sources given as
+ *  std::string_view (slices of a single string, as parsed from
+ *  a request), copying results and taking views of them. */
+int benchCxx(Integer entries, Integer queries)
+{
+    std::cout << "cxx: " << entries << " numbers in chains of "
+        << CHAIN_LENGTH << ", " << queries << " queries\n"
+        << "  digits  call   C copy ns/op   C view ns/op"
+        << "   Map copy ns/op   Map view ns/op\n";
+    int status = 0;
+    for(size_t digits = 11; digits <= 20; digits += 9) {
+        std::vector<String> numbers = makeNumbers(entries);
+        String text;
+        for(Integer i = 0; i < entries; i ++) {
+            if(digits > 11)
+                numbers[i] = "004812345" + numbers[i];
+            text += numbers[i];
+        }
+        maptel::Map map;
+        fillChains(map.id(), numbers);
+        unsigned long id = map.id();
+        std::string_view all(text);
+        for(int ex = 0; ex < 2; ex ++) {
+            std::cout << std::setw(8) << digits << std::setw(6)
+                << (ex ? "ex" : "");
+            Integer checksums[4] = { 0, 0, 0, 0 };
+            for(int m = 0; m < 4; m ++) {
+                Random random(1);
+                char source[64];
+                char result[64];
+                const char* view;
+                size_t length;
+                double start = now();
+                for(Integer i = 0; i < queries; i ++) {
+                    std::string_view number =
+                        all.substr((random.next() % entries) * digits, digits);
+                    switch(m) {
+                        case 0:
+                            /* the C interface needs '\0' terminated
+                             * sources; */
+                            memcpy(source, number.data(), digits);
+                            source[digits] = '\0';
+                            if(ex)
+                                maptel_transform_ex(id, source, result,
+                                                    sizeof(result));
+                            else
+                                maptel_transform(id, source, result,
+                                                 sizeof(result));
+                            checksums[m] += result[strlen(result) - 1];
+                            break;
+                        case 1:
+                            memcpy(source, number.data(), digits);
+                            source[digits] = '\0';
+                            if(ex)
+                                maptel_transform_ex_view(id, source, &view,
+                                                         &length);
+                            else
+                                maptel_transform_view(id, source, &view,
+                                                      &length);
+                            checksums[m] += view[length - 1];
+                            break;
+                        case 2: {
+                            maptel::Number copy = ex ? map.transformEx(number)
+                                                     : map.transform(number);
+                            checksums[m] += copy.c_str()[copy.size() - 1];
+                            break;
+                        }
+                        default: {
+                            std::string_view found = ex ? map.viewEx(number)
+                                                        : map.view(number);
+                            checksums[m] += found.back();
+                        }
+                    }
+                }
+                double seconds = now() - start;
+                std::cout << std::fixed << std::setprecision(1)
+                    << std::setw(m < 2 ? 15 : 17)
+                    << seconds * 1e9 / queries;
+            }
+            std::cout << "\n" << std::flush;
+            if(checksums[0] != checksums[1] || checksums[0] != checksums[2]
+               || checksums[0] != checksums[3]) {
+                std::cout << "checksums differ!\n";
+                status = 1;
+            }
+        }
+    }
+    return status;
+}
+#endif
+
+/** Returns `index`-th argument as a number or `fallback` if not given. */
+Integer argument(int argc, char** argv, int index, Integer fallback)
+{
+    if(index < argc)
+        return strtoul(argv[index], NULL, 10);
+    return fallback;
+}
+
+int main(int argc, char** argv)
+{
+    String benchmark = (argc > 1) ? String(argv[1]) : String("scaling");
+    if(benchmark == "scaling")
+        return benchScaling(argument(argc, argv, 2, 8),
+                            argument(argc, argv, 3, 100000),
+                            argument(argc, argv, 4, 1000000));
+    if(benchmark == "table")
+        return benchTable(argument(argc, argv, 2, 1000000),
+                          argument(argc, argv, 3, 10000000));
+    if(benchmark == "batch")
+        return benchBatch(argument(argc, argv, 2, 1000000),
+                          argument(argc, argv, 3, 1000));
+    if(benchmark == "load")
+        return benchLoad(argument(argc, argv, 2, 1000000));
+    if(benchmark == "snapshot")
+        return benchSnapshot(argument(argc, argv, 2, 1000000),
+                             argument(argc, argv, 3, 10000000));
+    if(benchmark == "journal")
+        return benchJournal(argument(argc, argv, 2, 1000000),
+                            argument(argc, argv, 3, 1 << 16),
+                            argument(argc, argv, 4, 1000));
+    if(benchmark == "ids")
+        return benchIds(argument(argc, argv, 2, 100000),
+                        argument(argc, argv, 3, 1000000));
+    if(benchmark == "handle")
+        return benchHandle(argument(argc, argv, 2, 100000),
+                           argument(argc, argv, 3, 10000000));
+    if(benchmark == "prefix")
+        return benchPrefix(argument(argc, argv, 2, 10000),
+                           argument(argc, argv, 3, 10000000));
+    if(benchmark == "clone")
+        return benchClone(argument(argc, argv, 2, 1000000),
+                          argument(argc, argv, 3, 1000));
+    if(benchmark == "swap")
+        return benchSwap(argument(argc, argv, 2, 100000),
+                         argument(argc, argv, 3, 10));
+    if(benchmark == "reverse")
+        return benchReverse(argument(argc, argv, 2, 1000000),
+                            argument(argc, argv, 3, 1000000));
+    if(benchmark == "resolve")
+        return benchResolve(argument(argc, argv, 2, 8),
+                            argument(argc, argv, 3, 1000000));
+    if(benchmark == "analyze")
+        return benchAnalyze(argument(argc, argv, 2, 1000000));
+    if(benchmark == "intern")
+        return benchIntern(argument(argc, argv, 2, 4),
+                           argument(argc, argv, 3, 1000000));
+    if(benchmark == "arena")
+        return benchArena(argument(argc, argv, 2, 4),
+                          argument(argc, argv, 3, 1000000));
+    if(benchmark == "walk")
+        return benchWalk(argument(argc, argv, 2, 1000000),
+                         argument(argc, argv, 3, 4));
+    if(benchmark == "view")
+        return benchView(argument(argc, argv, 2, 1000000),
+                         argument(argc, argv, 3, 10000000));
+    if(benchmark == "writers")
+        return benchWriters(argument(argc, argv, 2, 8),
+                            argument(argc, argv, 3, 1000000),
+                            argument(argc, argv, 4, 1000000));
+    if(benchmark == "readers")
+        return benchReaders(argument(argc, argv, 2, 2),
+                            argument(argc, argv, 3, 100000),
+                            argument(argc, argv, 4, 1000000));
+#if __cplusplus >= 201703L
+    if(benchmark == "cxx")
+        return benchCxx(argument(argc, argv, 2, 1000000),
+                        argument(argc, argv, 3, 10000000));
+#endif
+    if(benchmark == "freeze")
+        return benchFreeze(argument(argc, argv, 2, 8),
+                           argument(argc, argv, 3, 1000000),
+                           argument(argc, argv, 4, 1000000));
+    std::cerr << "usage: " << argv[0]
+        << " scaling [max_threads] [entries] [queries]\n"
+        << "       " << argv[0] << " table [entries] [queries]\n"
+        << "       " << argv[0] << " batch [entries] [batch_size]\n"
+        << "       " << argv[0] << " load [entries]\n"
+        << "       " << argv[0] << " snapshot [entries] [queries]\n"
+        << "       " << argv[0]
+        << " journal [entries] [group_bytes] [group_usec]\n"
+        << "       " << argv[0] << " ids [maptels] [rounds]\n"
+        << "       " << argv[0] << " handle [entries] [queries]\n"
+        << "       " << argv[0] << " prefix [rules] [queries]\n"
+        << "       " << argv[0]
+        << " freeze [max_threads] [entries] [queries]\n"
+        << "       " << argv[0] << " clone [entries] [edits]\n"
+        << "       " << argv[0] << " swap [entries] [rounds]\n"
+        << "       " << argv[0] << " reverse [entries] [queries]\n"
+        << "       " << argv[0] << " resolve [max_threads] [entries]\n"
+        << "       " << argv[0] << " analyze [entries]\n"
+        << "       " << argv[0] << " intern [maptels] [entries]\n"
+        << "       " << argv[0] << " arena [maptels] [entries]\n"
+        << "       " << argv[0] << " walk [entries] [max_hops]\n"
+        << "       " << argv[0] << " view [entries] [queries]\n"
+        << "       " << argv[0] << " cxx [entries] [queries]\n"
+        << "       " << argv[0]
+        << " writers [max_threads] [entries] [operations]\n"
+        << "       " << argv[0]
+        << " readers [threads] [entries] [queries]\n";
+    return 1;
+}
@@ -0,0 +1,285 @@
+/** C++ interface of maptel library (header only).                *
+ *  author: Cezary Bartoszuk                                      *
+ *  e-mail: cbart@students.mimuw.edu.pl                           *
+ *  maptel::Map owns a maptel and reaches it by a handle through  *
+ *  the calls taking numbers with their lengths (maptel_h_*_n),   *
+ *  so std::string_view arguments need no '\0' terminated copies  *
+ *  and the id is never looked up (queries look numbers up by     *
+ *  their digits, see maptel_h_transform_n(); modifications copy  *
+ *  their arguments into strings, which allocate for numbers      *
+ *  longer than 15 digits). Results are views held by the maptel  *
+ *  (see maptel_transform_view()) or maptel::Number, which keeps  *
+ *  numbers of up to Number::INLINE digits in itself (a longer    *
+ *  result is looked up once more to be copied). Failures of the  *
+ *  library (for example an id which does not exist) throw        *
+ *  std::runtime_error. Requires C++17.                           */
+
+#ifndef _MAPTEL_MAP_H_
+#define _MAPTEL_MAP_H_
+
+#if __cplusplus < 201703L
+#error "maptel_map.h requires C++17 (std::string_view)."
+#endif
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+
+#include <cstddef>
+
+#include "./maptel.h"
+
+namespace maptel {
+
+/** Phone number returned by value; its digits are stored inside
+ *  the object unless there are more than INLINE of them. */
+class Number {
+
+    public:
+
+        /** maximal number of digits stored inline; */
+        static constexpr size_t INLINE = 23;
+
+        /** creates the empty number; */
+        Number()
+            : length(0)
+        {
+            digits[0] = '\0';
+        }
+
+        /** number of digits; */
+        size_t size() const
+        {
+            return length;
+        }
+
+        bool empty() const
+        {
+            return length == 0;
+        }
+
+        /** '\0' terminated digits; */
+        const char* c_str() const
+        {
+            return length <= INLINE ? digits : heap.c_str();
+        }
+
+        std::string_view view() const
+        {
+            return std::string_view(c_str(), length);
+        }
+
+        operator std::string_view() const
+        {
+            return view();
+        }
+
+        std::string str() const
+        {
+            return std::string(c_str(), length);
+        }
+
+        bool operator==(std::string_view other) const
+        {
+            return view() == other;
+        }
+
+        bool operator!=(std::string_view other) const
+        {
+            return view() != other;
+        }
+
+    private:
+
+        friend class Map;
+
+        /** sets the number to the result of `call` (one of
+         *  maptel_h_transform_n() and maptel_h_transform_ex_n());
+         *  longer results are retried in a buffer of their size
+         *  (the maptel may change in between); */
+        template<typename Call>
+        void fill(Call call, maptel_handle_t handle, std::string_view source)
+        {
+            size_t result = call(handle, source.data(), source.size(),
+                                 digits, sizeof(digits));
+            while(result != static_cast<size_t>(-1) && result > INLINE) {
+                heap.resize(result);
+                size_t fitting = result;
+                result = call(handle, source.data(), source.size(),
+                              heap.data(), fitting + 1);
+                if(result <= fitting) {
+                    heap.resize(result);
+                    if(result <= INLINE)
+                        heap.copy(digits, result);
+                    break;
+                }
+            }
+            length = (result == static_cast<size_t>(-1)) ? 0 : result;
+            if(length <= INLINE)
+                digits[length] = '\0';
+        }
+
+        size_t length;
+
+        char digits[INLINE + 1];
+
+        /** digits of a longer number; */
+        std::string heap;
+
+};
+
+/** Maptel owned by the object: created with it (maptel_create_ex())
+ *  and deleted with it. A Map can be moved but not copied (see
+ *  clone() for copies); a moved-from Map must only be destroyed or
+ *  assigned to. Its maptel must not be deleted by maptel_delete(). */
+class Map {
+
+    public:
+
+        /** creates a new maptel (`flags` of maptel_create_ex()); */
+        explicit Map(unsigned flags = 0)
+            : handle(maptel_open(maptel_create_ex(flags)))
+        {
+        }
+
+        /** takes ownership of existing maptel of given `id` (made by
+         *  maptel_open_snapshot(), maptel_recover(), ...); */
+        static Map adopt(unsigned long id)
+        {
+            maptel_handle_t handle = maptel_open(id);
+            if(handle == nullptr)
+                throw std::runtime_error("maptel::Map::adopt: "
+                                         "maptel does not exist");
+            return Map(handle);
+        }
+
+        Map(Map&& other) noexcept
+            : handle(other.handle)
+        {
+            other.handle = nullptr;
+        }
+
+        Map& operator=(Map&& other) noexcept
+        {
+            if(this != &other) {
+                reset();
+                handle = other.handle;
+                other.handle = nullptr;
+            }
+            return *this;
+        }
+
+        Map(const Map&) = delete;
+        Map& operator=(const Map&) = delete;
+
+        ~Map()
+        {
+            reset();
+        }
+
+        /** identificator of the maptel (for calls of the C interface
+         *  which have no counterpart here); */
+        unsigned long id() const
+        {
+            return maptel_h_id(handle);
+        }
+
+        /** copy of the maptel (see maptel_clone()); */
+        Map clone() const
+        {
+            unsigned long clone_id = 0;
+            if(maptel_clone(id(), &clone_id) != 0)
+                throw std::runtime_error("maptel::Map::clone: "
+                                         "maptel_clone() failed");
+            return adopt(clone_id);
+        }
+
+        /** maptel_insert(); */
+        void insert(std::string_view source, std::string_view destination)
+        {
+            maptel_h_insert_n(handle, source.data(), source.size(),
+                              destination.data(), destination.size());
+        }
+
+        /** maptel_erase(); */
+        void erase(std::string_view source)
+        {
+            maptel_h_erase_n(handle, source.data(), source.size());
+        }
+
+        /** maptel_transform() (the result is a copy); */
+        Number transform(std::string_view source) const
+        {
+            Number result;
+            result.fill(maptel_h_transform_n, handle, source);
+            return result;
+        }
+
+        /** maptel_transform_ex() (the result is a copy); */
+        Number transformEx(std::string_view source) const
+        {
+            Number result;
+            result.fill(maptel_h_transform_ex_n, handle, source);
+            return result;
+        }
+
+        /** maptel_transform_view(): `source` itself if there is no
+         *  transformation, otherwise a view valid until the next
+         *  modification of the maptel or releaseViews(); */
+        std::string_view view(std::string_view source) const
+        {
+            const char* destination = source.data();
+            size_t length = source.size();
+            maptel_h_transform_view_n(handle, source.data(), source.size(),
+                                      &destination, &length);
+            return std::string_view(destination, length);
+        }
+
+        /** maptel_transform_ex_view() (see view()); */
+        std::string_view viewEx(std::string_view source) const
+        {
+            const char* destination = source.data();
+            size_t length = source.size();
+            maptel_h_transform_ex_view_n(handle, source.data(),
+                                         source.size(), &destination,
+                                         &length);
+            return std::string_view(destination, length);
+        }
+
+        /** maptel_is_cyclic(); */
+        bool isCyclic(std::string_view source) const
+        {
+            return maptel_h_is_cyclic_n(handle, source.data(),
+                                        source.size()) == 1;
+        }
+
+        /** maptel_release_views(); */
+        void releaseViews()
+        {
+            maptel_h_release_views(handle);
+        }
+
+    private:
+
+        explicit Map(maptel_handle_t handle)
+            : handle(handle)
+        {
+        }
+
+        /** deletes the maptel (if the object still owns one); */
+        void reset()
+        {
+            if(handle != nullptr) {
+                maptel_delete(maptel_h_id(handle));
+                maptel_close(handle);
+                handle = nullptr;
+            }
+        }
+
+        maptel_handle_t handle;
+
+};
+
+}
+
+#endif
@@ -0,0 +1,1274 @@
+/** Maptel tests.                                              *
+ *  author: Cezary Bartoszuk                                   *
+ *  e-mail: cbart@students.mimuw.edu.pl                        *
+ *  usage:                                                     *
+ *    maptel_test [seed] [operations]                          *
+ *  Maptels of every combination of maptel_create_ex() flags   *
+ *  are modified by the same seeded random operations as       *
+ *  a std::map model and all their queries are compared with   *
+ *  it after every operation; journals torn or damaged after   *
+ *  every group are recovered. Exits with 1 on any difference. */
+
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+
+#include <unistd.h>
+
+#include "./maptel.h"
+#include "./tel_file.h"
+#if __cplusplus >= 201703L
+#include "./maptel_map.h"
+#endif
+
+#if MAPTEL_CONCURRENT
+#include <pthread.h>
+#endif
+
+typedef unsigned long Integer;
+
+typedef std::string String;
+
+/** Transformations as maptel_insert() made them. */
+typedef std::map<String, String> Model;
+
+/** true if maptel_transform_ex() of a cyclic chain gives the number
+ *  it enters its cycle at (with debuglevel > 0 it is an error); */
+#ifdef NDEBUG
+const bool CYCLES_RESOLVED = true;
+#else
+const bool CYCLES_RESOLVED = false;
+#endif
+
+/** Combinations of flags of maptel_create_ex() under test. */
+const unsigned ALL_FLAGS = MAPTEL_HUGE_PAGES | MAPTEL_CONCURRENT_WRITES
+    | MAPTEL_READ_MOSTLY;
+
+/** Simple xorshift generator (the same as in maptel_bench.cc). */
+class Random {
+
+    private:
+
+        unsigned long long state;
+
+    public:
+
+        explicit Random(unsigned long long seed)
+            : state(seed * 2685821657736338717ULL + 1)
+        {
+        }
+
+        unsigned long long next()
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 2685821657736338717ULL;
+        }
+
+};
+
+/** Number of failed checks. */
+Integer failures = 0;
+
+/** Reports a failed check (only the first ones are printed). */
+void fail(const String& test, const String& what)
+{
+    if(failures ++ < 20)
+        std::cerr << test << ": " << what << "\n";
+}
+
+/** Compares `found` with `expected`, reporting `what` if they differ. */
+void expect(const String& test, const String& what, const String& found,
+            const String& expected)
+{
+    if(found != expected)
+        fail(test, what + " gave " + found + ", expected " + expected);
+}
+
+/** Name of the test of maptels created with `flags`. */
+String flagsName(const char* name, unsigned flags)
+{
+    String text = name;
+    text += "(";
+    if(flags == 0)
+        text += "0";
+    if(flags & MAPTEL_HUGE_PAGES)
+        text += "H";
+    if(flags & MAPTEL_CONCURRENT_WRITES)
+        text += "W";
+    if(flags & MAPTEL_READ_MOSTLY)
+        text += "R";
+    return text + ")";
+}
+
+/** Returns `count` distinct numbers, every fourth of them longer than
+ *  the 15 digits a number is packed in. */
+std::vector<String> makeNumbers(Integer count)
+{
+    std::vector<String> numbers;
+    char buffer[32];
+    for(Integer i = 0; i < count; i ++) {
+        if(i % 4 == 3)
+            snprintf(buffer, sizeof(buffer), "004812345%011lu", i);
+        else
+            snprintf(buffer, sizeof(buffer), "48%09lu", i * 7919);
+        numbers.push_back(String(buffer));
+    }
+    return numbers;
+}
+
+/** Follows the chain of `source` in `model`: sets `final` to its last
+ *  number (or to the number it enters its cycle at) and returns true
+ *  if it is cyclic. */
+bool follow(const Model& model, const String& source, String& final)
+{
+    std::set<String> seen;
+    String number = source;
+    for(;;) {
+        Model::const_iterator found = model.find(number);
+        if(found == model.end()) {
+            final = number;
+            return false;
+        }
+        if(!seen.insert(number).second) {
+            final = number;
+            return true;
+        }
+        number = found->second;
+    }
+}
+
+/** Compares all queries of maptel `id` on `numbers` with `model`:
+ *  by id, by a handle and in batches. */
+void check(const String& test, unsigned long id, const Model& model,
+           const std::vector<String>& numbers)
+{
+    char result[64];
+    maptel_handle_t handle = maptel_open(id);
+    if(handle == NULL) {
+        fail(test, "maptel_open() failed");
+        return;
+    }
+    std::vector<const char*> sources;
+    std::vector<String> finals;
+    for(Integer i = 0; i < numbers.size(); i ++) {
+        const String& source = numbers[i];
+        Model::const_iterator found = model.find(source);
+        String single = (found == model.end()) ? source : found->second;
+        String final;
+        bool cyclic = follow(model, source, final);
+        maptel_transform(id, source.c_str(), result, sizeof(result));
+        expect(test, "transform(" + source + ")", result, single);
+        size_t length = maptel_h_transform_n(handle, source.data(),
+                                             source.size(), result,
+                                             sizeof(result));
+        expect(test, "h_transform_n(" + source + ")",
+               String(result, length), single);
+        /* a result which does not fit is not written; */
+        result[0] = 'x';
+        if(maptel_h_transform_n(handle, source.data(), source.size(),
+                                result, single.size()) != single.size()
+           || result[0] != 'x')
+            fail(test, "h_transform_n(" + source + ") of a short buffer");
+        if(maptel_is_cyclic(id, source.c_str()) != cyclic)
+            fail(test, "is_cyclic(" + source + ")");
+        if(maptel_h_is_cyclic_n(handle, source.data(), source.size())
+           != cyclic)
+            fail(test, "h_is_cyclic_n(" + source + ")");
+        if(cyclic && !CYCLES_RESOLVED)
+            continue;
+        maptel_transform_ex(id, source.c_str(), result, sizeof(result));
+        expect(test, "transform_ex(" + source + ")", result, final);
+        maptel_h_transform_ex(handle, source.c_str(), result,
+                              sizeof(result));
+        expect(test, "h_transform_ex(" + source + ")", result, final);
+        length = maptel_h_transform_ex_n(handle, source.data(),
+                                         source.size(), result,
+                                         sizeof(result));
+        expect(test, "h_transform_ex_n(" + source + ")",
+               String(result, length), final);
+        if(maptel_transform_ex_bounded(id, source.c_str(), result,
+                                       sizeof(result), ULONG_MAX)
+           != !cyclic)
+            fail(test, "transform_ex_bounded(" + source + ")");
+        expect(test, "transform_ex_bounded(" + source + ")", result, final);
+        sources.push_back(source.c_str());
+        finals.push_back(final);
+    }
+    std::vector<char> results(sources.size() * sizeof(result));
+    if(!sources.empty()) {
+        maptel_transform_ex_batch(id, &sources[0], &results[0],
+                                  sizeof(result), sources.size());
+        for(Integer i = 0; i < sources.size(); i ++)
+            expect(test, String("transform_ex_batch(") + sources[i] + ")",
+                   &results[i * sizeof(result)], finals[i]);
+        maptel_transform_batch(id, &sources[0], &results[0],
+                               sizeof(result), sources.size());
+        for(Integer i = 0; i < sources.size(); i ++) {
+            Model::const_iterator found = model.find(sources[i]);
+            expect(test, String("transform_batch(") + sources[i] + ")",
+                   &results[i * sizeof(result)],
+                   found == model.end() ? String(sources[i])
+                                        : found->second);
+        }
+    }
+    maptel_close(handle);
+}
+
+/** Compares views of maptel `id` on `numbers` with `model` (views
+ *  turn maptels of MAPTEL_CONCURRENT_WRITES into ordinary ones). */
+void checkViews(const String& test, unsigned long id, const Model& model,
+                const std::vector<String>& numbers)
+{
+    for(Integer i = 0; i < numbers.size(); i ++) {
+        const String& source = numbers[i];
+        Model::const_iterator found = model.find(source);
+        const char* view = NULL;
+        size_t length = 0;
+        if(maptel_transform_view(id, source.c_str(), &view, &length) != 0)
+            fail(test, "transform_view(" + source + ")");
+        else
+            expect(test, "transform_view(" + source + ")",
+                   String(view, length),
+                   found == model.end() ? source : found->second);
+        String final;
+        if(follow(model, source, final) && !CYCLES_RESOLVED)
+            continue;
+        if(maptel_transform_ex_view(id, source.c_str(), &view, &length)
+           != 0)
+            fail(test, "transform_ex_view(" + source + ")");
+        else
+            expect(test, "transform_ex_view(" + source + ")",
+                   String(view, length), final);
+    }
+    maptel_release_views(id);
+}
+
+/** Collects numbers given by maptel_sources_of() and
+ *  maptel_preimage(). */
+int collectNumber(const char* tel, void* arg)
+{
+    static_cast<std::vector<String>*>(arg)->push_back(tel);
+    return 0;
+}
+
+/** Compares numbers given by `found` calls, which returned `calls`,
+ *  with `expected`, reporting `what` if they differ (numbers given
+ *  twice differ too). */
+void expectNumbers(const String& test, const String& what, long calls,
+                   std::vector<String>& found,
+                   const std::set<String>& expected)
+{
+    std::sort(found.begin(), found.end());
+    if(calls != static_cast<long>(found.size())
+       || found.size() != expected.size()
+       || !std::equal(found.begin(), found.end(), expected.begin()))
+        fail(test, what + " gave wrong numbers");
+}
+
+/** Compares maptel_sources_of() and maptel_preimage() of maptel `id`
+ *  on `numbers` with `model` (queries turn maptels of
+ *  MAPTEL_CONCURRENT_WRITES into ordinary ones). */
+void checkReverse(const String& test, unsigned long id, const Model& model,
+                  const std::vector<String>& numbers)
+{
+    for(Integer i = 0; i < numbers.size(); i ++) {
+        const String& destination = numbers[i];
+        std::set<String> direct, transitive;
+        for(Model::const_iterator it = model.begin(); it != model.end();
+            ++ it) {
+            if(it->second == destination)
+                direct.insert(it->first);
+            /* the chain passes through `destination` if it is reached
+             * after at least one transformation; */
+            std::set<String> seen;
+            String number = it->second;
+            while(seen.insert(number).second) {
+                if(number == destination) {
+                    transitive.insert(it->first);
+                    break;
+                }
+                Model::const_iterator next = model.find(number);
+                if(next == model.end())
+                    break;
+                number = next->second;
+            }
+        }
+        std::vector<String> found;
+        long calls = maptel_sources_of(id, destination.c_str(),
+                                       collectNumber, &found);
+        expectNumbers(test, "sources_of(" + destination + ")", calls, found,
+                      direct);
+        found.clear();
+        calls = maptel_preimage(id, destination.c_str(), collectNumber,
+                                &found);
+        expectNumbers(test, "preimage(" + destination + ")", calls, found,
+                      transitive);
+    }
+}
+
+/** Compares maptel_sources_of() of `numbers` in maptel `id` with
+ *  `model` (in time linear in the size of the model, unlike
+ *  checkReverse()). */
+void checkSources(const String& test, unsigned long id, const Model& model,
+                  const std::vector<String>& numbers)
+{
+    std::map<String, std::set<String> > direct;
+    for(Model::const_iterator it = model.begin(); it != model.end(); ++ it)
+        direct[it->second].insert(it->first);
+    for(Integer i = 0; i < numbers.size(); i ++) {
+        std::vector<String> found;
+        long calls = maptel_sources_of(id, numbers[i].c_str(),
+                                       collectNumber, &found);
+        expectNumbers(test, "sources_of(" + numbers[i] + ")", calls, found,
+                      direct[numbers[i]]);
+    }
+}
+
+/** Compares maptel_analyze() of maptel `id` with `model` (cycles are
+ *  compared as sets of their members, listed in their order) and
+ *  checks that maptel_report_free() zeroes the report. */
+void checkAnalysis(const String& test, unsigned long id, const Model& model)
+{
+    Integer chains = 0, cyclic_sources = 0, longest_length = 0;
+    std::vector<Integer> length_counts;
+    std::map<String, Integer> lengths;
+    std::set<String> destinations;
+    std::set<std::vector<String> > cycles;
+    for(Model::const_iterator it = model.begin(); it != model.end(); ++ it)
+        destinations.insert(it->second);
+    for(Model::const_iterator it = model.begin(); it != model.end(); ++ it) {
+        /* the chain uses every transformation it reaches once; */
+        std::set<String> seen;
+        String number = it->first;
+        Model::const_iterator next;
+        while((next = model.find(number)) != model.end()
+              && seen.insert(number).second)
+            number = next->second;
+        Integer length = seen.size();
+        lengths[it->first] = length;
+        if(length_counts.size() <= length)
+            length_counts.resize(length + 1, 0);
+        length_counts[length] ++;
+        longest_length = std::max(longest_length, length);
+        if(destinations.count(it->first) == 0)
+            chains ++;
+        if(next == model.end())
+            continue;
+        /* `number` is where the chain enters its cycle; */
+        cyclic_sources ++;
+        std::vector<String> members(1, number);
+        while(model.find(members.back())->second != number)
+            members.push_back(model.find(members.back())->second);
+        std::sort(members.begin(), members.end());
+        cycles.insert(members);
+    }
+    maptel_report report;
+    if(maptel_analyze(id, &report) != 0) {
+        fail(test, "maptel_analyze() failed");
+        return;
+    }
+    if(report.sources != model.size() || report.chains != chains
+       || report.cyclic_sources != cyclic_sources
+       || report.longest_length != longest_length)
+        fail(test, "analyze() gave wrong counts");
+    for(Integer k = 0; k < std::max<Integer>(report.length_count_size,
+                                             length_counts.size()); k ++)
+        if((k < report.length_count_size ? report.length_counts[k] : 0)
+           != (k < length_counts.size() ? length_counts[k] : 0))
+            fail(test, "analyze() gave wrong length_counts");
+    std::map<String, Integer>::const_iterator longest =
+        lengths.find(report.longest_source);
+    bool longest_right = model.empty()
+        ? String(report.longest_source).empty()
+        : longest != lengths.end() && longest->second == longest_length;
+    if(!longest_right)
+        fail(test, "analyze() gave wrong longest_source");
+    std::set<std::vector<String> > found;
+    for(Integer i = 0; i < report.cycle_count; i ++) {
+        std::vector<String> members(
+            report.cycle_members + report.cycle_offsets[i],
+            report.cycle_members + report.cycle_offsets[i + 1]);
+        for(Integer j = 0; j < members.size(); j ++) {
+            Model::const_iterator next = model.find(members[j]);
+            if(next == model.end()
+               || next->second != members[(j + 1) % members.size()])
+                fail(test, "analyze() gave cycle members out of order");
+        }
+        std::sort(members.begin(), members.end());
+        found.insert(members);
+    }
+    if(report.cycle_count != cycles.size() || found != cycles)
+        fail(test, "analyze() gave wrong cycles");
+    maptel_report_free(&report);
+    if(report.length_counts != NULL || report.longest_source != NULL
+       || report.cycle_offsets != NULL || report.cycle_members != NULL
+       || report.cycle_count != 0)
+        fail(test, "report_free() did not zero the report");
+    maptel_report_free(&report);
+}
+
+/** Applies a random modification to maptel `id` and to `model`
+ *  (single, batched and by a handle insertions and erasures). */
+void modify(unsigned long id, Model& model,
+            const std::vector<String>& numbers, Random& random)
+{
+    unsigned long long pick = random.next();
+    const String& source = numbers[(pick >> 8) % numbers.size()];
+    const String& destination = numbers[(pick >> 24) % numbers.size()];
+    switch(pick % 8) {
+        case 0:
+        case 1:
+        case 2:
+            maptel_insert(id, source.c_str(), destination.c_str());
+            model[source] = destination;
+            break;
+        case 3:
+            maptel_erase(id, source.c_str());
+            model.erase(source);
+            break;
+        case 4: {
+            maptel_handle_t handle = maptel_open(id);
+            maptel_h_insert_n(handle, source.data(), source.size(),
+                              destination.data(), destination.size());
+            maptel_h_erase_n(handle, destination.data(),
+                             destination.size());
+            maptel_close(handle);
+            model[source] = destination;
+            model.erase(destination);
+            break;
+        }
+        case 5: {
+            /* later transformations of a source override earlier
+             * ones; */
+            std::vector<const char*> sources;
+            std::vector<const char*> destinations;
+            for(Integer i = 0; i < 4; i ++) {
+                unsigned long long more = random.next();
+                const String& from = numbers[more % numbers.size()];
+                const String& to = numbers[(more >> 32) % numbers.size()];
+                sources.push_back(from.c_str());
+                destinations.push_back(to.c_str());
+                model[from] = to;
+            }
+            maptel_insert_batch(id, &sources[0], &destinations[0],
+                                sources.size());
+            break;
+        }
+        case 6: {
+            const char* sources[2] = { source.c_str(),
+                                       destination.c_str() };
+            maptel_erase_batch(id, sources, 2);
+            model.erase(source);
+            model.erase(destination);
+            break;
+        }
+        default:
+            /* a transformation to itself is a cycle; */
+            maptel_insert(id, source.c_str(), source.c_str());
+            model[source] = source;
+    }
+}
+
+/** Differential test of maptels created with `flags`: random
+ *  modifications checked one by one, then views, clones, snapshots,
+ *  freezing and swapping of the result. */
+void testFlags(unsigned flags, Integer seed, Integer operations)
+{
+    const String test = flagsName("random", flags);
+    std::vector<String> numbers = makeNumbers(48);
+    Random random(seed);
+    Model model;
+    unsigned long id = maptel_create_ex(flags);
+    for(Integer i = 0; i < operations && failures == 0; i ++) {
+        modify(id, model, numbers, random);
+        check(test, id, model, numbers);
+        /* the index of predecessors is kept up to date by every
+         * modification; */
+        if(!(flags & MAPTEL_CONCURRENT_WRITES) && i % 8 == 0) {
+            checkReverse(test, id, model, numbers);
+            checkAnalysis(test, id, model);
+        }
+    }
+    checkReverse(test, id, model, numbers);
+    checkAnalysis(test, id, model);
+    checkViews(test, id, model, numbers);
+    /* a clone is independent of its original; */
+    unsigned long clone_id = 0;
+    if(maptel_clone(id, &clone_id) != 0)
+        fail(test, "maptel_clone() failed");
+    else {
+        Model cloned = model;
+        for(Integer i = 0; i < operations / 8; i ++)
+            modify(clone_id, cloned, numbers, random);
+        check(test + " clone", clone_id, cloned, numbers);
+        check(test + " original", id, model, numbers);
+        /* after a swap the ids refer to each other's maptels; */
+        if(maptel_swap(id, clone_id) != 0)
+            fail(test, "maptel_swap() failed");
+        check(test + " swapped", id, cloned, numbers);
+        check(test + " swapped", clone_id, model, numbers);
+        model.swap(cloned);
+        maptel_delete(clone_id);
+    }
+    char path[] = "/tmp/maptel_test_XXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0)
+        fail(test, "cannot create temporary file");
+    else {
+        close(fd);
+        unsigned long snapshot_id = 0;
+        if(maptel_save(id, path) != 0)
+            fail(test, "maptel_save() failed");
+        else if(maptel_open_snapshot(path, &snapshot_id) != 0)
+            fail(test, "maptel_open_snapshot() failed");
+        else {
+            check(test + " snapshot", snapshot_id, model, numbers);
+            checkReverse(test + " snapshot", snapshot_id, model, numbers);
+            checkAnalysis(test + " snapshot", snapshot_id, model);
+            /* the first modification copies the snapshot; */
+            Model copied = model;
+            for(Integer i = 0; i < operations / 8; i ++)
+                modify(snapshot_id, copied, numbers, random);
+            check(test + " snapshot copy", snapshot_id, copied, numbers);
+            maptel_delete(snapshot_id);
+        }
+        unlink(path);
+    }
+    maptel_freeze(id);
+    const String frozen = test + " frozen";
+    check(frozen, id, model, numbers);
+    checkReverse(frozen, id, model, numbers);
+    checkAnalysis(frozen, id, model);
+    checkViews(frozen, id, model, numbers);
+    maptel_delete(id);
+}
+
+/** Differential test of maptels large enough to allocate from their
+ *  own arenas: sources linked through the pages of the tables, views
+ *  taken from the arena and a clone outliving its original (whose
+ *  pages are left to the arena if all its numbers are packed). */
+void testArena(Integer seed)
+{
+    const String test = "arena";
+    std::vector<String> all = makeNumbers(3 << 12);
+    for(int packed = 0; packed < 2 && failures == 0; packed ++) {
+        std::vector<String> numbers;
+        for(Integer i = 0; i < all.size(); i ++)
+            if(!packed || all[i].size() <= 15)
+                numbers.push_back(all[i]);
+        Random random(seed + packed);
+        Model model;
+        unsigned long id = maptel_create_ex(packed ? MAPTEL_HUGE_PAGES : 0);
+        /* every source gets a transformation, half of them to a few
+         * numbers, which have long lists of sources; */
+        for(Integer i = 0; i < numbers.size(); i ++) {
+            Integer range = (i % 2 == 0) ? 64 : numbers.size();
+            const String& destination = numbers[random.next() % range];
+            maptel_insert(id, numbers[i].c_str(), destination.c_str());
+            model[numbers[i]] = destination;
+        }
+        for(Integer i = 0; i < numbers.size() / 4; i ++)
+            modify(id, model, numbers, random);
+        check(test, id, model, numbers);
+        checkSources(test, id, model, numbers);
+        checkViews(test, id, model, numbers);
+        unsigned long clone_id = 0;
+        if(maptel_clone(id, &clone_id) != 0) {
+            fail(test, "maptel_clone() failed");
+            maptel_delete(id);
+            continue;
+        }
+        /* the clone keeps the pages it shares with the original; */
+        maptel_delete(id);
+        for(Integer i = 0; i < numbers.size() / 4; i ++)
+            modify(clone_id, model, numbers, random);
+        check(test + " clone", clone_id, model, numbers);
+        checkSources(test + " clone", clone_id, model, numbers);
+        checkViews(test + " clone", clone_id, model, numbers);
+        maptel_delete(clone_id);
+    }
+}
+
+/** Returns content of file `path` (empty if it cannot be read). */
+String readFile(const char* path)
+{
+    String content;
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+        return content;
+    char chunk[4096];
+    size_t got;
+    while((got = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        content.append(chunk, got);
+    fclose(file);
+    return content;
+}
+
+/** Replaces file `path` with `content`; false on error. */
+bool writeFile(const char* path, const String& content)
+{
+    FILE* file = fopen(path, "wb");
+    if(file == NULL)
+        return false;
+    bool written = fwrite(content.data(), 1, content.size(), file)
+        == content.size();
+    return fclose(file) == 0 && written;
+}
+
+/** Counts sources given by maptel_resolve_all(). */
+int countSource(const char* tel_src, const char* tel_dst, int cyclic,
+                void* arg)
+{
+    (void) tel_src;
+    (void) tel_dst;
+    (void) cyclic;
+    ++ *static_cast<Integer*>(arg);
+    return 0;
+}
+
+/** Compares queries of maptel `id` on `numbers` with the ones
+ *  of maptel `expected_id` (both may have prefix rules). */
+void compare(const String& test, unsigned long id, unsigned long expected_id,
+             const std::vector<String>& numbers)
+{
+    char result[64];
+    char expected[64];
+    Integer sources = 0;
+    Integer expected_sources = 0;
+    maptel_resolve_all(id, countSource, &sources);
+    maptel_resolve_all(expected_id, countSource, &expected_sources);
+    if(sources != expected_sources)
+        fail(test, "different numbers of transformations");
+    for(Integer i = 0; i < numbers.size(); i ++) {
+        const char* source = numbers[i].c_str();
+        maptel_transform(id, source, result, sizeof(result));
+        maptel_transform(expected_id, source, expected, sizeof(expected));
+        expect(test, String("transform(") + source + ")", result, expected);
+        int cyclic = maptel_is_cyclic(expected_id, source);
+        if(maptel_is_cyclic(id, source) != cyclic)
+            fail(test, String("is_cyclic(") + source + ")");
+        if(cyclic && !CYCLES_RESOLVED)
+            continue;
+        maptel_transform_ex(id, source, result, sizeof(result));
+        maptel_transform_ex(expected_id, source, expected, sizeof(expected));
+        expect(test, String("transform_ex(") + source + ")", result,
+               expected);
+    }
+}
+
+/** Applies a random modification of an exact or a prefix rule
+ *  to maptel `id` (prefix rules keep lengths of numbers). */
+void modifyRules(unsigned long id, const std::vector<String>& numbers,
+                 Random& random)
+{
+    unsigned long long pick = random.next();
+    const String& source = numbers[(pick >> 8) % numbers.size()];
+    const String& destination = numbers[(pick >> 24) % numbers.size()];
+    size_t length = 3 + (pick >> 40) % 6;
+    switch(pick % 6) {
+        case 0:
+            maptel_insert_prefix(id, source.substr(0, length).c_str(),
+                                 destination.substr(0, length).c_str());
+            break;
+        case 1:
+            maptel_erase_prefix(id, source.substr(0, length).c_str());
+            break;
+        case 2:
+            maptel_erase(id, source.c_str());
+            break;
+        default:
+            maptel_insert(id, source.c_str(), destination.c_str());
+    }
+}
+
+/** Recovers journal `content` (written to `path`) on top
+ *  of `snapshot` (or NULL) and compares the result with maptel
+ *  `expected_id`; the journal must be cut to `expected_size`. */
+void checkRecovery(const String& test, const char* snapshot,
+                   const char* path, const String& content,
+                   unsigned long expected_id, size_t expected_size,
+                   const std::vector<String>& numbers)
+{
+    unsigned long id = 0;
+    if(!writeFile(path, content))
+        fail(test, "cannot write journal");
+    else if(maptel_recover(snapshot, path, &id) != 0)
+        fail(test, "maptel_recover() failed");
+    else {
+        compare(test, id, expected_id, numbers);
+        maptel_delete(id);
+        if(readFile(path).size() != expected_size)
+            fail(test, "torn tail of the journal is not cut off");
+    }
+}
+
+/** Journals random groups of modifications (of exact and prefix rules,
+ *  after a checkpoint if `checkpoint`), then recovers the journal cut
+ *  at every group boundary and in the middle of every frame, and with
+ *  a byte of every frame flipped: recovery must give exactly the groups
+ *  before the damaged one (compared with clones of the maptel taken
+ *  after each group) and cut the rest off the journal. */
+void testJournal(Integer seed, bool checkpoint)
+{
+    const String test = checkpoint ? "journal(checkpoint)" : "journal";
+    std::vector<String> numbers = makeNumbers(32);
+    char journal_path[] = "/tmp/maptel_test_XXXXXX";
+    char copy_path[] = "/tmp/maptel_test_XXXXXX";
+    char snapshot_path[] = "/tmp/maptel_test_XXXXXX";
+    char* paths[3] = { journal_path, copy_path, snapshot_path };
+    for(int i = 0; i < 3; i ++) {
+        int fd = mkstemp(paths[i]);
+        if(fd < 0) {
+            fail(test, "cannot create temporary file");
+            return;
+        }
+        close(fd);
+    }
+    Random random(seed);
+    unsigned long id = maptel_create();
+    /* groups are committed only by maptel_journal_sync(); */
+    if(maptel_journal_open(id, journal_path, 1 << 30, ULONG_MAX) != 0)
+        fail(test, "maptel_journal_open() failed");
+    for(Integer i = 0; checkpoint && i < 16; i ++)
+        modifyRules(id, numbers, random);
+    if(checkpoint && maptel_checkpoint(id, snapshot_path) != 0)
+        fail(test, "maptel_checkpoint() failed");
+    const char* snapshot = checkpoint ? snapshot_path : NULL;
+    /* `ends[g]` is the end of the g-th group in the journal and
+     * `states[g]` a clone of the maptel after it (0: before all); */
+    std::vector<size_t> ends;
+    std::vector<unsigned long> states(1);
+    ends.push_back(readFile(journal_path).size());
+    maptel_clone(id, &states[0]);
+    for(Integer g = 0; g < 12; g ++) {
+        Integer count = 1 + random.next() % 6;
+        for(Integer i = 0; i < count; i ++)
+            modifyRules(id, numbers, random);
+        if(maptel_journal_sync(id) != 0)
+            fail(test, "maptel_journal_sync() failed");
+        ends.push_back(readFile(journal_path).size());
+        states.push_back(0);
+        maptel_clone(id, &states.back());
+    }
+    maptel_journal_close(id);
+    const String journal = readFile(journal_path);
+    checkRecovery(test + " whole", snapshot, copy_path, journal,
+                  states.back(), journal.size(), numbers);
+    for(Integer g = 0; g + 1 < ends.size(); g ++) {
+        std::ostringstream name;
+        name << test << " group " << g;
+        /* the frame of group g + 1 is torn or damaged; */
+        size_t begin = ends[g];
+        size_t size = ends[g + 1] - begin;
+        checkRecovery(name.str() + " cut at its end", snapshot, copy_path,
+                      journal.substr(0, begin), states[g], begin, numbers);
+        /* modifications changing nothing are not journaled; */
+        if(size == 0)
+            continue;
+        size_t cut = begin + 1 + random.next() % (size - 1);
+        checkRecovery(name.str() + " cut in the next frame", snapshot,
+                      copy_path, journal.substr(0, cut), states[g], begin,
+                      numbers);
+        String damaged = journal;
+        damaged[begin + random.next() % size] ^= 1 << (random.next() % 8);
+        checkRecovery(name.str() + " next frame flipped", snapshot,
+                      copy_path, damaged, states[g], begin, numbers);
+    }
+    /* a damaged header is not a journal at all; */
+    String damaged = journal;
+    damaged[0] ^= 1;
+    unsigned long recovered = 0;
+    if(writeFile(copy_path, damaged)
+       && maptel_recover(snapshot, copy_path, &recovered) == 0) {
+        fail(test, "journal with damaged header recovered");
+        maptel_delete(recovered);
+    }
+    /* a recovered journal can be appended to; */
+    if(writeFile(copy_path, journal.substr(0, ends[6] + 5))
+       && maptel_recover(snapshot, copy_path, &recovered) == 0) {
+        maptel_journal_open(recovered, copy_path, 0, 0);
+        maptel_insert(recovered, numbers[0].c_str(), numbers[1].c_str());
+        maptel_insert(states[6], numbers[0].c_str(), numbers[1].c_str());
+        maptel_journal_close(recovered);
+        maptel_delete(recovered);
+        checkRecovery(test + " appended", snapshot, copy_path,
+                      readFile(copy_path), states[6],
+                      readFile(copy_path).size(), numbers);
+    }
+    else
+        fail(test, "maptel_recover() failed");
+    for(Integer g = 0; g < states.size(); g ++)
+        maptel_delete(states[g]);
+    maptel_delete(id);
+    for(int i = 0; i < 3; i ++)
+        unlink(paths[i]);
+}
+
+/** Returns a random numbering plan of `lines` lines of `numbers`
+ *  (with LF or CRLF endings, blanks around numbers, comments, empty
+ *  and malformed lines, and sometimes no newline after the last line);
+ *  adds its transformations to `model` and counts `valid` and
+ *  `invalid` lines. */
+String makePlan(const std::vector<String>& numbers, Integer lines,
+                Random& random, Model& model, Integer& valid,
+                Integer& invalid)
+{
+    const char* blanks[] = { "", "", " ", "\t", " \t ", "\r" };
+    const Integer BLANKS = sizeof(blanks) / sizeof(blanks[0]);
+    String plan;
+    for(Integer i = 0; i < lines; i ++) {
+        unsigned long long pick = random.next();
+        const String& source = numbers[(pick >> 8) % numbers.size()];
+        const String& destination = numbers[(pick >> 24) % numbers.size()];
+        const char* lead = blanks[(pick >> 40) % (BLANKS - 1)];
+        const char* trail = blanks[(pick >> 44) % BLANKS];
+        const char* separator = blanks[2 + (pick >> 48) % (BLANKS - 3)];
+        switch(pick % 12) {
+            case 0:
+                plan += String(lead) + "# " + source + " " + destination;
+                break;
+            case 1:
+                plan += trail;
+                break;
+            case 2:
+                /* a single number, three numbers and a non digit; */
+                plan += lead + source + trail;
+                invalid ++;
+                break;
+            case 3:
+                plan += source + separator + destination + " " + source;
+                invalid ++;
+                break;
+            case 4:
+                plan += source + "-" + destination + trail;
+                invalid ++;
+                break;
+            default:
+                plan += lead + source + separator + destination + trail;
+                model[source] = destination;
+                valid ++;
+        }
+        if(i + 1 < lines || pick % 3 != 0)
+            plan += (pick >> 52) % 2 ? "\r\n" : "\n";
+    }
+    return plan;
+}
+
+/** Loads numbering plans into empty, non empty and journaled maptels
+ *  of every combination of flags and compares them with a model,
+ *  and compares records of a plan parsed by TelFile by one thread and
+ *  by several ones (chunks start after newlines wherever they fall:
+ *  in comments, after a '\r' or in malformed lines). */
+void testLoad(Integer seed)
+{
+    const String test = "load";
+    std::vector<String> numbers = makeNumbers(32);
+    char plan_path[] = "/tmp/maptel_test_XXXXXX";
+    char journal_path[] = "/tmp/maptel_test_XXXXXX";
+    char snapshot_path[] = "/tmp/maptel_test_XXXXXX";
+    char* paths[3] = { plan_path, journal_path, snapshot_path };
+    for(int i = 0; i < 3; i ++) {
+        int fd = mkstemp(paths[i]);
+        if(fd < 0) {
+            fail(test, "cannot create temporary file");
+            return;
+        }
+        close(fd);
+    }
+    Random random(seed);
+    for(unsigned flags = 0; flags <= ALL_FLAGS; flags ++) {
+        const String name = flagsName("load", flags);
+        Model model;
+        Integer valid = 0;
+        Integer invalid = 0;
+        String plan = makePlan(numbers, 200, random, model, valid, invalid);
+        writeFile(plan_path, plan);
+        TelFile file(plan_path);
+        file.parse(1);
+        if(file.getRecordCount() != valid
+           || file.getInvalidCount() != invalid)
+            fail(name, "TelFile gave wrong numbers of lines");
+        unsigned long id = maptel_create_ex(flags);
+        if(maptel_load_file(id, plan_path) != static_cast<long>(valid))
+            fail(name, "load_file() into an empty maptel");
+        check(name, id, model, numbers);
+        /* later lines override transformations already there; */
+        Model loaded = model;
+        for(Integer i = 0; i < 8; i ++)
+            modify(id, loaded, numbers, random);
+        Model other;
+        valid = 0;
+        invalid = 0;
+        plan = makePlan(numbers, 50, random, other, valid, invalid);
+        writeFile(plan_path, plan);
+        for(Model::const_iterator it = other.begin(); it != other.end();
+            ++ it)
+            loaded[it->first] = it->second;
+        if(maptel_load_file(id, plan_path) != static_cast<long>(valid))
+            fail(name, "load_file() into a non empty maptel");
+        check(name + " non empty", id, loaded, numbers);
+        maptel_delete(id);
+        /* loads are journaled as insertions; */
+        unlink(journal_path);
+        id = maptel_create_ex(flags);
+        if(maptel_journal_open(id, journal_path, 0, 0) != 0)
+            fail(name, "maptel_journal_open() failed");
+        maptel_load_file(id, plan_path);
+        maptel_delete(id);
+        if(maptel_recover(NULL, journal_path, &id) != 0)
+            fail(name, "maptel_recover() failed");
+        else {
+            check(name + " journaled", id, other, numbers);
+            maptel_delete(id);
+        }
+    }
+    /* large enough for 5 chunks (4 MB each at least); */
+    Model model;
+    Integer valid = 0;
+    Integer invalid = 0;
+    String plan = makePlan(numbers, 1 << 20, random, model, valid,
+                           invalid);
+    writeFile(plan_path, plan);
+    TelFile expected(plan_path);
+    expected.parse(1);
+    if(expected.getRecordCount() != valid
+       || expected.getInvalidCount() != invalid)
+        fail(test, "TelFile gave wrong numbers of lines");
+    for(size_t threads = 2; threads <= 5; threads ++) {
+        TelFile file(plan_path);
+        file.parse(threads);
+        std::ostringstream what;
+        what << "TelFile::parse(" << threads << ")";
+#if MAPTEL_CONCURRENT
+        if(file.getChunkCount() != threads)
+            fail(test, what.str() + " gave wrong number of chunks");
+#endif
+        if(file.getRecordCount() != valid
+           || file.getInvalidCount() != invalid)
+            fail(test, what.str() + " gave wrong numbers of lines");
+        size_t chunk = 0;
+        size_t record = 0;
+        const TelFile::Chunk& all = expected.getChunk(0);
+        for(size_t i = 0; i < all.size() && chunk < file.getChunkCount();
+            i ++) {
+            while(chunk < file.getChunkCount()
+                  && record == file.getChunk(chunk).size()) {
+                chunk ++;
+                record = 0;
+            }
+            if(chunk == file.getChunkCount())
+                break;
+            const TelFile::Record& found = file.getChunk(chunk)[record ++];
+            if(String(found.source, found.source_length)
+               != String(all[i].source, all[i].source_length)
+               || String(found.destination, found.destination_length)
+               != String(all[i].destination, all[i].destination_length)) {
+                fail(test, what.str() + " gave records out of order");
+                break;
+            }
+        }
+    }
+    for(int i = 0; i < 3; i ++)
+        unlink(paths[i]);
+}
+
+/** A call of maptel_resolve_fn: source, final destination and
+ *  cycle flag. */
+typedef std::pair<String, std::pair<String, int> > Resolved;
+
+/** Collects calls of maptel_resolve_all() in order. */
+int collectResolved(const char* tel_src, const char* tel_dst, int cyclic,
+                    void* arg)
+{
+    static_cast<std::vector<Resolved>*>(arg)->push_back(
+        Resolved(tel_src, std::make_pair(String(tel_dst), cyclic)));
+    return 0;
+}
+
+/** Checks maptel_resolve_all_parallel() with several numbers of threads
+ *  against maptel_resolve_all() (the same calls in the same order)
+ *  and maptel_resolve_all() against maptel_transform_ex(), on a maptel
+ *  large enough to be split between threads: chains of random lengths,
+ *  ending, closing cycles or joining earlier chains. */
+void testResolve(Integer seed)
+{
+    const String test = "resolve";
+    /* resolveTable() gives every thread at least 1 << 16 of them; */
+    std::vector<String> numbers = makeNumbers(5 << 16);
+    Random random(seed);
+    unsigned long id = maptel_create();
+    std::vector<const char*> sources, destinations;
+    for(Integer start = 0; start < numbers.size(); ) {
+        Integer end = std::min<Integer>(start + 1 + random.next() % 64,
+                                        numbers.size());
+        for(Integer i = start; i + 1 < end; i ++) {
+            sources.push_back(numbers[i].c_str());
+            destinations.push_back(numbers[i + 1].c_str());
+        }
+        unsigned long long pick = random.next();
+        if(pick % 4 != 0) {
+            sources.push_back(numbers[end - 1].c_str());
+            /* a cycle or a link into an earlier chain (which
+             * makes components span the ranges of threads); */
+            destinations.push_back(
+                numbers[(pick % 4 == 1) ? start
+                                        : (pick >> 8) % end].c_str());
+        }
+        start = end;
+    }
+    maptel_insert_batch(id, &sources[0], &destinations[0], sources.size());
+    std::vector<Resolved> expected;
+    long calls = maptel_resolve_all(id, collectResolved, &expected);
+    if(calls != static_cast<long>(sources.size())
+       || expected.size() != sources.size())
+        fail(test, "resolve_all() missed sources");
+    char result[64];
+    for(Integer i = 0; i < expected.size(); i ++) {
+        const char* source = expected[i].first.c_str();
+        if(maptel_is_cyclic(id, source) != expected[i].second.second)
+            fail(test, String("cyclic of ") + source);
+        if(expected[i].second.second && !CYCLES_RESOLVED)
+            continue;
+        maptel_transform_ex(id, source, result, sizeof(result));
+        expect(test, String("resolve_all(") + source + ")",
+               expected[i].second.first, result);
+    }
+    const unsigned threads[] = { 0, 1, 2, 3, 4, 7 };
+    for(Integer t = 0; t < sizeof(threads) / sizeof(threads[0]); t ++) {
+        std::vector<Resolved> found;
+        calls = maptel_resolve_all_parallel(id, threads[t], collectResolved,
+                                            &found);
+        std::ostringstream what;
+        what << "resolve_all_parallel(" << threads[t] << ")";
+        if(calls != static_cast<long>(found.size()) || found != expected)
+            fail(test, what.str() + " differs from resolve_all()");
+    }
+    /* a frozen maptel gives the results it holds, in its own order; */
+    maptel_freeze(id);
+    std::vector<Resolved> found;
+    maptel_resolve_all_parallel(id, 4, collectResolved, &found);
+    std::sort(expected.begin(), expected.end());
+    std::sort(found.begin(), found.end());
+    if(found != expected)
+        fail(test, "resolve_all_parallel() of the frozen maptel differs");
+    maptel_delete(id);
+}
+
+#if __cplusplus >= 201703L
+/** Checks maptel::Map: results longer than Number::INLINE digits,
+ *  independent clones and errors thrown for missing maptels. */
+void testMap()
+{
+    const String test = "map";
+    const String longer = "00481234567890123456789012345";
+    maptel::Map map;
+    map.insert("48123", "48124");
+    map.insert("48124", longer);
+    expect(test, "transform", map.transform("48123").str(), "48124");
+    expect(test, "transformEx", map.transformEx("48123").str(), longer);
+    expect(test, "viewEx", String(map.viewEx("48123")), longer);
+    maptel::Map clone = map.clone();
+    clone.erase("48124");
+    expect(test, "clone transformEx", clone.transformEx("48123").str(),
+           "48124");
+    expect(test, "original transformEx", map.transformEx("48123").str(),
+           longer);
+#ifdef NDEBUG
+    /* with debuglevel > 0 a missing maptel is an assertion failure; */
+    unsigned long id = maptel_create();
+    maptel_delete(id);
+    try {
+        maptel::Map::adopt(id);
+        fail(test, "adopt() of a deleted maptel did not throw");
+    }
+    catch(const std::runtime_error&) {
+    }
+#endif
+}
+#endif
+
+#if MAPTEL_CONCURRENT
+/** Maptels and numbers shared by threads of testConcurrent(): every
+ *  source `sources[i]` is transformed into `middles[i]`, which is
+ *  transformed into `firsts[i]` or `seconds[i]` or nothing. */
+struct ConcurrentTask {
+    unsigned long id;
+    unsigned long staged_id;
+    const std::vector<String>* sources;
+    const std::vector<String>* middles;
+    const std::vector<String>* firsts;
+    const std::vector<String>* seconds;
+    Integer operations;
+    Integer seed;
+    /** number of wrong answers seen by a reader; */
+    Integer wrong;
+};
+
+/** Queries (by id and by a handle) sources of testConcurrent()
+ *  and counts answers no state of the maptels gives. */
+void* concurrentReader(void* arg)
+{
+    ConcurrentTask* task = static_cast<ConcurrentTask*>(arg);
+    Random random(task->seed);
+    char result[64];
+    maptel_handle_t handle = maptel_open(task->id);
+    for(Integer n = 0; n < task->operations; n ++) {
+        Integer i = random.next() % task->sources->size();
+        const char* source = (*task->sources)[i].c_str();
+        const String& middle = (*task->middles)[i];
+        if(n % 2)
+            maptel_transform(task->id, source, result, sizeof(result));
+        else
+            maptel_h_transform(handle, source, result, sizeof(result));
+        if(result != middle)
+            task->wrong ++;
+        if(n % 2)
+            maptel_transform_ex(task->id, source, result, sizeof(result));
+        else
+            maptel_h_transform_ex(handle, source, result, sizeof(result));
+        if(result != middle && result != (*task->firsts)[i]
+           && result != (*task->seconds)[i])
+            task->wrong ++;
+        if(maptel_is_cyclic(task->id, source) != 0)
+            task->wrong ++;
+    }
+    maptel_close(handle);
+    return NULL;
+}
+
+/** Races readers with a thread relinking middle numbers, swapping
+ *  the maptel with a staged one and creating and deleting other
+ *  maptels (so the registry of ids grows), for maptels created
+ *  with `flags`. */
+void testConcurrent(unsigned flags, Integer seed, Integer operations)
+{
+    const String test = flagsName("concurrent", flags);
+    std::vector<String> numbers = makeNumbers(256);
+    std::vector<String> sources, middles, firsts, seconds;
+    for(Integer i = 0; i < numbers.size(); i += 4) {
+        sources.push_back(numbers[i]);
+        middles.push_back(numbers[i + 1]);
+        firsts.push_back(numbers[i + 2]);
+        seconds.push_back(numbers[i + 3]);
+    }
+    ConcurrentTask shared;
+    shared.id = maptel_create_ex(flags);
+    shared.staged_id = maptel_create_ex(flags);
+    shared.sources = &sources;
+    shared.middles = &middles;
+    shared.firsts = &firsts;
+    shared.seconds = &seconds;
+    shared.operations = operations;
+    shared.wrong = 0;
+    for(Integer i = 0; i < sources.size(); i ++) {
+        maptel_insert(shared.id, sources[i].c_str(), middles[i].c_str());
+        maptel_insert(shared.staged_id, sources[i].c_str(),
+                      middles[i].c_str());
+    }
+    const Integer READERS = 2;
+    std::vector<ConcurrentTask> tasks(READERS, shared);
+    std::vector<pthread_t> readers(READERS);
+    for(Integer t = 0; t < READERS; t ++) {
+        tasks[t].seed = seed + t;
+        pthread_create(&readers[t], NULL, concurrentReader, &tasks[t]);
+    }
+    Random random(seed);
+    std::vector<unsigned long> others;
+    for(Integer n = 0; n < operations / 4; n ++) {
+        Integer i = random.next() % sources.size();
+        unsigned long id = (n % 3) ? shared.id : shared.staged_id;
+        switch(n % 5) {
+            case 0:
+                maptel_erase(id, middles[i].c_str());
+                break;
+            case 1:
+            case 2:
+                maptel_insert(id, middles[i].c_str(), firsts[i].c_str());
+                break;
+            case 3:
+                maptel_insert(id, middles[i].c_str(), seconds[i].c_str());
+                break;
+            default:
+                maptel_swap(shared.id, shared.staged_id);
+        }
+        others.push_back(maptel_create_ex(flags));
+        maptel_insert(others.back(), firsts[i].c_str(),
+                      seconds[i].c_str());
+        if(n % 3 == 0) {
+            Integer k = random.next() % others.size();
+            maptel_delete(others[k]);
+            others[k] = others.back();
+            others.pop_back();
+        }
+    }
+    for(Integer t = 0; t < READERS; t ++) {
+        pthread_join(readers[t], NULL);
+        if(tasks[t].wrong != 0) {
+            std::ostringstream what;
+            what << "reader " << t << " got " << tasks[t].wrong
+                << " wrong answers";
+            fail(test, what.str());
+        }
+    }
+    for(Integer k = 0; k < others.size(); k ++)
+        maptel_delete(others[k]);
+    maptel_delete(shared.id);
+    maptel_delete(shared.staged_id);
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    Integer seed = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1;
+    Integer operations = (argc > 2) ? strtoul(argv[2], NULL, 10) : 2000;
+    for(unsigned flags = 0; flags <= ALL_FLAGS; flags ++) {
+        Integer before = failures;
+        testFlags(flags, seed + flags, operations);
+        std::cout << flagsName("random", flags)
+            << (failures == before ? ": ok\n" : ": FAILED\n") << std::flush;
+    }
+    for(int checkpoint = 0; checkpoint < 2; checkpoint ++) {
+        Integer before = failures;
+        testJournal(seed + checkpoint, checkpoint);
+        std::cout << (checkpoint ? "journal(checkpoint)" : "journal")
+            << (failures == before ? ": ok\n" : ": FAILED\n") << std::flush;
+    }
+    Integer before = failures;
+    testLoad(seed);
+    std::cout << (failures == before ? "load: ok\n" : "load: FAILED\n")
+        << std::flush;
+    before = failures;
+    testArena(seed);
+    std::cout << (failures == before ? "arena: ok\n" : "arena: FAILED\n")
+        << std::flush;
+    before = failures;
+    testResolve(seed);
+    std::cout << (failures == before ? "resolve: ok\n" : "resolve: FAILED\n")
+        << std::flush;
+#if __cplusplus >= 201703L
+    before = failures;
+    testMap();
+    std::cout << (failures == before ? "map: ok\n" : "map: FAILED\n")
+        << std::flush;
+#endif
+#if MAPTEL_CONCURRENT
+    for(unsigned flags = 0; flags <= ALL_FLAGS; flags ++) {
+        Integer before = failures;
+        testConcurrent(flags, seed + flags, operations * 10);
+        std::cout << flagsName("concurrent", flags)
+            << (failures == before ? ": ok\n" : ": FAILED\n") << std::flush;
+    }
+#endif
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+/** Read/write lock used by libmaptel.   *
+ *  author: Cezary Bartoszuk             *
+ *  e-mail: cbart@students.mimuw.edu.pl  */
+
+#include <cassert>
+
+#include "./rw_lock.h"
+
+#if MAPTEL_CONCURRENT
+
+RWLock::RWLock()
+{
+    int result = pthread_rwlock_init(&lock, NULL);
+    assert(result == 0);
+    (void) result;
+}
+
+void RWLock::readLock()
+{
+    int result = pthread_rwlock_rdlock(&lock);
+    assert(result == 0);
+    (void) result;
+}
+
+void RWLock::writeLock()
+{
+    int result = pthread_rwlock_wrlock(&lock);
+    assert(result == 0);
+    (void) result;
+}
+
+void RWLock::unlock()
+{
+    int result = pthread_rwlock_unlock(&lock);
+    assert(result == 0);
+    (void) result;
+}
+
+RWLock::~RWLock()
+{
+    int result = pthread_rwlock_destroy(&lock);
+    assert(result == 0);
+    (void) result;
+}
+
+#else
+
+/* Single threaded build: locking is not needed at all. */
+
+RWLock::RWLock()
+{
+}
+
+void RWLock::readLock()
+{
+}
+
+void RWLock::writeLock()
+{
+}
+
+void RWLock::unlock()
+{
+}
+
+RWLock::~RWLock()
+{
+}
+
+#endif
+
+ReadGuard::ReadGuard(RWLock& lock) : lock(lock)
+{
+    this->lock.readLock();
+}
+
+ReadGuard::~ReadGuard()
+{
+    lock.unlock();
+}
+
+WriteGuard::WriteGuard(RWLock& lock) : lock(lock)
+{
+    this->lock.writeLock();
+}
+
+WriteGuard::~WriteGuard()
+{
+    lock.unlock();
+}
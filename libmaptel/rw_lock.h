@@ -0,0 +1,86 @@
+/** Read/write lock used by libmaptel.                    *
+ *  author: Cezary Bartoszuk                              *
+ *  e-mail: cbart@students.mimuw.edu.pl                   *
+ *  When compiled without MAPTEL_CONCURRENT (or with      *
+ *  MAPTEL_CONCURRENT=0) all operations are no-ops.       */
+
+#ifndef _RW_LOCK_H_
+#define _RW_LOCK_H_
+
+#ifndef MAPTEL_CONCURRENT
+#define MAPTEL_CONCURRENT 0
+#endif
+
+#if MAPTEL_CONCURRENT
+#include <pthread.h>
+#endif
+
+/** Lock that can be held by many readers or by a single writer. */
+class RWLock {
+
+    private:
+
+#if MAPTEL_CONCURRENT
+        pthread_rwlock_t lock;
+#endif
+
+        /** locks are not copyable; */
+        RWLock(const RWLock& copy);
+        RWLock& operator=(const RWLock& copy);
+
+    public:
+
+        /** creates unlocked lock; */
+        RWLock();
+
+        /** acquires shared (reader) ownership; */
+        void readLock();
+
+        /** acquires exclusive (writer) ownership; */
+        void writeLock();
+
+        /** releases ownership acquired by readLock() or writeLock(); */
+        void unlock();
+
+        /** the destructor (lock must not be held); */
+        ~RWLock();
+
+};
+
+/** Holds shared ownership of given lock for the scope's lifetime. */
+class ReadGuard {
+
+    private:
+
+        RWLock& lock;
+
+        ReadGuard(const ReadGuard& copy);
+        ReadGuard& operator=(const ReadGuard& copy);
+
+    public:
+
+        explicit ReadGuard(RWLock& lock);
+
+        ~ReadGuard();
+
+};
+
+/** Holds exclusive ownership of given lock for the scope's lifetime. */
+class WriteGuard {
+
+    private:
+
+        RWLock& lock;
+
+        WriteGuard(const WriteGuard& copy);
+        WriteGuard& operator=(const WriteGuard& copy);
+
+    public:
+
+        explicit WriteGuard(RWLock& lock);
+
+        ~WriteGuard();
+
+};
+
+#endif
@@ -0,0 +1,198 @@
+/** Memory arenas of maptels.               *
+ *  author: Cezary Bartoszuk                *
+ *  e-mail: cbart@students.mimuw.edu.pl     */
+
+#include <vector>
+#include <algorithm>
+#include <new>
+
+#include <cassert>
+#include <cstdlib>
+
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "./debug_stream.h"
+#include "./rw_lock.h"
+#include "./tel_arena.h"
+
+const size_t TelArena::FIRST_CHUNK;
+
+const size_t TelArena::CHUNK_SIZE;
+
+const size_t TelArena::GRANULE;
+
+const size_t TelArena::MAX_BLOCK;
+
+const size_t TelArena::CACHED_CHUNKS;
+
+/** mapped chunks of destroyed arenas (indexed by their huge_pages)
+ *  and their lock; */
+struct ChunkCache {
+    RWLock lock;
+    std::vector<char*> chunks[2];
+};
+
+static ChunkCache& getChunkCache()
+{
+    /* never destroyed, as maptels destroyed at exit may return
+     * chunks after it; */
+    static ChunkCache* cache = new ChunkCache();
+    return *cache;
+}
+
+TelArena::TelArena(bool huge_pages)
+    : next(NULL), end(NULL), references(1), huge_pages(huge_pages)
+{
+}
+
+TelArena::~TelArena()
+{
+    for(size_t i = 0; i < chunks.size(); i ++)
+        if(chunks[i].size == CHUNK_SIZE)
+            returnChunk(chunks[i].memory, huge_pages);
+        else
+            free(chunks[i].memory);
+    debug_info() << "TelArena: freed " << chunks.size()
+        << " chunks.\n" << std::flush;
+}
+
+TelArena* TelArena::create(bool huge_pages)
+{
+    return new TelArena(huge_pages);
+}
+
+void TelArena::retain(TelArena* arena)
+{
+    __atomic_add_fetch(&arena->references, 1, __ATOMIC_RELAXED);
+}
+
+void TelArena::release(TelArena* arena)
+{
+    if(__atomic_sub_fetch(&arena->references, 1, __ATOMIC_ACQ_REL) == 0)
+        delete arena;
+}
+
+char* TelArena::takeChunk(bool huge_pages)
+{
+    {
+        ChunkCache& cache = getChunkCache();
+        WriteGuard guard(cache.lock);
+        std::vector<char*>& cached = cache.chunks[huge_pages];
+        if(!cached.empty()) {
+            char* chunk = cached.back();
+            cached.pop_back();
+            return chunk;
+        }
+    }
+    if(!huge_pages) {
+        void* mapped = mmap(NULL, CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(mapped == MAP_FAILED)
+            throw std::bad_alloc();
+        return static_cast<char*>(mapped);
+    }
+    /* map twice the size and trim it to an aligned chunk; */
+    void* mapped = mmap(NULL, 2 * CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(mapped == MAP_FAILED)
+        throw std::bad_alloc();
+    char* begin = static_cast<char*>(mapped);
+    uintptr_t address = reinterpret_cast<uintptr_t>(begin);
+    char* chunk = reinterpret_cast<char*>(
+        (address + CHUNK_SIZE - 1) & ~(CHUNK_SIZE - 1));
+    if(chunk != begin)
+        munmap(begin, chunk - begin);
+    if(chunk + CHUNK_SIZE != begin + 2 * CHUNK_SIZE)
+        munmap(chunk + CHUNK_SIZE, begin + CHUNK_SIZE - chunk);
+#ifdef MADV_HUGEPAGE
+    if(madvise(chunk, CHUNK_SIZE, MADV_HUGEPAGE) != 0)
+        debug_warn() << "TelArena: huge pages are not available.\n"
+            << std::flush;
+#endif
+    return chunk;
+}
+
+void TelArena::returnChunk(char* chunk, bool huge_pages)
+{
+    {
+        ChunkCache& cache = getChunkCache();
+        WriteGuard guard(cache.lock);
+        std::vector<char*>& cached = cache.chunks[huge_pages];
+        if(cached.size() < CACHED_CHUNKS) {
+            cached.push_back(chunk);
+            return;
+        }
+    }
+    munmap(chunk, CHUNK_SIZE);
+}
+
+void TelArena::addChunk(size_t size)
+{
+    /* make room first, so that a chunk is never lost; */
+    if(chunks.size() == chunks.capacity())
+        chunks.reserve(2 * chunks.size() + 1);
+    /* every chunk is twice as large as the previous one; */
+    Chunk chunk = { NULL, FIRST_CHUNK };
+    if(!chunks.empty())
+        chunk.size = std::min(2 * chunks.back().size, CHUNK_SIZE);
+    while(chunk.size < size)
+        chunk.size *= 2;
+    if(chunk.size == CHUNK_SIZE)
+        chunk.memory = takeChunk(huge_pages);
+    else {
+        void* memory = NULL;
+        if(posix_memalign(&memory, GRANULE, chunk.size) != 0)
+            throw std::bad_alloc();
+        chunk.memory = static_cast<char*>(memory);
+    }
+    chunks.push_back(chunk);
+    next = chunk.memory;
+    end = chunk.memory + chunk.size;
+}
+
+void* TelArena::allocate(size_t size)
+{
+    size = (size + GRANULE - 1) & ~(GRANULE - 1);
+    if(size > MAX_BLOCK) {
+        void* block = NULL;
+        if(posix_memalign(&block, GRANULE, size) != 0)
+            throw std::bad_alloc();
+        return block;
+    }
+    WriteGuard guard(lock);
+    for(size_t i = 0; i < free_blocks.size(); i ++)
+        if(free_blocks[i].size == size && free_blocks[i].blocks != NULL) {
+            FreeBlock* block = free_blocks[i].blocks;
+            free_blocks[i].blocks = block->next;
+            return block;
+        }
+    if(static_cast<size_t>(end - next) < size)
+        /* the rest of the last chunk is wasted (less than a block); */
+        addChunk(size);
+    void* block = next;
+    next += size;
+    return block;
+}
+
+void TelArena::deallocate(void* block, size_t size)
+{
+    assert(block != NULL);
+    size = (size + GRANULE - 1) & ~(GRANULE - 1);
+    if(size > MAX_BLOCK) {
+        free(block);
+        return;
+    }
+    WriteGuard guard(lock);
+    FreeBlock* freed = static_cast<FreeBlock*>(block);
+    for(size_t i = 0; i < free_blocks.size(); i ++)
+        if(free_blocks[i].size == size) {
+            freed->next = free_blocks[i].blocks;
+            free_blocks[i].blocks = freed;
+            return;
+        }
+    freed->next = NULL;
+    SizeClass size_class = { size, freed };
+    /* the block is lost if there is no memory for its list; */
+    free_blocks.push_back(size_class);
+}
@@ -0,0 +1,132 @@
+/** Memory arenas of maptels.                                 *
+ *  author: Cezary Bartoszuk                                  *
+ *  e-mail: cbart@students.mimuw.edu.pl                       *
+ *  An arena hands out blocks carved from its chunks:         *
+ *  allocation bumps a pointer (or pops a block of the same   *
+ *  size freed before), freeing pushes the block on the list  *
+ *  of its size. The first chunks are small and taken from    *
+ *  the heap, each twice as large as the previous one, so     *
+ *  small maptels cost little; from 2 MB on chunks are mapped *
+ *  with mmap and returned to a cache shared by all arenas    *
+ *  when their arena is destroyed (the cache unmaps chunks    *
+ *  beyond CACHED_CHUNKS). Chunks are freed only with the     *
+ *  arena, so dropping a maptel costs a few calls instead of  *
+ *  a free per page. With huge pages the 2 MB chunks are      *
+ *  aligned to 2 MB and advised to be backed by transparent   *
+ *  huge pages. The arena is shared (and reference counted)   *
+ *  by everything allocated from it.                          */
+
+#ifndef _TEL_ARENA_H_
+#define _TEL_ARENA_H_
+
+#include <vector>
+
+#include <cstddef>
+
+#include "./rw_lock.h"
+
+class TelArena {
+
+    private:
+
+        /** size of the first chunk (taken from the heap); */
+        static const size_t FIRST_CHUNK = 64 << 10;
+
+        /** size of mapped chunks (and their alignment with huge
+         *  pages); smaller chunks are taken from the heap; */
+        static const size_t CHUNK_SIZE = 2 << 20;
+
+        /** sizes of blocks are rounded up to multiples of it
+         *  (blocks are aligned to cache lines); */
+        static const size_t GRANULE = 64;
+
+        /** larger blocks are allocated with malloc; */
+        static const size_t MAX_BLOCK = CHUNK_SIZE / 8;
+
+        /** maximal number of mapped chunks of either kind (with
+         *  and without huge pages) kept for new arenas; */
+        static const size_t CACHED_CHUNKS = 16;
+
+        /** freed block (the head of the list of its size); */
+        struct FreeBlock {
+            FreeBlock* next;
+        };
+
+        /** freed blocks of a single size; */
+        struct SizeClass {
+            size_t size;
+            FreeBlock* blocks;
+        };
+
+        /** chunk of the arena; */
+        struct Chunk {
+            char* memory;
+            size_t size;
+        };
+
+        /** guards all the fields below (blocks may be freed by
+         *  other maptels sharing pages with the owner); */
+        RWLock lock;
+
+        /** chunks in order of allocation; */
+        std::vector<Chunk> chunks;
+
+        /** unused part of the last chunk; */
+        char* next;
+        char* end;
+
+        /** lists of freed blocks of sizes allocated so far (few:
+         *  pages of tables and chunks of views); */
+        std::vector<SizeClass> free_blocks;
+
+        /** number of owners (see retain()); */
+        unsigned long references;
+
+        /** true if mapped chunks are backed by huge pages; */
+        const bool huge_pages;
+
+        explicit TelArena(bool huge_pages);
+
+        ~TelArena();
+
+        TelArena(const TelArena& copy);
+        TelArena& operator=(const TelArena& copy);
+
+        /** makes a new chunk (able to hold a block of `size` bytes)
+         *  the last one; */
+        void addChunk(size_t size);
+
+        /** returns a mapped chunk, from the cache if possible; */
+        static char* takeChunk(bool huge_pages);
+
+        /** puts a mapped chunk into the cache (or unmaps it); */
+        static void returnChunk(char* chunk, bool huge_pages);
+
+    public:
+
+        /** creates an arena with a single reference; */
+        static TelArena* create(bool huge_pages);
+
+        /** adds a reference to `arena`; */
+        static void retain(TelArena* arena);
+
+        /** drops a reference to `arena`, freeing its chunks
+         *  with the last one; */
+        static void release(TelArena* arena);
+
+        /** returns block of (at least) `size` bytes,
+         *  throws std::bad_alloc if there is no memory; */
+        void* allocate(size_t size);
+
+        /** frees `block` returned by allocate(size); */
+        void deallocate(void* block, size_t size);
+
+        /** true if mapped chunks are backed by huge pages; */
+        bool usesHugePages() const
+        {
+            return huge_pages;
+        }
+
+};
+
+#endif
@@ -0,0 +1,190 @@
+/** Epoch based reclamation used by libmaptel. *
+ *  author: Cezary Bartoszuk                   *
+ *  e-mail: cbart@students.mimuw.edu.pl        */
+
+#include <vector>
+#include <new>
+
+#include <cstdlib>
+
+#include "./rw_lock.h"
+#include "./tel_epoch.h"
+
+#if MAPTEL_CONCURRENT
+
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/membarrier.h>
+#endif
+
+/** size of a cache line (every record has one of its own); */
+static const size_t LINE = 64;
+
+/** object waiting for readers pinned at epochs up to `epoch`; */
+struct Retired {
+    void* object;
+    TelEpoch::Dispose dispose;
+    uint64_t epoch;
+};
+
+/** retired objects (never destroyed, as maptels destroyed at exit
+ *  may retire objects after it) and their lock; */
+struct RetiredList {
+    RWLock lock;
+    std::vector<Retired> objects;
+};
+
+static RetiredList& getRetired()
+{
+    static RetiredList* retired = new RetiredList();
+    return *retired;
+}
+
+uint64_t TelEpoch::epoch = 1;
+
+TelEpoch::Record* TelEpoch::records = NULL;
+
+__thread TelEpoch::Record* TelEpoch::current = NULL;
+
+/** key releasing records of exiting threads; */
+static pthread_key_t record_key;
+
+static pthread_once_t initialized = PTHREAD_ONCE_INIT;
+
+/** true if membarrier(2) orders pins (see barrier()); */
+static bool asymmetric = false;
+
+void TelEpoch::initialize()
+{
+    pthread_key_create(&record_key, detach);
+#if defined(__linux__) && defined(SYS_membarrier)
+    asymmetric = (syscall(SYS_membarrier,
+                          MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0);
+#endif
+}
+
+TelEpoch::Record* TelEpoch::enter()
+{
+    Record* record = current;
+    if(record == NULL)
+        record = attach();
+    if(record->depth ++ == 0) {
+        /* a pin is a plain store, the fence orders it before
+         * the loads of the reader (see barrier()); */
+        __atomic_store_n(&record->epoch,
+                         __atomic_load_n(&epoch, __ATOMIC_ACQUIRE),
+                         __ATOMIC_RELAXED);
+        if(asymmetric)
+            __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        else
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+    return record;
+}
+
+TelEpoch::Record* TelEpoch::attach()
+{
+    pthread_once(&initialized, initialize);
+    Record* record = __atomic_load_n(&records, __ATOMIC_ACQUIRE);
+    for(; record != NULL; record = record->next) {
+        bool used = false;
+        if(!__atomic_load_n(&record->used, __ATOMIC_RELAXED)
+           && __atomic_compare_exchange_n(&record->used, &used, true, false,
+                                          __ATOMIC_ACQUIRE,
+                                          __ATOMIC_RELAXED))
+            break;
+    }
+    if(record == NULL) {
+        void* memory = NULL;
+        if(posix_memalign(&memory, LINE, LINE) != 0)
+            throw std::bad_alloc();
+        record = new(memory) Record();
+        record->epoch = 0;
+        record->used = true;
+        record->next = __atomic_load_n(&records, __ATOMIC_RELAXED);
+        while(!__atomic_compare_exchange_n(&records, &record->next, record,
+                                           true, __ATOMIC_RELEASE,
+                                           __ATOMIC_RELAXED))
+            ;
+    }
+    record->depth = 0;
+    current = record;
+    pthread_setspecific(record_key, record);
+    return record;
+}
+
+void TelEpoch::detach(void* detached)
+{
+    Record* record = static_cast<Record*>(detached);
+    record->depth = 0;
+    __atomic_store_n(&record->epoch, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&record->used, false, __ATOMIC_RELEASE);
+    /* a later pin of the thread takes a record again; */
+    current = NULL;
+}
+
+void TelEpoch::barrier()
+{
+#if defined(__linux__) && defined(SYS_membarrier)
+    /* runs a fence on every running thread of the process; */
+    if(asymmetric
+       && syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0) == 0)
+        return;
+#endif
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void TelEpoch::retire(void* object, Dispose dispose)
+{
+    pthread_once(&initialized, initialize);
+    std::vector<Retired> disposed;
+    {
+        RetiredList& retired = getRetired();
+        WriteGuard guard(retired.lock);
+        /* readers pinned later see the object unreachable; */
+        Retired entry = {
+            object, dispose,
+            __atomic_fetch_add(&epoch, 1, __ATOMIC_SEQ_CST) };
+        retired.objects.push_back(entry);
+        barrier();
+        uint64_t oldest = ~uint64_t(0);
+        for(Record* record = __atomic_load_n(&records, __ATOMIC_ACQUIRE);
+            record != NULL;
+            record = record->next) {
+            uint64_t pinned = __atomic_load_n(&record->epoch,
+                                              __ATOMIC_ACQUIRE);
+            if(pinned != 0 && pinned < oldest)
+                oldest = pinned;
+        }
+        /* readers pinned at `oldest` or later may hold only objects
+         * retired at `oldest` or later; */
+        size_t kept = 0;
+        for(size_t i = 0; i < retired.objects.size(); i ++)
+            if(retired.objects[i].epoch < oldest)
+                disposed.push_back(retired.objects[i]);
+            else
+                retired.objects[kept ++] = retired.objects[i];
+        retired.objects.resize(kept);
+    }
+    for(size_t i = 0; i < disposed.size(); i ++)
+        disposed[i].dispose(disposed[i].object);
+}
+
+#else
+
+/* Single threaded build: nobody reads while an object is retired. */
+
+TelEpoch::Record* TelEpoch::enter()
+{
+    return NULL;
+}
+
+void TelEpoch::retire(void* object, Dispose dispose)
+{
+    dispose(object);
+}
+
+#endif
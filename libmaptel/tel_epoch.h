@@ -0,0 +1,120 @@
+/** Epoch based reclamation used by libmaptel.                  *
+ *  author: Cezary Bartoszuk                                    *
+ *  e-mail: cbart@students.mimuw.edu.pl                         *
+ *  Writers replace objects which are read without locks and    *
+ *  retire the old ones, which are disposed of when no reader   *
+ *  may hold them any more. A reader pins the current epoch     *
+ *  (see Pin) by storing it in the record of its thread, so it  *
+ *  takes no locks and makes no read-modify-writes (records are *
+ *  cache line sized and reused after their threads exit). An   *
+ *  object retired at epoch E (which advances the epoch) is     *
+ *  disposed of once every record is unpinned or pinned at      *
+ *  a later epoch, by that or a later call of retire(). The     *
+ *  store of a pin must be ordered before the reader's loads:   *
+ *  on Linux writers pay for it with membarrier(2) and readers  *
+ *  only stop the compiler, elsewhere readers issue a fence.    *
+ *  When compiled without MAPTEL_CONCURRENT (or with            *
+ *  MAPTEL_CONCURRENT=0) pins do nothing and objects are        *
+ *  disposed of as soon as they are retired.                    */
+
+#ifndef _TEL_EPOCH_H_
+#define _TEL_EPOCH_H_
+
+#include <cstddef>
+
+#include <stdint.h>
+
+#include "./rw_lock.h"
+
+class TelEpoch {
+
+    public:
+
+        /** frees a retired object; */
+        typedef void (*Dispose)(void* object);
+
+    private:
+
+        /** pin of a single thread; */
+        struct Record {
+            /** epoch the thread is pinned at or 0 (written
+             *  by the thread only); */
+            uint64_t epoch;
+            /** number of nested pins (the thread's only); */
+            unsigned long depth;
+            /** true while a thread owns the record; */
+            bool used;
+            /** next record (records are never freed); */
+            Record* next;
+        };
+
+        /** the current epoch (never 0, which marks unpinned
+         *  records); */
+        static uint64_t epoch;
+
+        /** all records (pushed to the front of the list); */
+        static Record* records;
+
+        /** record of the calling thread or NULL; */
+        static __thread Record* current;
+
+        /** record of the calling thread, pinned (once more); */
+        static Record* enter();
+
+        /** unpins `record` (once); */
+        static void leave(Record* record)
+        {
+#if MAPTEL_CONCURRENT
+            if(-- record->depth == 0)
+                __atomic_store_n(&record->epoch, 0, __ATOMIC_RELEASE);
+#else
+            (void) record;
+#endif
+        }
+
+        /** takes a record for the calling thread; */
+        static Record* attach();
+
+        /** releases record of an exiting thread; */
+        static void detach(void* record);
+
+        /** sets up the key of records and membarrier(2); */
+        static void initialize();
+
+        /** orders pins of all readers before the caller's loads; */
+        static void barrier();
+
+    public:
+
+        /** Pins the current epoch for the scope's lifetime: objects
+         *  loaded meanwhile are not disposed of. Pins may nest. */
+        class Pin {
+
+            private:
+
+                Record* record;
+
+                Pin(const Pin& copy);
+                Pin& operator=(const Pin& copy);
+
+            public:
+
+                Pin()
+                    : record(enter())
+                {
+                }
+
+                ~Pin()
+                {
+                    leave(record);
+                }
+
+        };
+
+        /** calls `dispose(object)` once no reader may hold `object`
+         *  (which must not be reachable by new readers any more); */
+        static void retire(void* object, Dispose dispose);
+
+};
+
+#endif
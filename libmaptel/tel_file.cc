@@ -0,0 +1,230 @@
+/** Numbering plan files read by libmaptel.  *
+ *  author: Cezary Bartoszuk                 *
+ *  e-mail: cbart@students.mimuw.edu.pl      */
+
+#include <vector>
+#include <algorithm>
+
+#include <cassert>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "./debug_stream.h"
+#include "./rw_lock.h"
+#include "./tel_file.h"
+
+#if MAPTEL_CONCURRENT
+#include <pthread.h>
+#endif
+
+/** Work of a single parsing thread. */
+struct ParseTask {
+    const char* begin;
+    const char* end;
+    TelFile::Chunk* records;
+    size_t invalid_count;
+};
+
+const size_t TelFile::MIN_CHUNK_SIZE;
+
+TelFile::TelFile(const char* path)
+    : data(NULL), size(0), invalid_count(0)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        debug_err() << "TelFile: cannot open file " << path << ".\n"
+            << std::flush;
+        return;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0)
+        debug_err() << "TelFile: cannot stat file " << path << ".\n"
+            << std::flush;
+    else if(info.st_size == 0)
+        /* empty file: nothing to map, but it is a correct plan; */
+        data = "";
+    else {
+        void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped != MAP_FAILED) {
+            data = static_cast<const char*>(mapped);
+            size = info.st_size;
+            madvise(mapped, size, MADV_WILLNEED);
+        }
+        else
+            debug_err() << "TelFile: cannot map file " << path << ".\n"
+                << std::flush;
+    }
+    close(fd);
+    debug_info() << "TelFile: mapped " << size << "B of " << path << ".\n"
+        << std::flush;
+}
+
+bool TelFile::isOpen() const
+{
+    return data != NULL;
+}
+
+/** true if `c` separates numbers in a line; */
+static bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/** returns end of digits starting at `it` (not further than `end`); */
+static const char* skipDigits(const char* it, const char* end)
+{
+    while(it < end && *it >= '0' && *it <= '9')
+        it ++;
+    return it;
+}
+
+/** returns end of blanks starting at `it` (not further than `end`); */
+static const char* skipBlanks(const char* it, const char* end)
+{
+    while(it < end && isBlank(*it))
+        it ++;
+    return it;
+}
+
+size_t TelFile::parseChunk(const char* begin, const char* end,
+                           Chunk& records)
+{
+    /* presize from the line count, so that records are never moved; */
+    size_t lines = 0;
+    for(const char* it = begin; it < end; it ++) {
+        it = static_cast<const char*>(memchr(it, '\n', end - it));
+        if(it == NULL)
+            break;
+        lines ++;
+    }
+    records.reserve(lines + 1);
+    size_t invalid = 0;
+    const char* line = begin;
+    while(line < end) {
+        const char* line_end =
+            static_cast<const char*>(memchr(line, '\n', end - line));
+        if(line_end == NULL)
+            line_end = end;
+        const char* it = skipBlanks(line, line_end);
+        if(it == line_end || *it == '#') {
+            line = line_end + 1;
+            continue;
+        }
+        Record record;
+        record.source = it;
+        it = skipDigits(it, line_end);
+        record.source_length = it - record.source;
+        const char* separator = it;
+        it = skipBlanks(it, line_end);
+        record.destination = it;
+        it = skipDigits(it, line_end);
+        record.destination_length = it - record.destination;
+        it = skipBlanks(it, line_end);
+        if(record.source_length == 0 || record.destination_length == 0
+           || separator == record.destination || it != line_end) {
+            debug_warn() << "TelFile: skipping malformed line: "
+                << std::string(line, line_end) << "\n" << std::flush;
+            invalid ++;
+        }
+        else
+            records.push_back(record);
+        line = line_end + 1;
+    }
+    return invalid;
+}
+
+void* TelFile::parseChunkThread(void* task)
+{
+    ParseTask* parse_task = static_cast<ParseTask*>(task);
+    parse_task->invalid_count = parseChunk(parse_task->begin, parse_task->end,
+                                           *parse_task->records);
+    return NULL;
+}
+
+void TelFile::parse(size_t threads)
+{
+    assert(isOpen());
+#if MAPTEL_CONCURRENT
+    if(threads == 0)
+        threads = static_cast<size_t>(
+            std::max(1L, sysconf(_SC_NPROCESSORS_ONLN)));
+    threads = std::max(static_cast<size_t>(1),
+                       std::min(threads, size / MIN_CHUNK_SIZE));
+#else
+    threads = 1;
+#endif
+    /* split the file at line boundaries; */
+    std::vector<ParseTask> tasks(threads);
+    chunks.assign(threads, Chunk());
+    const char* begin = data;
+    const char* end = data + size;
+    for(size_t i = 0; i < threads; i ++) {
+        const char* chunk_end = data + size / threads * (i + 1);
+        if(i + 1 == threads)
+            chunk_end = end;
+        else {
+            const char* newline = static_cast<const char*>(
+                memchr(chunk_end, '\n', end - chunk_end));
+            chunk_end = (newline == NULL) ? end : newline + 1;
+        }
+        tasks[i].begin = std::min(begin, chunk_end);
+        tasks[i].end = chunk_end;
+        tasks[i].records = &chunks[i];
+        tasks[i].invalid_count = 0;
+        begin = std::max(begin, chunk_end);
+    }
+    debug_info() << "TelFile: parsing " << size << "B in " << threads
+        << " chunks.\n" << std::flush;
+#if MAPTEL_CONCURRENT
+    std::vector<pthread_t> workers(threads);
+    std::vector<bool> started(threads, false);
+    for(size_t i = 1; i < threads; i ++)
+        started[i] = (pthread_create(&workers[i], NULL, parseChunkThread,
+                                     &tasks[i]) == 0);
+    parseChunkThread(&tasks[0]);
+    for(size_t i = 1; i < threads; i ++) {
+        if(started[i])
+            pthread_join(workers[i], NULL);
+        else
+            parseChunkThread(&tasks[i]);
+    }
+#else
+    parseChunkThread(&tasks[0]);
+#endif
+    invalid_count = 0;
+    for(size_t i = 0; i < threads; i ++)
+        invalid_count += tasks[i].invalid_count;
+}
+
+size_t TelFile::getChunkCount() const
+{
+    return chunks.size();
+}
+
+const TelFile::Chunk& TelFile::getChunk(size_t index) const
+{
+    return chunks[index];
+}
+
+size_t TelFile::getRecordCount() const
+{
+    size_t count = 0;
+    for(size_t i = 0; i < chunks.size(); i ++)
+        count += chunks[i].size();
+    return count;
+}
+
+size_t TelFile::getInvalidCount() const
+{
+    return invalid_count;
+}
+
+TelFile::~TelFile()
+{
+    if(data != NULL && size > 0)
+        munmap(const_cast<char*>(data), size);
+}
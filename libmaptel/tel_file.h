@@ -0,0 +1,94 @@
+/** Numbering plan files read by libmaptel.                *
+ *  author: Cezary Bartoszuk                                *
+ *  e-mail: cbart@students.mimuw.edu.pl                     *
+ *  A numbering plan is a text file with one transformation *
+ *  per line: source and destination number separated by    *
+ *  spaces or tabs. Empty lines and lines starting with '#' *
+ *  are ignored. The file is memory mapped and parsed in    *
+ *  place (in parallel chunks if it is large), records      *
+ *  point directly into the mapping.                        */
+
+#ifndef _TEL_FILE_H_
+#define _TEL_FILE_H_
+
+#include <vector>
+
+#include <cstddef>
+
+#include <stdint.h>
+
+class TelFile {
+
+    public:
+
+        /** single transformation read from the file;
+         *  numbers are not '\0' terminated; */
+        struct Record {
+            const char* source;
+            const char* destination;
+            uint32_t source_length;
+            uint32_t destination_length;
+        };
+
+        /** records parsed from a part of the file (in file order); */
+        typedef std::vector<Record> Chunk;
+
+    private:
+
+        /** minimal size of a part of the file parsed by one thread; */
+        static const size_t MIN_CHUNK_SIZE = 4 << 20;
+
+        /** mapped file or NULL; */
+        const char* data;
+
+        /** size of the file; */
+        size_t size;
+
+        /** parsed records; */
+        std::vector<Chunk> chunks;
+
+        /** number of malformed lines; */
+        size_t invalid_count;
+
+        TelFile(const TelFile& copy);
+        TelFile& operator=(const TelFile& copy);
+
+        /** parses lines of [begin, end) (which is line aligned),
+         *  returns the number of malformed lines; */
+        static size_t parseChunk(const char* begin, const char* end,
+                                 Chunk& records);
+
+        /** pthread entry point calling parseChunk(); */
+        static void* parseChunkThread(void* task);
+
+    public:
+
+        /** maps file `path` (see isOpen()); */
+        explicit TelFile(const char* path);
+
+        /** true if the file has been mapped; */
+        bool isOpen() const;
+
+        /** parses the whole file by up to `threads` threads (`0`: one
+         *  per processor), each taking at least MIN_CHUNK_SIZE bytes
+         *  of it (file must be open); */
+        void parse(size_t threads);
+
+        /** number of chunks of parsed records; */
+        size_t getChunkCount() const;
+
+        /** `index`-th chunk of parsed records; */
+        const Chunk& getChunk(size_t index) const;
+
+        /** number of parsed records; */
+        size_t getRecordCount() const;
+
+        /** number of malformed (skipped) lines; */
+        size_t getInvalidCount() const;
+
+        /** unmaps the file; records are no longer valid; */
+        ~TelFile();
+
+};
+
+#endif
@@ -0,0 +1,58 @@
+/** Frozen (read only) transformations of maptels. *
+ *  author: Cezary Bartoszuk                       *
+ *  e-mail: cbart@students.mimuw.edu.pl            */
+
+#include <new>
+
+#include <cassert>
+#include <cstdlib>
+
+#include "./tel_frozen.h"
+
+const uint64_t TelFrozen::USED;
+
+const uint64_t TelFrozen::CYCLIC;
+
+/** size of a cache line; */
+static const size_t CACHE_LINE = 64;
+
+TelFrozen::TelFrozen(size_t expected)
+    : slots(NULL), mask(0), count(0)
+{
+    size_t capacity = 16;
+    while(capacity < 2 * expected)
+        capacity *= 2;
+    void* memory = NULL;
+    if(posix_memalign(&memory, CACHE_LINE, capacity * sizeof(Slot)) != 0)
+        throw std::bad_alloc();
+    slots = static_cast<Slot*>(memory);
+    for(size_t i = 0; i < capacity; i ++) {
+        new(&slots[i]) Slot();
+        slots[i].flags = 0;
+    }
+    mask = capacity - 1;
+}
+
+void TelFrozen::insert(const TelNumber& source, const TelNumber& destination,
+                       const TelNumber& final, bool cyclic)
+{
+    assert(2 * (count + 1) <= mask + 1);
+    size_t position = source.hash() & mask;
+    while(slots[position].flags & USED) {
+        assert(!(slots[position].source == source));
+        position = (position + 1) & mask;
+    }
+    Slot& slot = slots[position];
+    slot.source = source;
+    slot.destination = destination;
+    slot.final = final;
+    slot.flags = USED | (cyclic ? CYCLIC : 0);
+    count ++;
+}
+
+TelFrozen::~TelFrozen()
+{
+    for(size_t i = 0; i <= mask; i ++)
+        slots[i].~Slot();
+    free(slots);
+}
@@ -0,0 +1,125 @@
+/** Frozen (read only) transformations of maptels.           *
+ *  author: Cezary Bartoszuk                                 *
+ *  e-mail: cbart@students.mimuw.edu.pl                      *
+ *  A single array of 32 byte slots aligned to cache lines,  *
+ *  indexed by linear probing. A slot holds the packed       *
+ *  source, destination and final destination (the result   *
+ *  of transformEx()) of a transformation and its flags, so  *
+ *  a lookup usually reads a single cache line and compares  *
+ *  64 bit words only. The load factor is at most 1/2.       *
+ *  The table is filled once and never changes, so it may be *
+ *  read by many threads without locking.                    */
+
+#ifndef _TEL_FROZEN_H_
+#define _TEL_FROZEN_H_
+
+#include <cstddef>
+#include <cstring>
+
+#include <stdint.h>
+
+#include "./tel_number.h"
+
+class TelFrozen {
+
+    public:
+
+        /** single transformation; */
+        struct Slot {
+            TelNumber source;
+            TelNumber destination;
+            /** result of transformEx() (the number the chain enters
+             *  its cycle at for cyclic transformations); */
+            TelNumber final;
+            /** USED and CYCLIC; */
+            uint64_t flags;
+        };
+
+        /** flags of slots; */
+        static const uint64_t USED = 1;
+        static const uint64_t CYCLIC = 2;
+
+    private:
+
+        /** the slots (their number is a power of two); */
+        Slot* slots;
+
+        /** number of slots - 1; */
+        size_t mask;
+
+        /** number of transformations; */
+        size_t count;
+
+        TelFrozen(const TelFrozen& copy);
+        TelFrozen& operator=(const TelFrozen& copy);
+
+    public:
+
+        /** creates empty table with room for `expected`
+         *  transformations; */
+        explicit TelFrozen(size_t expected);
+
+        /** adds transformation from `source` (which must not be
+         *  present yet); only before the table is shared; */
+        void insert(const TelNumber& source, const TelNumber& destination,
+                    const TelNumber& final, bool cyclic);
+
+        /** returns slot of transformation from `source`
+         *  or NULL if there is none; */
+        const Slot* find(const TelNumber& source) const
+        {
+            size_t position = source.hash() & mask;
+            while(true) {
+                const Slot& slot = slots[position];
+                if(!(slot.flags & USED))
+                    return NULL;
+                if(slot.source == source)
+                    return &slot;
+                position = (position + 1) & mask;
+            }
+        }
+
+        /** find() of `length` characters of `source`; a long number
+         *  is compared by its digits instead of being interned, so
+         *  no lock is taken; */
+        const Slot* find(const char* source, size_t length) const
+        {
+            TelNumber packed;
+            if(packed.assignPacked(source, length))
+                return find(packed);
+            size_t position = TelNumber::hashLong(source, length) & mask;
+            while(true) {
+                const Slot& slot = slots[position];
+                if(!(slot.flags & USED))
+                    return NULL;
+                const char* text = slot.source.longText();
+                if(text != NULL && slot.source.size() == length
+                   && memcmp(text, source, length) == 0)
+                    return &slot;
+                position = (position + 1) & mask;
+            }
+        }
+
+        /** number of transformations; */
+        size_t getCount() const
+        {
+            return count;
+        }
+
+        /** number of slots (for iterating over all of them); */
+        size_t getCapacity() const
+        {
+            return mask + 1;
+        }
+
+        /** slot of given position (flags tell if it is used); */
+        const Slot& getSlot(size_t position) const
+        {
+            return slots[position];
+        }
+
+        ~TelFrozen();
+
+};
+
+#endif
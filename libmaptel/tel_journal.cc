@@ -0,0 +1,439 @@
+/** Write-ahead journals of maptels.        *
+ *  author: Cezary Bartoszuk                *
+ *  e-mail: cbart@students.mimuw.edu.pl     */
+
+#include <string>
+#include <vector>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "./debug_stream.h"
+#include "./tel_snapshot.h"
+#include "./tel_journal.h"
+
+const uint32_t TelJournal::VERSION;
+const uint8_t TelJournal::OPERATION_MASK;
+const uint8_t TelJournal::RAW_SOURCE;
+const uint8_t TelJournal::RAW_DESTINATION;
+const uint8_t TelJournal::PREFIX;
+
+const char TelJournal::MAGIC[8] = { 'M', 'A', 'P', 'T', 'E', 'L', 'J', '\0' };
+
+/** size of the frame header: payload size and checksum; */
+static const size_t FRAME_HEADER_SIZE = 8;
+
+/** true if `number` is made of digits only (it can be packed); */
+static bool isDigits(const std::string& number)
+{
+    for(size_t i = 0; i < number.size(); i ++)
+        if(number[i] < '0' || number[i] > '9')
+            return false;
+    return true;
+}
+
+/** appends `value` to `out` as varint (7 bits per byte); */
+static void encodeLength(size_t value, std::string& out)
+{
+    while(value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+/** reads varint at `it` (not further than `end`), false if malformed; */
+static bool decodeLength(const char*& it, const char* end, size_t& value)
+{
+    value = 0;
+    for(int shift = 0; it < end && shift < 35; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*it ++);
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+/** size of encoded number of given length; */
+static size_t encodedSize(size_t length, bool raw)
+{
+    return raw ? length : (length + 1) / 2;
+}
+
+/** reads number of given length at `it`, false if malformed; */
+static bool decodeNumber(const char*& it, const char* end, size_t length,
+                         bool raw, std::string& number)
+{
+    size_t size = encodedSize(length, raw);
+    if(static_cast<size_t>(end - it) < size)
+        return false;
+    if(raw)
+        number.assign(it, length);
+    else {
+        number.resize(length);
+        for(size_t i = 0; i < length; i ++) {
+            uint8_t byte = static_cast<uint8_t>(it[i / 2]);
+            uint8_t digit = (i % 2 == 0) ? (byte >> 4) : (byte & 0x0F);
+            if(digit > 9)
+                return false;
+            number[i] = static_cast<char>('0' + digit);
+        }
+    }
+    it += size;
+    return true;
+}
+
+/** writes all `size` bytes of `data` to `fd`, false on error; */
+static bool writeAll(int fd, const char* data, size_t size)
+{
+    while(size > 0) {
+        ssize_t written = write(fd, data, size);
+        if(written < 0 && errno == EINTR)
+            continue;
+        if(written <= 0)
+            return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+uint64_t TelJournal::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void TelJournal::encodeNumber(const std::string& number, bool raw,
+                              std::string& out)
+{
+    if(raw) {
+        out.append(number);
+        return;
+    }
+    /* two digits per byte, the first one in the high nibble; */
+    for(size_t i = 0; i + 1 < number.size(); i += 2)
+        out.push_back(static_cast<char>(((number[i] - '0') << 4)
+                                        | (number[i + 1] - '0')));
+    if(number.size() % 2 != 0)
+        out.push_back(static_cast<char>(((number[number.size() - 1] - '0')
+                                         << 4) | 0x0F));
+}
+
+bool TelJournal::decodeFrame(const char* begin, const char* end,
+                             std::vector<Record>& records)
+{
+    const char* it = begin;
+    Record record;
+    while(it < end) {
+        uint8_t flags = static_cast<uint8_t>(*it ++);
+        size_t source_length;
+        size_t destination_length = 0;
+        record.operation = static_cast<Operation>(flags & OPERATION_MASK);
+        record.prefix = (flags & PREFIX) != 0;
+        if(record.operation != INSERT && record.operation != ERASE)
+            return false;
+        if(!decodeLength(it, end, source_length))
+            return false;
+        if(record.operation == INSERT
+           && !decodeLength(it, end, destination_length))
+            return false;
+        if(!decodeNumber(it, end, source_length,
+                         (flags & RAW_SOURCE) != 0, record.source))
+            return false;
+        if(!decodeNumber(it, end, destination_length,
+                         (flags & RAW_DESTINATION) != 0, record.destination))
+            return false;
+        records.push_back(record);
+    }
+    return true;
+}
+
+TelJournal::TelJournal(const char* path, size_t group_bytes,
+                       unsigned long group_usec)
+    : fd(-1), group_bytes(group_bytes), group_usec(group_usec),
+      buffer_start(0), failed(false)
+{
+    int file = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if(file < 0) {
+        debug_err() << "TelJournal: cannot open file " << path << ".\n"
+            << std::flush;
+        return;
+    }
+    struct stat info;
+    Header header;
+    bool correct = (fstat(file, &info) == 0);
+    if(correct && info.st_size < (off_t) sizeof(Header)) {
+        /* new journal (or one torn while being created); */
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        correct = (ftruncate(file, 0) == 0)
+            && writeAll(file, reinterpret_cast<const char*>(&header),
+                        sizeof(header))
+            && (fdatasync(file) == 0);
+    }
+    else if(correct)
+        correct = (pread(file, &header, sizeof(header), 0) == sizeof(header))
+            && memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+            && header.version == VERSION;
+    if(!correct) {
+        debug_err() << "TelJournal: " << path << " is not a journal.\n"
+            << std::flush;
+        close(file);
+        return;
+    }
+    fd = file;
+#if MAPTEL_CONCURRENT
+    pthread_mutex_init(&buffer_mutex, NULL);
+    pthread_mutex_init(&file_mutex, NULL);
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&flusher_wakeup, &attributes);
+    pthread_condattr_destroy(&attributes);
+    stopping = false;
+    pthread_create(&flusher, NULL, flusherThread, this);
+#endif
+    debug_info() << "TelJournal: appending to " << path << ".\n"
+        << std::flush;
+}
+
+bool TelJournal::isOpen() const
+{
+    return fd >= 0;
+}
+
+void TelJournal::append(Operation operation, const std::string& source,
+                        const std::string& destination, bool prefix)
+{
+    assert(isOpen());
+    bool raw_source = !isDigits(source);
+    bool raw_destination = (operation == INSERT) && !isDigits(destination);
+    uint8_t flags = static_cast<uint8_t>(operation);
+    if(raw_source)
+        flags |= RAW_SOURCE;
+    if(raw_destination)
+        flags |= RAW_DESTINATION;
+    if(prefix)
+        flags |= PREFIX;
+#if MAPTEL_CONCURRENT
+    pthread_mutex_lock(&buffer_mutex);
+#endif
+    bool first = buffer.empty();
+    if(first)
+        buffer_start = now();
+    buffer.push_back(static_cast<char>(flags));
+    encodeLength(source.size(), buffer);
+    if(operation == INSERT)
+        encodeLength(destination.size(), buffer);
+    encodeNumber(source, raw_source, buffer);
+    if(operation == INSERT)
+        encodeNumber(destination, raw_destination, buffer);
+    bool full = (buffer.size() >= group_bytes);
+#if MAPTEL_CONCURRENT
+    /* the flusher sleeps until the first record or a full group; */
+    if(first || full)
+        pthread_cond_signal(&flusher_wakeup);
+    pthread_mutex_unlock(&buffer_mutex);
+#else
+    if(full || now() - buffer_start >= group_usec)
+        sync();
+#endif
+}
+
+bool TelJournal::commitLocked()
+{
+    if(writing.empty())
+        return !failed;
+    if(failed) {
+        /* frames after a torn one would be lost by recover() anyway; */
+        writing.clear();
+        return false;
+    }
+    uint32_t frame_header[2] = {
+        static_cast<uint32_t>(writing.size()),
+        static_cast<uint32_t>(TelSnapshot::checksum(writing.data(),
+                                                    writing.size())) };
+    writing.insert(0, reinterpret_cast<const char*>(frame_header),
+                   FRAME_HEADER_SIZE);
+    if(!writeAll(fd, writing.data(), writing.size()) || fdatasync(fd) != 0) {
+        debug_err() << "TelJournal: cannot write journal, "
+            << "journaling stopped.\n" << std::flush;
+        failed = true;
+    }
+    writing.clear();
+    return !failed;
+}
+
+bool TelJournal::sync()
+{
+    assert(isOpen());
+#if MAPTEL_CONCURRENT
+    pthread_mutex_lock(&file_mutex);
+    pthread_mutex_lock(&buffer_mutex);
+#endif
+    writing.swap(buffer);
+    buffer.clear();
+#if MAPTEL_CONCURRENT
+    pthread_mutex_unlock(&buffer_mutex);
+#endif
+    /* appends go on while the group is written; */
+    bool result = commitLocked();
+#if MAPTEL_CONCURRENT
+    pthread_mutex_unlock(&file_mutex);
+#endif
+    return result;
+}
+
+bool TelJournal::truncate()
+{
+    assert(isOpen());
+#if MAPTEL_CONCURRENT
+    pthread_mutex_lock(&file_mutex);
+    pthread_mutex_lock(&buffer_mutex);
+#endif
+    buffer.clear();
+#if MAPTEL_CONCURRENT
+    pthread_mutex_unlock(&buffer_mutex);
+#endif
+    writing.clear();
+    if(!failed && (ftruncate(fd, sizeof(Header)) != 0 || fdatasync(fd) != 0)) {
+        debug_err() << "TelJournal: cannot truncate journal, "
+            << "journaling stopped.\n" << std::flush;
+        failed = true;
+    }
+    bool result = !failed;
+#if MAPTEL_CONCURRENT
+    pthread_mutex_unlock(&file_mutex);
+#endif
+    return result;
+}
+
+#if MAPTEL_CONCURRENT
+void* TelJournal::flusherThread(void* journal)
+{
+    TelJournal* self = static_cast<TelJournal*>(journal);
+    pthread_mutex_lock(&self->buffer_mutex);
+    while(!self->stopping) {
+        if(self->buffer.empty()) {
+            pthread_cond_wait(&self->flusher_wakeup, &self->buffer_mutex);
+            continue;
+        }
+        /* saturated, so huge `group_usec` never commits by time; */
+        uint64_t deadline = self->buffer_start + self->group_usec;
+        if(deadline < self->buffer_start)
+            deadline = ~uint64_t(0);
+        if(self->buffer.size() < self->group_bytes && now() < deadline) {
+            struct timespec ts;
+            ts.tv_sec = deadline / 1000000;
+            ts.tv_nsec = (deadline % 1000000) * 1000;
+            pthread_cond_timedwait(&self->flusher_wakeup,
+                                   &self->buffer_mutex, &ts);
+            continue;
+        }
+        pthread_mutex_unlock(&self->buffer_mutex);
+        self->sync();
+        pthread_mutex_lock(&self->buffer_mutex);
+    }
+    pthread_mutex_unlock(&self->buffer_mutex);
+    return NULL;
+}
+#endif
+
+bool TelJournal::recover(const char* path, std::vector<Record>& records)
+{
+    records.clear();
+    int file = open(path, O_RDWR);
+    if(file < 0 && errno == ENOENT) {
+        debug_info() << "TelJournal: no journal " << path << ".\n"
+            << std::flush;
+        return true;
+    }
+    if(file < 0) {
+        debug_err() << "TelJournal: cannot open file " << path << ".\n"
+            << std::flush;
+        return false;
+    }
+    /* journals are short (they are truncated by checkpoints),
+     * so the whole file is read at once; */
+    std::string content;
+    char chunk[1 << 16];
+    ssize_t got;
+    while((got = read(file, chunk, sizeof(chunk))) > 0
+          || (got < 0 && errno == EINTR))
+        if(got > 0)
+            content.append(chunk, got);
+    bool correct = (got == 0);
+    Header header;
+    if(correct && content.size() >= sizeof(Header)) {
+        memcpy(&header, content.data(), sizeof(header));
+        correct = memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+            && header.version == VERSION;
+    }
+    if(!correct) {
+        debug_err() << "TelJournal: " << path << " is not a journal.\n"
+            << std::flush;
+        close(file);
+        return false;
+    }
+    size_t valid_end = 0;
+    if(content.size() >= sizeof(Header)) {
+        size_t pos = sizeof(Header);
+        while(content.size() - pos >= FRAME_HEADER_SIZE) {
+            uint32_t frame_header[2];
+            memcpy(frame_header, content.data() + pos, FRAME_HEADER_SIZE);
+            const char* payload = content.data() + pos + FRAME_HEADER_SIZE;
+            size_t available = content.size() - pos - FRAME_HEADER_SIZE;
+            size_t decoded = records.size();
+            if(frame_header[0] > available
+               || frame_header[1] != static_cast<uint32_t>(
+                      TelSnapshot::checksum(payload, frame_header[0]))
+               || !decodeFrame(payload, payload + frame_header[0], records)) {
+                records.resize(decoded);
+                break;
+            }
+            pos += FRAME_HEADER_SIZE + frame_header[0];
+        }
+        valid_end = pos;
+    }
+    if(valid_end < content.size()) {
+        debug_warn() << "TelJournal: cutting off " << content.size() - valid_end
+            << "B of torn journal " << path << ".\n" << std::flush;
+        if(ftruncate(file, valid_end) != 0 || fdatasync(file) != 0)
+            debug_err() << "TelJournal: cannot truncate " << path << ".\n"
+                << std::flush;
+    }
+    close(file);
+    debug_info() << "TelJournal: recovered " << records.size()
+        << " records of " << path << ".\n" << std::flush;
+    return true;
+}
+
+TelJournal::~TelJournal()
+{
+    if(!isOpen())
+        return;
+#if MAPTEL_CONCURRENT
+    pthread_mutex_lock(&buffer_mutex);
+    stopping = true;
+    pthread_cond_signal(&flusher_wakeup);
+    pthread_mutex_unlock(&buffer_mutex);
+    pthread_join(flusher, NULL);
+#endif
+    sync();
+    close(fd);
+#if MAPTEL_CONCURRENT
+    pthread_cond_destroy(&flusher_wakeup);
+    pthread_mutex_destroy(&file_mutex);
+    pthread_mutex_destroy(&buffer_mutex);
+#endif
+}
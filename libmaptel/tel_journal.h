@@ -0,0 +1,161 @@
+/** Write-ahead journals of maptels.                         *
+ *  author: Cezary Bartoszuk                                 *
+ *  e-mail: cbart@students.mimuw.edu.pl                      *
+ *  A journal file starts with a short header followed by    *
+ *  frames. A frame is a group of records committed at once  *
+ *  (one write and one fdatasync()): 32 bit payload size,    *
+ *  32 bit checksum of the payload and the payload. Record:  *
+ *    1 byte:  operation, prefix rule and encoding flags,    *
+ *    varint:  source length (and destination length         *
+ *             for inserts),                                 *
+ *    numbers: packed two digits per byte (or raw bytes      *
+ *             if a number is not made of digits only).      *
+ *  Records are buffered in memory and committed when the    *
+ *  buffer reaches `group_bytes` or `group_usec` after the   *
+ *  first buffered record (by a background thread in the     *
+ *  concurrent version, by the next append otherwise). A     *
+ *  frame torn by a crash is cut off by recover().           */
+
+#ifndef _TEL_JOURNAL_H_
+#define _TEL_JOURNAL_H_
+
+#include <string>
+#include <vector>
+
+#include <cstddef>
+
+#include <stdint.h>
+
+#if MAPTEL_CONCURRENT
+#include <pthread.h>
+#endif
+
+class TelJournal {
+
+    public:
+
+        /** journaled modification; */
+        enum Operation {
+            INSERT = 1,
+            ERASE = 2
+        };
+
+        /** single record read back from a journal; */
+        struct Record {
+            Operation operation;
+            /** true for prefix rules; */
+            bool prefix;
+            std::string source;
+            /** empty for erases; */
+            std::string destination;
+        };
+
+    private:
+
+        /** beginning of the file; */
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t reserved;
+        };
+
+        static const char MAGIC[8];
+
+        static const uint32_t VERSION = 1;
+
+        /** record flags (the low bits hold the operation); */
+        static const uint8_t OPERATION_MASK = 3;
+        static const uint8_t RAW_SOURCE = 4;
+        static const uint8_t RAW_DESTINATION = 8;
+        static const uint8_t PREFIX = 16;
+
+        /** journal file (opened for appending) or -1; */
+        int fd;
+
+        /** commit thresholds; */
+        size_t group_bytes;
+        unsigned long group_usec;
+
+        /** records not committed yet; */
+        std::string buffer;
+
+        /** time (in microseconds) of the first record in `buffer`; */
+        uint64_t buffer_start;
+
+        /** records being committed; */
+        std::string writing;
+
+        /** true after an I/O error (nothing is committed then); */
+        bool failed;
+
+#if MAPTEL_CONCURRENT
+        /** guards `buffer`, `buffer_start` and `stopping`; */
+        pthread_mutex_t buffer_mutex;
+
+        /** serializes commits (guards `fd`, `writing` and `failed`); */
+        pthread_mutex_t file_mutex;
+
+        /** wakes up the flusher thread; */
+        pthread_cond_t flusher_wakeup;
+
+        /** committing thread; */
+        pthread_t flusher;
+
+        /** true if the flusher thread must exit; */
+        bool stopping;
+
+        /** flusher thread entry point; */
+        static void* flusherThread(void* journal);
+#endif
+
+        TelJournal(const TelJournal& copy);
+        TelJournal& operator=(const TelJournal& copy);
+
+        /** monotonic time in microseconds; */
+        static uint64_t now();
+
+        /** appends encoded `number` to `out`; */
+        static void encodeNumber(const std::string& number, bool raw,
+                                 std::string& out);
+
+        /** decodes records of a frame payload, false if malformed; */
+        static bool decodeFrame(const char* begin, const char* end,
+                                std::vector<Record>& records);
+
+        /** writes `writing` as a single frame (must hold `file_mutex`); */
+        bool commitLocked();
+
+    public:
+
+        /** opens (or creates) journal `path` for appending; an existing
+         *  journal must be recovered first (see recover()); */
+        TelJournal(const char* path, size_t group_bytes,
+                   unsigned long group_usec);
+
+        /** true if the journal has been opened; */
+        bool isOpen() const;
+
+        /** buffers record of a modification of an exact (or prefix)
+         *  rule (the caller orders modifications, e.g. by an exclusive
+         *  lock); */
+        void append(Operation operation, const std::string& source,
+                    const std::string& destination, bool prefix = false);
+
+        /** commits all buffered records; false on I/O error; */
+        bool sync();
+
+        /** drops all records, committed and buffered (when they are
+         *  saved elsewhere, e.g. in a snapshot); false on I/O error; */
+        bool truncate();
+
+        /** reads committed records of journal `path` (in order)
+         *  and cuts off a torn tail; a missing journal is empty;
+         *  false if the file cannot be read or is not a journal; */
+        static bool recover(const char* path, std::vector<Record>& records);
+
+        /** commits buffered records and closes the journal; */
+        ~TelJournal();
+
+};
+
+#endif
@@ -0,0 +1,132 @@
+/** Packed phone numbers used by libmaptel. *
+ *  author: Cezary Bartoszuk                *
+ *  e-mail: cbart@students.mimuw.edu.pl     */
+
+#include <string>
+#include <ostream>
+#include <new>
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include "./rw_lock.h"
+#include "./hash_table.h"
+#include "./tel_number.h"
+
+const size_t TelNumber::MAX_PACKED;
+
+const uint64_t TelNumber::LENGTH_MASK;
+
+/** Key of a block in the pool (`text` of the block or of a number
+ *  being looked up). */
+struct PoolKey {
+    const char* text;
+    uint32_t length;
+    uint32_t hash;
+
+    bool operator==(const PoolKey& other) const
+    {
+        return length == other.length
+            && memcmp(text, other.text, length) == 0;
+    }
+};
+
+/** Hash of a PoolKey (for HashTable). */
+struct PoolKeyHash {
+
+    uint32_t operator()(const PoolKey& key) const
+    {
+        return key.hash;
+    }
+
+};
+
+/** Blocks of long numbers by their texts. A reference is added
+ *  to a block found in `blocks` under shared `lock` and the last
+ *  one is dropped under exclusive `lock`, so a block is never
+ *  found while it is being freed. */
+class TelNumber::Pool {
+
+    public:
+
+        RWLock lock;
+
+        HashTable<PoolKey, Long*, PoolKeyHash> blocks;
+
+};
+
+TelNumber::Pool& TelNumber::getPool()
+{
+    /* the pool is never destroyed, as numbers of static objects
+     * (maptels destroyed at exit) may be released after it; */
+    static Pool* pool = new Pool();
+    return *pool;
+}
+
+void TelNumber::assignLong(const char* number, size_t length)
+{
+    Pool& pool = getPool();
+    PoolKey key = { number, static_cast<uint32_t>(length),
+                    hashLong(number, length) };
+    {
+        ReadGuard guard(pool.lock);
+        Long* const* found = pool.blocks.find(key);
+        if(found != NULL) {
+            __atomic_add_fetch(&(*found)->references, 1, __ATOMIC_RELAXED);
+            word = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(*found));
+            return;
+        }
+    }
+    WriteGuard guard(pool.lock);
+    Long** found = pool.blocks.find(key);
+    if(found != NULL) {
+        __atomic_add_fetch(&(*found)->references, 1, __ATOMIC_RELAXED);
+        word = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(*found));
+        return;
+    }
+    /* the address must have its low nibble clear, see isPacked(); */
+    void* memory = NULL;
+    if(posix_memalign(&memory, 16, offsetof(Long, text) + length + 1) != 0)
+        throw std::bad_alloc();
+    Long* created = static_cast<Long*>(memory);
+    created->references = 1;
+    created->length = key.length;
+    created->hash = key.hash;
+    memcpy(created->text, number, length);
+    created->text[length] = '\0';
+    key.text = created->text;
+    pool.blocks.insert(key, created);
+    word = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(created));
+    assert(!isPacked());
+}
+
+void TelNumber::releaseLong()
+{
+    Long* released = const_cast<Long*>(block());
+    word = 0;
+    uint32_t references = __atomic_load_n(&released->references,
+                                          __ATOMIC_RELAXED);
+    while(references > 1)
+        if(__atomic_compare_exchange_n(&released->references, &references,
+                                       references - 1, true,
+                                       __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            return;
+    Pool& pool = getPool();
+    WriteGuard guard(pool.lock);
+    if(__atomic_sub_fetch(&released->references, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+    PoolKey key = { released->text, released->length, released->hash };
+    pool.blocks.erase(key);
+    free(released);
+}
+
+uint32_t TelNumber::hashLong(const char* number, size_t length)
+{
+    return hashBytes(number, length);
+}
+
+std::ostream& operator<<(std::ostream& out, const TelNumber& number)
+{
+    return out << number.toString();
+}
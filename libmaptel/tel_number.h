@@ -0,0 +1,335 @@
+/** Packed phone numbers used by libmaptel.                 *
+ *  author: Cezary Bartoszuk                                *
+ *  e-mail: cbart@students.mimuw.edu.pl                     *
+ *  A number is a single 64 bit word. Numbers of up to 15   *
+ *  digits (every E.164 number) are packed: the low nibble  *
+ *  holds the length and the following nibbles the digits,  *
+ *  so copying, hashing and comparing them never touch the  *
+ *  heap. Longer numbers (and strings which are not made of *
+ *  digits only) are interned: all equal ones share a block *
+ *  aligned to 16 bytes, held in a global pool while it has *
+ *  references; the word is the block's address, whose low *
+ *  nibble is zero. So every two equal numbers have equal   *
+ *  words. The empty number is 0.                           */
+
+#ifndef _TEL_NUMBER_H_
+#define _TEL_NUMBER_H_
+
+#include <string>
+#include <ostream>
+
+#include <cstddef>
+#include <cstring>
+
+#include <stdint.h>
+
+class TelNumber {
+
+    private:
+
+        /** packed digits or address of a long number; */
+        uint64_t word;
+
+        /** maximal number of packed digits; */
+        static const size_t MAX_PACKED = 15;
+
+        /** nibble holding the length of a packed number; */
+        static const uint64_t LENGTH_MASK = 15;
+
+        /** long number block (see Pool); */
+        struct Long {
+            /** number of TelNumbers holding the block; */
+            mutable uint32_t references;
+            uint32_t length;
+            /** hash() of the number; */
+            uint32_t hash;
+            char text[1];
+        };
+
+        /** blocks of all long numbers; */
+        class Pool;
+
+        /** the pool (never destroyed); */
+        static Pool& getPool();
+
+        /** true if the number is not a long one; */
+        bool isPacked() const
+        {
+            return (word & LENGTH_MASK) != 0 || word == 0;
+        }
+
+        /** block of a long number; */
+        const Long* block() const
+        {
+            return reinterpret_cast<const Long*>(
+                static_cast<uintptr_t>(word));
+        }
+
+        /** sets `word` to the block holding `number`
+         *  (created if there is none); */
+        void assignLong(const char* number, size_t length);
+
+        /** adds a reference to the block of a long number; */
+        void retainLong() const
+        {
+            __atomic_add_fetch(&block()->references, 1, __ATOMIC_RELAXED);
+        }
+
+        /** frees the block of a long number; */
+        void release()
+        {
+            if(!isPacked())
+                releaseLong();
+        }
+
+        /** release() of a long number (frees the block with its
+         *  last reference); */
+        void releaseLong();
+
+    public:
+
+        /** hash of `length` characters of `number` (stored in blocks
+         *  of long numbers, so it is hash() of a long number); */
+        static uint32_t hashLong(const char* number, size_t length);
+
+        /** true if numbers of `length` digits are packed, so they hold
+         *  no block and their destructors do nothing; */
+        static bool isPackable(size_t length)
+        {
+            return length <= MAX_PACKED;
+        }
+
+        /** creates the empty number; */
+        TelNumber()
+            : word(0)
+        {
+        }
+
+        /** creates number of `length` characters of `number`; */
+        TelNumber(const char* number, size_t length)
+            : word(0)
+        {
+            assign(number, length);
+        }
+
+        explicit TelNumber(const std::string& number)
+            : word(0)
+        {
+            assign(number.data(), number.size());
+        }
+
+        TelNumber(const TelNumber& copy)
+            : word(copy.word)
+        {
+            if(!copy.isPacked())
+                copy.retainLong();
+        }
+
+        TelNumber& operator=(const TelNumber& copy)
+        {
+            if(word != copy.word) {
+                if(!copy.isPacked())
+                    copy.retainLong();
+                release();
+                word = copy.word;
+            }
+            return *this;
+        }
+
+        ~TelNumber()
+        {
+            release();
+        }
+
+        /** sets number to `length` characters of `number`; */
+        void assign(const char* number, size_t length)
+        {
+            if(!assignPacked(number, length))
+                assignLong(number, length);
+        }
+
+        /** sets number to `length` characters of `number` if they can
+         *  be packed, otherwise returns false leaving the number empty
+         *  (so a long number is looked up without touching the pool,
+         *  see TelFrozen::find()); */
+        bool assignPacked(const char* number, size_t length)
+        {
+            release();
+            word = 0;
+            if(length > MAX_PACKED)
+                return false;
+            uint64_t packed = length;
+            for(size_t i = 0; i < length; i ++) {
+                unsigned digit = static_cast<unsigned char>(number[i]) - '0';
+                if(digit > 9)
+                    return false;
+                packed |= static_cast<uint64_t>(digit) << (4 * i + 4);
+            }
+            word = packed;
+            return true;
+        }
+
+        /** '\0' terminated digits of a long number (valid while
+         *  the number has references) or NULL for a packed one; */
+        const char* longText() const
+        {
+            return isPacked() ? NULL : block()->text;
+        }
+
+        /** number of digits; */
+        size_t size() const
+        {
+            return isPacked() ? static_cast<size_t>(word & LENGTH_MASK)
+                              : block()->length;
+        }
+
+        bool empty() const
+        {
+            return word == 0;
+        }
+
+        /** writes '\0' terminated digits of the number to `out`
+         *  (of at least size() + 1 bytes); */
+        void copyTo(char* out) const
+        {
+            if(!isPacked()) {
+                memcpy(out, block()->text, block()->length + 1);
+                return;
+            }
+            size_t length = static_cast<size_t>(word & LENGTH_MASK);
+            uint64_t packed = word;
+            for(size_t i = 0; i < length; i ++) {
+                packed >>= 4;
+                out[i] = static_cast<char>('0' + (packed & 15));
+            }
+            out[length] = '\0';
+        }
+
+        /** sets `out` to digits of the number; */
+        void copyTo(std::string& out) const
+        {
+            if(!isPacked()) {
+                out.assign(block()->text, block()->length);
+                return;
+            }
+            char digits[MAX_PACKED + 1];
+            copyTo(digits);
+            out.assign(digits, static_cast<size_t>(word & LENGTH_MASK));
+        }
+
+        /** returns digits of the number; */
+        std::string toString() const
+        {
+            std::string out;
+            copyTo(out);
+            return out;
+        }
+
+        /** 32 bit hash of the number; */
+        uint32_t hash() const
+        {
+            if(!isPacked())
+                return block()->hash;
+            uint64_t h = (word ^ (word >> 31)) * 0xBF58476D1CE4E5B9ULL;
+            h ^= h >> 29;
+            return static_cast<uint32_t>(h >> 32);
+        }
+
+        /** equal numbers have equal words (long ones are interned); */
+        bool operator==(const TelNumber& other) const
+        {
+            return word == other.word;
+        }
+
+        bool operator!=(const TelNumber& other) const
+        {
+            return !(*this == other);
+        }
+
+        /** a total order of numbers (packed ones are ordered by their
+         *  words, which is not the order of their digits); */
+        bool operator<(const TelNumber& other) const
+        {
+            if(isPacked() != other.isPacked())
+                return isPacked();
+            if(isPacked())
+                return word < other.word;
+            uint32_t length = block()->length;
+            uint32_t other_length = other.block()->length;
+            int order = memcmp(block()->text, other.block()->text,
+                               (length < other_length) ? length
+                                                       : other_length);
+            return order < 0 || (order == 0 && length < other_length);
+        }
+
+};
+
+/** Number looked up in tables of TelNumbers by its characters (see
+ *  CowTable::findProbe()): a long number is compared with the digits
+ *  of interned ones instead of being interned itself, so a lookup
+ *  takes no lock of the pool and allocates nothing (a long number
+ *  which is not in the pool is in no table). The characters must
+ *  outlive the probe. */
+class TelProbe {
+
+    private:
+
+        /** the number if it is not a long one; */
+        TelNumber packed;
+
+        /** true if the number is a long one; */
+        bool is_long;
+
+        const char* text;
+        size_t length;
+
+        /** TelNumber::hash() of the number; */
+        uint32_t h;
+
+    public:
+
+        TelProbe(const char* text, size_t length)
+            : is_long(!packed.assignPacked(text, length)),
+              text(text), length(length),
+              h(is_long ? TelNumber::hashLong(text, length) : packed.hash())
+        {
+        }
+
+        explicit TelProbe(const std::string& number)
+            : is_long(!packed.assignPacked(number.data(), number.size())),
+              text(number.data()), length(number.size()),
+              h(is_long ? TelNumber::hashLong(text, length) : packed.hash())
+        {
+        }
+
+        /** TelNumber::hash() of the number; */
+        uint32_t hash() const
+        {
+            return h;
+        }
+
+        /** true if `number` is the probed number; */
+        bool matches(const TelNumber& number) const
+        {
+            if(!is_long)
+                return number == packed;
+            const char* digits = number.longText();
+            return digits != NULL && number.size() == length
+                && memcmp(digits, text, length) == 0;
+        }
+
+};
+
+/** Hash of a TelNumber (for HashTable). */
+struct TelNumberHash {
+
+    uint32_t operator()(const TelNumber& key) const
+    {
+        return key.hash();
+    }
+
+};
+
+std::ostream& operator<<(std::ostream& out, const TelNumber& number);
+
+#endif
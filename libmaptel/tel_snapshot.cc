@@ -0,0 +1,414 @@
+/** Binary snapshots of maptels.            *
+ *  author: Cezary Bartoszuk                *
+ *  e-mail: cbart@students.mimuw.edu.pl     */
+
+#include <string>
+#include <vector>
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "./debug_stream.h"
+#include "./hash_table.h"
+#include "./tel_snapshot.h"
+
+const uint32_t TelSnapshot::VERSION;
+const uint32_t TelSnapshot::BYTE_ORDER_MARK;
+const uint32_t TelSnapshot::CYCLIC;
+
+const char TelSnapshot::MAGIC[8] = { 'M', 'A', 'P', 'T', 'E', 'L', 'S', '\0' };
+
+/** returns non zero hash of `number` (as HashTable does); */
+static uint32_t hashOf(const std::string& number)
+{
+    uint32_t h = StringHash()(number);
+    return (h == 0) ? 1 : h;
+}
+
+/** returns offset of `number` in `numbers`, appending it
+ *  (and remembering its offset in `offsets`) if it is new; */
+static uint64_t placeNumber(const std::string& number,
+                            HashTable<std::string, uint64_t, StringHash>&
+                                offsets,
+                            std::string& numbers)
+{
+    const uint64_t* offset = offsets.find(number);
+    if(offset != NULL)
+        return *offset;
+    uint64_t added = numbers.size();
+    offsets.insert(number, added);
+    numbers.append(number);
+    numbers.push_back('\0');
+    return added;
+}
+
+/** rounds `offset` up to a multiple of 8; */
+static uint64_t align(uint64_t offset)
+{
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+uint64_t TelSnapshot::checksum(const char* data, size_t size)
+{
+    /* four independent lanes, so that multiplications overlap; */
+    uint64_t lanes[4] = { 0x9E3779B97F4A7C15ULL ^ size, 0xBF58476D1CE4E5B9ULL,
+                          0x94D049BB133111EBULL, 0x2545F4914F6CDD1DULL };
+    uint64_t word;
+    while(size >= 32) {
+        for(int i = 0; i < 4; i ++) {
+            memcpy(&word, data + 8 * i, 8);
+            lanes[i] = (lanes[i] ^ word) * 0xBF58476D1CE4E5B9ULL;
+            lanes[i] ^= lanes[i] >> 31;
+        }
+        data += 32;
+        size -= 32;
+    }
+    uint64_t h = lanes[0];
+    for(int i = 1; i < 4; i ++)
+        h = (h ^ lanes[i]) * 0x94D049BB133111EBULL;
+    while(size > 0) {
+        word = 0;
+        size_t length = (size < 8) ? size : 8;
+        memcpy(&word, data, length);
+        h = (h ^ word) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 29;
+        data += length;
+        size -= length;
+    }
+    return h;
+}
+
+bool TelSnapshot::save(const char* path,
+                       const std::vector<Transformation>& transformations,
+                       const std::vector<PrefixRule>& prefix_rules)
+{
+    uint64_t count = transformations.size();
+    uint64_t prefix_count = prefix_rules.size();
+    if(count >= UINT32_MAX) {
+        debug_err() << "TelSnapshot: too many transformations ("
+            << count << ").\n" << std::flush;
+        return false;
+    }
+    /* at most half of the slots are used, so probing is short; */
+    uint64_t slot_count = 1;
+    while(slot_count < 2 * count + 1)
+        slot_count *= 2;
+
+    /* every number is stored once: destinations and results
+     * of transformEx() are mostly sources of other entries; */
+    HashTable<std::string, uint64_t, StringHash> offsets;
+    offsets.reserve(count);
+    std::string numbers;
+    std::string number;
+    std::vector<Entry> entries(count);
+    std::vector<Slot> slots(slot_count);
+    memset(&slots[0], 0, slot_count * sizeof(Slot));
+    for(uint64_t i = 0; i < count; i ++) {
+        const Transformation& t = transformations[i];
+        const char* texts[3] = { t.source, t.destination, t.final };
+        uint32_t lengths[3] = { t.source_length, t.destination_length,
+                                t.final_length };
+        uint64_t found[3];
+        for(int j = 0; j < 3; j ++) {
+            number.assign(texts[j], lengths[j]);
+            found[j] = placeNumber(number, offsets, numbers);
+        }
+        Entry entry = { found[0], found[1], found[2],
+                        lengths[0], lengths[1], lengths[2],
+                        t.cyclic ? CYCLIC : 0 };
+        entries[i] = entry;
+        number.assign(t.source, t.source_length);
+        Slot slot = { hashOf(number), static_cast<uint32_t>(i) };
+        uint64_t pos = slot.hash & (slot_count - 1);
+        while(slots[pos].hash != 0)
+            pos = (pos + 1) & (slot_count - 1);
+        slots[pos] = slot;
+    }
+    std::vector<Prefix> prefixes(prefix_count);
+    for(uint64_t i = 0; i < prefix_count; i ++) {
+        const PrefixRule& rule = prefix_rules[i];
+        number.assign(rule.source, rule.source_length);
+        prefixes[i].source = placeNumber(number, offsets, numbers);
+        number.assign(rule.destination, rule.destination_length);
+        prefixes[i].destination = placeNumber(number, offsets, numbers);
+        prefixes[i].source_length = rule.source_length;
+        prefixes[i].destination_length = rule.destination_length;
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.byte_order = BYTE_ORDER_MARK;
+    header.version = VERSION;
+    header.header_size = sizeof(Header);
+    header.count = count;
+    header.slot_count = slot_count;
+    header.entries_offset = align(sizeof(Header));
+    header.slots_offset = header.entries_offset + count * sizeof(Entry);
+    header.prefix_count = prefix_count;
+    header.prefixes_offset = header.slots_offset + slot_count * sizeof(Slot);
+    header.numbers_offset = header.prefixes_offset
+        + prefix_count * sizeof(Prefix);
+    header.numbers_size = numbers.size();
+    header.file_size = header.numbers_offset + numbers.size();
+
+    std::vector<char> image(header.file_size, '\0');
+    if(count > 0)
+        memcpy(&image[header.entries_offset], &entries[0],
+               count * sizeof(Entry));
+    memcpy(&image[header.slots_offset], &slots[0], slot_count * sizeof(Slot));
+    if(prefix_count > 0)
+        memcpy(&image[header.prefixes_offset], &prefixes[0],
+               prefix_count * sizeof(Prefix));
+    if(!numbers.empty())
+        memcpy(&image[header.numbers_offset], numbers.data(), numbers.size());
+    header.body_checksum = checksum(&image[header.header_size],
+                                    header.file_size - header.header_size);
+    header.header_checksum = checksum(reinterpret_cast<const char*>(&header),
+                                      offsetof(Header, header_checksum));
+    memcpy(&image[0], &header, sizeof(header));
+
+    /* readers of `path` see either the old or the new snapshot; */
+    std::string temporary = std::string(path) + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if(file == NULL) {
+        debug_err() << "TelSnapshot: cannot create file " << temporary
+            << ".\n" << std::flush;
+        return false;
+    }
+    bool written = (fwrite(&image[0], 1, image.size(), file) == image.size());
+    written = (fflush(file) == 0) && written;
+    written = (fsync(fileno(file)) == 0) && written;
+    written = (fclose(file) == 0) && written;
+    if(written && rename(temporary.c_str(), path) == 0) {
+        debug_info() << "TelSnapshot: saved " << count << " transformations ("
+            << image.size() << "B) to " << path << ".\n" << std::flush;
+        return true;
+    }
+    debug_err() << "TelSnapshot: cannot write file " << path << ".\n"
+        << std::flush;
+    remove(temporary.c_str());
+    return false;
+}
+
+TelSnapshot::TelSnapshot(const char* path)
+    : data(NULL), size(0), entries(NULL), slots(NULL), prefixes(NULL),
+      numbers(NULL), header(NULL)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        debug_err() << "TelSnapshot: cannot open file " << path << ".\n"
+            << std::flush;
+        return;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size < (off_t) sizeof(Header))
+        debug_err() << "TelSnapshot: " << path << " is not a snapshot.\n"
+            << std::flush;
+    else {
+        /* shared mapping: pages come straight from the page cache
+         * and are shared by all processes mapping the snapshot; */
+        void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if(mapped != MAP_FAILED) {
+            data = static_cast<const char*>(mapped);
+            size = info.st_size;
+        }
+        else
+            debug_err() << "TelSnapshot: cannot map file " << path << ".\n"
+                << std::flush;
+    }
+    close(fd);
+    if(data == NULL)
+        return;
+    header = reinterpret_cast<const Header*>(data);
+    if(!verify()) {
+        debug_err() << "TelSnapshot: " << path << " is corrupted.\n"
+            << std::flush;
+        munmap(const_cast<char*>(data), size);
+        data = NULL;
+        header = NULL;
+        return;
+    }
+    entries = reinterpret_cast<const Entry*>(data + header->entries_offset);
+    slots = reinterpret_cast<const Slot*>(data + header->slots_offset);
+    prefixes = reinterpret_cast<const Prefix*>(data + header->prefixes_offset);
+    numbers = data + header->numbers_offset;
+    debug_info() << "TelSnapshot: mapped " << header->count
+        << " transformations of " << path << ".\n" << std::flush;
+}
+
+bool TelSnapshot::verify() const
+{
+    if(memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0
+       || header->byte_order != BYTE_ORDER_MARK
+       || header->version != VERSION
+       || header->header_size != sizeof(Header))
+        return false;
+    if(header->header_checksum
+       != checksum(data, offsetof(Header, header_checksum)))
+        return false;
+    /* sections must be aligned and lie in the file (sizes are
+     * compared before multiplying to avoid overflows); */
+    uint64_t count = header->count;
+    uint64_t slot_count = header->slot_count;
+    uint64_t prefix_count = header->prefix_count;
+    if(header->file_size != size
+       || header->entries_offset % 8 != 0 || header->slots_offset % 8 != 0
+       || header->entries_offset < sizeof(Header)
+       || header->entries_offset > size
+       || count > (size - header->entries_offset) / sizeof(Entry)
+       || header->slots_offset != header->entries_offset
+                                  + count * sizeof(Entry)
+       || slot_count == 0 || (slot_count & (slot_count - 1)) != 0
+       || slot_count <= count
+       || slot_count > (size - header->slots_offset) / sizeof(Slot)
+       || header->prefixes_offset != header->slots_offset
+                                     + slot_count * sizeof(Slot)
+       || prefix_count > (size - header->prefixes_offset) / sizeof(Prefix)
+       || header->numbers_offset != header->prefixes_offset
+                                    + prefix_count * sizeof(Prefix)
+       || header->numbers_size != size - header->numbers_offset)
+        return false;
+    if(header->body_checksum
+       != checksum(data + header->header_size, size - header->header_size))
+        return false;
+    /* every number must lie in the numbers section and be terminated; */
+    const Entry* all = reinterpret_cast<const Entry*>(data
+        + header->entries_offset);
+    const char* text = data + header->numbers_offset;
+    uint64_t text_size = header->numbers_size;
+    for(uint64_t i = 0; i < count; i ++) {
+        const uint64_t offsets[3] = { all[i].source, all[i].destination,
+                                      all[i].final };
+        const uint64_t lengths[3] = { all[i].source_length,
+                                      all[i].destination_length,
+                                      all[i].final_length };
+        for(int j = 0; j < 3; j ++)
+            if(offsets[j] >= text_size || lengths[j] >= text_size - offsets[j]
+               || text[offsets[j] + lengths[j]] != '\0')
+                return false;
+    }
+    const Prefix* rules = reinterpret_cast<const Prefix*>(data
+        + header->prefixes_offset);
+    for(uint64_t i = 0; i < prefix_count; i ++) {
+        const uint64_t offsets[2] = { rules[i].source, rules[i].destination };
+        const uint64_t lengths[2] = { rules[i].source_length,
+                                      rules[i].destination_length };
+        for(int j = 0; j < 2; j ++)
+            if(offsets[j] >= text_size || lengths[j] >= text_size - offsets[j]
+               || text[offsets[j] + lengths[j]] != '\0')
+                return false;
+    }
+    /* a slot per entry, so there are empty slots (slot_count > count)
+     * at which find() stops; */
+    const Slot* index = reinterpret_cast<const Slot*>(data
+        + header->slots_offset);
+    uint64_t used = 0;
+    for(uint64_t i = 0; i < slot_count; i ++)
+        if(index[i].hash != 0) {
+            if(index[i].index >= count)
+                return false;
+            used ++;
+        }
+    return used == count;
+}
+
+bool TelSnapshot::isOpen() const
+{
+    return data != NULL;
+}
+
+size_t TelSnapshot::getCount() const
+{
+    assert(isOpen());
+    return header->count;
+}
+
+size_t TelSnapshot::find(const std::string& source) const
+{
+    assert(isOpen());
+    uint32_t h = hashOf(source);
+    uint64_t mask = header->slot_count - 1;
+    for(uint64_t pos = h & mask; slots[pos].hash != 0; pos = (pos + 1) & mask)
+        if(slots[pos].hash == h) {
+            const Entry& entry = entries[slots[pos].index];
+            if(entry.source_length == source.size()
+               && memcmp(numbers + entry.source, source.data(),
+                         source.size()) == 0)
+                return slots[pos].index;
+        }
+    return header->count;
+}
+
+const char* TelSnapshot::getSource(size_t index) const
+{
+    return numbers + entries[index].source;
+}
+
+size_t TelSnapshot::getSourceLength(size_t index) const
+{
+    return entries[index].source_length;
+}
+
+const char* TelSnapshot::getDestination(size_t index) const
+{
+    return numbers + entries[index].destination;
+}
+
+size_t TelSnapshot::getDestinationLength(size_t index) const
+{
+    return entries[index].destination_length;
+}
+
+const char* TelSnapshot::getFinal(size_t index) const
+{
+    return numbers + entries[index].final;
+}
+
+size_t TelSnapshot::getFinalLength(size_t index) const
+{
+    return entries[index].final_length;
+}
+
+bool TelSnapshot::isCyclic(size_t index) const
+{
+    return (entries[index].flags & CYCLIC) != 0;
+}
+
+size_t TelSnapshot::getPrefixCount() const
+{
+    assert(isOpen());
+    return header->prefix_count;
+}
+
+const char* TelSnapshot::getPrefixSource(size_t index) const
+{
+    return numbers + prefixes[index].source;
+}
+
+size_t TelSnapshot::getPrefixSourceLength(size_t index) const
+{
+    return prefixes[index].source_length;
+}
+
+const char* TelSnapshot::getPrefixDestination(size_t index) const
+{
+    return numbers + prefixes[index].destination;
+}
+
+size_t TelSnapshot::getPrefixDestinationLength(size_t index) const
+{
+    return prefixes[index].destination_length;
+}
+
+TelSnapshot::~TelSnapshot()
+{
+    if(data != NULL)
+        munmap(const_cast<char*>(data), size);
+}
@@ -0,0 +1,184 @@
+/** Binary snapshots of maptels.                            *
+ *  author: Cezary Bartoszuk                                *
+ *  e-mail: cbart@students.mimuw.edu.pl                     *
+ *  A snapshot file holds (after the header) four sections  *
+ *  referring to each other only by offsets and indexes:    *
+ *    entries:  source, destination and the result of       *
+ *              transformEx() (following exact rules only)  *
+ *              of every transformation,                    *
+ *    slots:    open addressing index of entries by source  *
+ *              (linear probing, the same 32 bit hash       *
+ *              as HashTable's StringHash),                 *
+ *    prefixes: prefix rules (source and destination),      *
+ *    numbers:  '\0' terminated numbers (each stored once). *
+ *  Header and body are checksummed. The file is mapped     *
+ *  read only and shared, so it is served directly from     *
+ *  the page cache and shared by all processes using it.    */
+
+#ifndef _TEL_SNAPSHOT_H_
+#define _TEL_SNAPSHOT_H_
+
+#include <string>
+#include <vector>
+
+#include <cstddef>
+
+#include <stdint.h>
+
+class TelSnapshot {
+
+    public:
+
+        /** transformation to be saved; numbers need not be
+         *  '\0' terminated; */
+        struct Transformation {
+            const char* source;
+            const char* destination;
+            const char* final;
+            uint32_t source_length;
+            uint32_t destination_length;
+            uint32_t final_length;
+            bool cyclic;
+        };
+
+        /** prefix rule to be saved (see Transformation); */
+        struct PrefixRule {
+            const char* source;
+            const char* destination;
+            uint32_t source_length;
+            uint32_t destination_length;
+        };
+
+        /** version of the format written by save(); it must be
+         *  changed whenever layout or hash function changes; */
+        static const uint32_t VERSION = 2;
+
+    private:
+
+        /** beginning of the file (all sizes are in bytes); */
+        struct Header {
+            char magic[8];
+            /** BYTE_ORDER_MARK written in native byte order; */
+            uint32_t byte_order;
+            uint32_t version;
+            uint64_t header_size;
+            uint64_t file_size;
+            uint64_t count;
+            uint64_t slot_count;
+            uint64_t entries_offset;
+            uint64_t slots_offset;
+            uint64_t prefix_count;
+            uint64_t prefixes_offset;
+            uint64_t numbers_offset;
+            uint64_t numbers_size;
+            /** checksum of [header_size, file_size); */
+            uint64_t body_checksum;
+            /** checksum of all previous fields of the header; */
+            uint64_t header_checksum;
+        };
+
+        /** single transformation; numbers are offsets
+         *  in the numbers section; */
+        struct Entry {
+            uint64_t source;
+            uint64_t destination;
+            uint64_t final;
+            uint32_t source_length;
+            uint32_t destination_length;
+            uint32_t final_length;
+            uint32_t flags;
+        };
+
+        /** single prefix rule (numbers as in Entry); */
+        struct Prefix {
+            uint64_t source;
+            uint64_t destination;
+            uint32_t source_length;
+            uint32_t destination_length;
+        };
+
+        /** slot of the index (hash 0 marks an empty slot); */
+        struct Slot {
+            uint32_t hash;
+            uint32_t index;
+        };
+
+        static const char MAGIC[8];
+
+        static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        /** Entry::flags bit set for cyclic transformations; */
+        static const uint32_t CYCLIC = 1;
+
+        /** mapped file or NULL; */
+        const char* data;
+
+        /** size of the mapping; */
+        size_t size;
+
+        /** sections of the mapped file; */
+        const Entry* entries;
+        const Slot* slots;
+        const Prefix* prefixes;
+        const char* numbers;
+
+        /** header of the mapped file; */
+        const Header* header;
+
+        TelSnapshot(const TelSnapshot& copy);
+        TelSnapshot& operator=(const TelSnapshot& copy);
+
+        /** true if mapped file is a correct snapshot; */
+        bool verify() const;
+
+    public:
+
+        /** checksum of `size` bytes starting at `data`
+         *  (also used by journals); */
+        static uint64_t checksum(const char* data, size_t size);
+
+        /** writes snapshot of given transformations and prefix rules
+         *  (both with distinct sources) to file `path` (atomically:
+         *  a temporary file is renamed); returns false on I/O error; */
+        static bool save(const char* path,
+                         const std::vector<Transformation>& transformations,
+                         const std::vector<PrefixRule>& prefix_rules);
+
+        /** maps and verifies snapshot file `path` (see isOpen()); */
+        explicit TelSnapshot(const char* path);
+
+        /** true if a correct snapshot has been mapped; */
+        bool isOpen() const;
+
+        /** number of transformations; */
+        size_t getCount() const;
+
+        /** index of transformation from `source`
+         *  or getCount() if there is none; */
+        size_t find(const std::string& source) const;
+
+        /** numbers and flag of `index`-th transformation
+         *  (numbers are '\0' terminated); */
+        const char* getSource(size_t index) const;
+        size_t getSourceLength(size_t index) const;
+        const char* getDestination(size_t index) const;
+        size_t getDestinationLength(size_t index) const;
+        const char* getFinal(size_t index) const;
+        size_t getFinalLength(size_t index) const;
+        bool isCyclic(size_t index) const;
+
+        /** number of prefix rules; */
+        size_t getPrefixCount() const;
+
+        /** numbers of `index`-th prefix rule ('\0' terminated); */
+        const char* getPrefixSource(size_t index) const;
+        size_t getPrefixSourceLength(size_t index) const;
+        const char* getPrefixDestination(size_t index) const;
+        size_t getPrefixDestinationLength(size_t index) const;
+
+        /** unmaps the file; */
+        ~TelSnapshot();
+
+};
+
+#endif
@@ -0,0 +1,249 @@
+/** Lock striped transformations of maptels.  *
+ *  author: Cezary Bartoszuk                 *
+ *  e-mail: cbart@students.mimuw.edu.pl      */
+
+#include <vector>
+#include <new>
+
+#include <cassert>
+#include <cstdlib>
+
+#include "./rw_lock.h"
+#include "./tel_number.h"
+#include "./tel_epoch.h"
+#include "./tel_striped.h"
+
+const unsigned TelStriped::STRIPE_BITS;
+
+const size_t TelStriped::STRIPES;
+
+const size_t TelStriped::LINE;
+
+const size_t TelStriped::MIN_BUCKETS;
+
+const size_t TelStriped::RETIRED_BATCH;
+
+TelStriped::TelStriped()
+    : stripes(NULL), stride((sizeof(Stripe) + LINE - 1) & ~(LINE - 1)),
+      settled(false)
+{
+    void* block = NULL;
+    if(posix_memalign(&block, LINE, STRIPES * stride) != 0)
+        throw std::bad_alloc();
+    stripes = static_cast<char*>(block);
+    for(size_t i = 0; i < STRIPES; i ++) {
+        new(stripes + i * stride) Stripe();
+        stripe(i).buckets = new Buckets(MIN_BUCKETS);
+        stripe(i).count = 0;
+        stripe(i).unlinked = new Unlinked();
+        stripe(i).unlinked->reserve(RETIRED_BATCH);
+    }
+}
+
+TelStriped::~TelStriped()
+{
+    for(size_t i = 0; i < STRIPES; i ++) {
+        disposeBuckets(stripe(i).buckets);
+        disposeUnlinked(stripe(i).unlinked);
+        stripe(i).~Stripe();
+    }
+    free(stripes);
+}
+
+TelStriped::Node** TelStriped::linkOf(Buckets& buckets,
+                                      const TelNumber& source,
+                                      uint32_t hash)
+{
+    Node** link = &buckets.heads[hash & buckets.mask];
+    while(*link != NULL
+          && ((*link)->hash != hash || !((*link)->source == source)))
+        link = &(*link)->next;
+    return link;
+}
+
+void TelStriped::grow(Stripe& target)
+{
+    Buckets* old = target.buckets;
+    Buckets* grown = new Buckets(2 * (old->mask + 1));
+    try {
+        for(size_t i = 0; i <= old->mask; i ++)
+            for(Node* node = old->heads[i]; node != NULL; node = node->next) {
+                /* linked nodes never change, so they are copied; */
+                Node* copy = new Node(*node);
+                Node*& head = grown->heads[node->hash & grown->mask];
+                copy->next = head;
+                head = copy;
+            }
+    }
+    catch(...) {
+        disposeBuckets(grown);
+        throw;
+    }
+    __atomic_store_n(&target.buckets, grown, __ATOMIC_RELEASE);
+    TelEpoch::retire(old, disposeBuckets);
+}
+
+TelStriped::Unlinked* TelStriped::spareUnlinked(const Stripe& target)
+{
+    if(target.unlinked->size() + 1 < RETIRED_BATCH)
+        return NULL;
+    Unlinked* spare = new Unlinked();
+    try {
+        spare->reserve(RETIRED_BATCH);
+    }
+    catch(...) {
+        delete spare;
+        throw;
+    }
+    return spare;
+}
+
+void TelStriped::retireNode(Stripe& target, Node* node, Unlinked* spare)
+{
+    /* the batch has room for the node (see spareUnlinked()); */
+    target.unlinked->push_back(node);
+    if(spare == NULL)
+        return;
+    Unlinked* batch = target.unlinked;
+    target.unlinked = spare;
+    TelEpoch::retire(batch, disposeUnlinked);
+}
+
+void TelStriped::disposeBuckets(void* buckets)
+{
+    Buckets* lists = static_cast<Buckets*>(buckets);
+    if(lists == NULL)
+        return;
+    for(size_t i = 0; i <= lists->mask; i ++)
+        for(Node* node = lists->heads[i]; node != NULL; ) {
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+    delete lists;
+}
+
+void TelStriped::disposeUnlinked(void* unlinked)
+{
+    Unlinked* nodes = static_cast<Unlinked*>(unlinked);
+    if(nodes == NULL)
+        return;
+    for(size_t i = 0; i < nodes->size(); i ++)
+        delete (*nodes)[i];
+    delete nodes;
+}
+
+bool TelStriped::insert(const TelNumber& source,
+                        const TelNumber& destination)
+{
+    Stripe& target = stripeOf(source);
+    WriteGuard guard(target.lock);
+    if(target.buckets == NULL)
+        return false;
+    uint32_t h = source.hash();
+    Node** link = linkOf(*target.buckets, source, h);
+    Node* old = *link;
+    if(old != NULL && old->destination == destination)
+        return true;
+    if(old == NULL && target.count > target.buckets->mask) {
+        grow(target);
+        link = linkOf(*target.buckets, source, h);
+    }
+    Unlinked* spare = (old == NULL) ? NULL : spareUnlinked(target);
+    Node* node;
+    try {
+        node = new Node();
+        node->next = (old == NULL) ? NULL : old->next;
+        node->hash = h;
+        node->source = source;
+        node->destination = destination;
+    }
+    catch(...) {
+        delete spare;
+        throw;
+    }
+    /* readers see either the old node or the new one; */
+    __atomic_store_n(link, node, __ATOMIC_RELEASE);
+    if(old == NULL)
+        target.count ++;
+    else
+        retireNode(target, old, spare);
+    return true;
+}
+
+TelStriped::Lookup TelStriped::erase(const TelNumber& source)
+{
+    Stripe& target = stripeOf(source);
+    WriteGuard guard(target.lock);
+    if(target.buckets == NULL)
+        return SETTLED;
+    Node** link = linkOf(*target.buckets, source, source.hash());
+    Node* old = *link;
+    if(old == NULL)
+        return MISSING;
+    Unlinked* spare = spareUnlinked(target);
+    /* readers at the node go on to its (unchanged) successor; */
+    __atomic_store_n(link, old->next, __ATOMIC_RELEASE);
+    target.count --;
+    retireNode(target, old, spare);
+    return FOUND;
+}
+
+template<typename Number>
+TelStriped::Lookup TelStriped::findIn(const Stripe& target,
+                                     const Number& source,
+                                     TelNumber& destination) const
+{
+    TelEpoch::Pin pin;
+    const Buckets* buckets = __atomic_load_n(&target.buckets,
+                                             __ATOMIC_ACQUIRE);
+    if(buckets == NULL)
+        return SETTLED;
+    uint32_t h = source.hash();
+    const Node* node = __atomic_load_n(&buckets->heads[h & buckets->mask],
+                                       __ATOMIC_ACQUIRE);
+    for(; node != NULL; node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE))
+        if(node->hash == h && matches(node->source, source)) {
+            destination = node->destination;
+            return FOUND;
+        }
+    return MISSING;
+}
+
+TelStriped::Lookup TelStriped::find(const TelNumber& source,
+                                    TelNumber& destination) const
+{
+    return findIn(stripeOf(source), source, destination);
+}
+
+TelStriped::Lookup TelStriped::find(const char* source, size_t length,
+                                    TelNumber& destination) const
+{
+    TelProbe probe(source, length);
+    return findIn(stripeOf(probe), probe, destination);
+}
+
+void TelStriped::settle(std::vector<Transformation>& transformations)
+{
+    assert(!isSettled());
+    __atomic_store_n(&settled, true, __ATOMIC_RELEASE);
+    for(size_t i = 0; i < STRIPES; i ++) {
+        Stripe& target = stripe(i);
+        WriteGuard guard(target.lock);
+        Buckets* buckets = target.buckets;
+        for(size_t j = 0; j <= buckets->mask; j ++)
+            for(Node* node = buckets->heads[j];
+                node != NULL;
+                node = node->next) {
+                Transformation transformation = {
+                    node->source, node->destination };
+                transformations.push_back(transformation);
+            }
+        __atomic_store_n(&target.buckets, static_cast<Buckets*>(NULL),
+                         __ATOMIC_RELEASE);
+        target.count = 0;
+        TelEpoch::retire(buckets, disposeBuckets);
+        TelEpoch::retire(target.unlinked, disposeUnlinked);
+        target.unlinked = NULL;
+    }
+}
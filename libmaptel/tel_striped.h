@@ -0,0 +1,209 @@
+/** Lock striped transformations of maptels.                  *
+ *  author: Cezary Bartoszuk                                   *
+ *  e-mail: cbart@students.mimuw.edu.pl                        *
+ *  Transformations are spread over STRIPES hash tables by the *
+ *  high bits of hashes of their sources, each table with      *
+ *  a lock of its writers and padded to whole cache lines.     *
+ *  Writers of sources in different stripes run in parallel.   *
+ *  Readers take no locks: a table is an array of lists of     *
+ *  nodes which never change once linked, so a writer links    *
+ *  a new node (in place of the replaced one, if any) and      *
+ *  retires unlinked nodes (see TelEpoch), which readers       *
+ *  pinned before may still use; a growing table copies its    *
+ *  nodes to a new array and retires the old one whole. The    *
+ *  table keeps no index (nor flags of cycles), so when        *
+ *  a maptel needs one the table is settled: it is emptied for *
+ *  good and every later call fails, telling the caller to use *
+ *  the maptel's ordinary tables instead.                      */
+
+#ifndef _TEL_STRIPED_H_
+#define _TEL_STRIPED_H_
+
+#include <vector>
+
+#include <cstddef>
+
+#include <stdint.h>
+
+#include "./rw_lock.h"
+#include "./tel_number.h"
+
+class TelStriped {
+
+    public:
+
+        /** result of a lookup or erase(); */
+        enum Lookup {
+            /** the source has a transformation; */
+            FOUND,
+            /** the source has no transformation; */
+            MISSING,
+            /** the table has been settled; */
+            SETTLED
+        };
+
+        /** single transformation (see settle()); */
+        struct Transformation {
+            TelNumber source;
+            TelNumber destination;
+        };
+
+    private:
+
+        /** number of bits of hashes selecting a stripe; */
+        static const unsigned STRIPE_BITS = 6;
+
+        static const size_t STRIPES = size_t(1) << STRIPE_BITS;
+
+        /** size of a cache line; */
+        static const size_t LINE = 64;
+
+        /** number of lists of an empty table; */
+        static const size_t MIN_BUCKETS = 8;
+
+        /** number of unlinked nodes of a stripe retired at once
+         *  (retiring is much slower than a write); */
+        static const size_t RETIRED_BATCH = 64;
+
+        /** transformation in the list of its bucket (only `next`
+         *  changes once it is linked); */
+        struct Node {
+            Node* next;
+            uint32_t hash;
+            TelNumber source;
+            TelNumber destination;
+        };
+
+        /** lists of a table (never resized, replaced by a larger
+         *  one when the table grows); */
+        struct Buckets {
+            size_t mask;
+            std::vector<Node*> heads;
+
+            explicit Buckets(size_t size)
+                : mask(size - 1), heads(size, static_cast<Node*>(NULL))
+            {
+            }
+        };
+
+        /** unlinked nodes of a stripe; */
+        typedef std::vector<Node*> Unlinked;
+
+        /** a table with the lock of its writers; */
+        struct Stripe {
+            RWLock lock;
+            /** NULL when the table has been moved by settle(); */
+            Buckets* buckets;
+            /** number of nodes of `buckets` (writers only); */
+            size_t count;
+            /** nodes unlinked since the last retired batch; */
+            Unlinked* unlinked;
+        };
+
+        /** stripes are LINE aligned and `stride` bytes apart; */
+        char* stripes;
+        size_t stride;
+
+        /** set when settle() starts; */
+        bool settled;
+
+        TelStriped(const TelStriped& copy);
+        TelStriped& operator=(const TelStriped& copy);
+
+        /** stripe of the `index`-th table; */
+        Stripe& stripe(size_t index) const
+        {
+            return *reinterpret_cast<Stripe*>(stripes + index * stride);
+        }
+
+        /** stripe holding transformation of `source` (a TelNumber
+         *  or a TelProbe); */
+        template<typename Number>
+        Stripe& stripeOf(const Number& source) const
+        {
+            return stripe(source.hash() >> (32 - STRIPE_BITS));
+        }
+
+        /** true if `key` is `other` (or matches probe `other`); */
+        static bool matches(const TelNumber& key, const TelNumber& other)
+        {
+            return key == other;
+        }
+
+        static bool matches(const TelNumber& key, const TelProbe& probe)
+        {
+            return probe.matches(key);
+        }
+
+        /** find() of `source` (a TelNumber or a TelProbe); */
+        template<typename Number>
+        Lookup findIn(const Stripe& target, const Number& source,
+                      TelNumber& destination) const;
+
+        /** returns the link to the node of `source` in `buckets`
+         *  (or the NULL ending its list); for writers only; */
+        static Node** linkOf(Buckets& buckets, const TelNumber& source,
+                             uint32_t hash);
+
+        /** replaces the table of `target` with one of twice as many
+         *  lists; */
+        static void grow(Stripe& target);
+
+        /** returns empty Unlinked able to hold RETIRED_BATCH nodes,
+         *  if the next unlinked node of `target` fills its batch,
+         *  NULL otherwise; called before a node is unlinked, so
+         *  retireNode() does not fail; */
+        static Unlinked* spareUnlinked(const Stripe& target);
+
+        /** adds `node`, unlinked from `target`, to its batch and
+         *  retires the batch if it is full (with `spare` returned
+         *  by spareUnlinked() taking its place); */
+        static void retireNode(Stripe& target, Node* node, Unlinked* spare);
+
+        /** frees retired lists (Buckets) with their nodes; */
+        static void disposeBuckets(void* buckets);
+
+        /** frees retired nodes (Unlinked); */
+        static void disposeUnlinked(void* unlinked);
+
+    public:
+
+        /** creates empty table; */
+        TelStriped();
+
+        ~TelStriped();
+
+        /** true if settle() has been called
+         *  (may be called without any lock); */
+        bool isSettled() const
+        {
+            return __atomic_load_n(&settled, __ATOMIC_ACQUIRE);
+        }
+
+        /** sets transformation of `source` to `destination`;
+         *  false (doing nothing) if the table has been settled; */
+        bool insert(const TelNumber& source, const TelNumber& destination);
+
+        /** erases transformation of `source` (FOUND if there
+         *  was one); */
+        Lookup erase(const TelNumber& source);
+
+        /** sets `destination` to transformation of `source`
+         *  (if FOUND); */
+        Lookup find(const TelNumber& source, TelNumber& destination) const;
+
+        /** find() of `length` characters of `source`, which is not
+         *  made a TelNumber (see TelProbe); */
+        Lookup find(const char* source, size_t length,
+                    TelNumber& destination) const;
+
+        /** moves all transformations to `transformations` (in no
+         *  particular order) and settles the table; it must not
+         *  be settled yet; stripes are settled one by one, calls
+         *  reaching a settled stripe fail, the other ones go on
+         *  and their results are moved later; */
+        void settle(std::vector<Transformation>& transformations);
+
+};
+
+#endif